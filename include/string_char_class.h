@@ -0,0 +1,23 @@
+#ifndef STRING_CHAR_CLASS_H
+#define STRING_CHAR_CLASS_H
+
+#include "string_ext.h"
+
+#include <stdbool.h>
+
+/// Compiled set of bytes, like a regex ``[...]``, see ``src/string_char_class.c``.
+typedef struct StringCharClassT StringCharClassT;
+
+StringCharClassT *StringCharClass_new(const StringT *characters);
+void StringCharClass_free(StringCharClassT *self);
+
+bool StringCharClass_contains(const StringCharClassT *self, char character);
+ssize_t StringCharClass_find_first(const StringCharClassT *self, const StringT *string,
+                                   ssize_t start);
+ssize_t StringCharClass_find_last(const StringCharClassT *self, const StringT *string,
+                                  ssize_t stop);
+ssize_t StringCharClass_span(const StringCharClassT *self, const StringT *string,
+                             ssize_t start);
+ssize_t StringCharClass_count(const StringCharClassT *self, const StringT *string);
+
+#endif /* STRING_CHAR_CLASS_H */
@@ -0,0 +1,40 @@
+#ifndef STRING_CSV_H
+#define STRING_CSV_H
+
+#include "string_ext.h"
+
+#include <stdbool.h>
+
+/// Dialect of a ``StringCsvParserT``, see :func:`StringCsvParser_new`.
+typedef struct {
+    char delimiter;
+    char quote;  /* '\0' disables quoting. */
+    char escape; /* '\0' when quotes are only escaped by doubling them. */
+} StringCsvOptionsT;
+
+/// Field of a record, a view into the buffer of the parser.
+typedef struct {
+    const char *string; /* Without the enclosing quotes. */
+    ssize_t length;
+    bool quoted;
+    bool escaped; /* Holds escapes, see `StringCsvParser_unescape`. */
+} StringCsvFieldT;
+
+/// Fields of a record, valid until the next call to the parser.
+typedef struct {
+    const StringCsvFieldT *fields;
+    ssize_t length;
+} StringCsvRecordT;
+
+/// Streaming CSV / DSV parser, see ``src/string_csv.c``.
+typedef struct StringCsvParserT StringCsvParserT;
+
+StringCsvParserT *StringCsvParser_new(const StringCsvOptionsT *options);
+void StringCsvParser_feed(StringCsvParserT *self, const char *data, ssize_t length);
+void StringCsvParser_finish(StringCsvParserT *self);
+bool StringCsvParser_next(StringCsvParserT *self, StringCsvRecordT *record);
+StringT *StringCsvParser_unescape(const StringCsvParserT *self,
+                                  const StringCsvFieldT *field);
+void StringCsvParser_free(StringCsvParserT *self);
+
+#endif /* STRING_CSV_H */
@@ -2,6 +2,7 @@
 #define STRING_H
 
 #include <stdbool.h>
+#include <stdint.h> /* int64_t, uint64_t */
 #include <stdlib.h> /* ssize_t */
 
 typedef struct {
@@ -9,12 +10,18 @@ typedef struct {
 
     ssize_t length;
     ssize_t allocated;
+
+    /* Result of `String_hash_cached`, 0 while not computed. */
+    uint64_t hash;
+
+    /* Reference count of a buffer shared by `String_share`, NULL while not shared. */
+    struct StringSharedT *shared;
 } StringT;
 
 typedef struct {
-    int start;
-    int stop;
-    int step;
+    ssize_t start;
+    ssize_t stop;
+    ssize_t step;
 } StringIndexT;
 
 typedef struct {
@@ -25,14 +32,89 @@ typedef struct {
     ssize_t allocated;
 } StringIteratorT;
 
+/// Flags controlling :func:`StringIterator_sort`, can be combined with ``|``.
+typedef enum {
+    STRING_SORT_DEFAULT = 0,
+    STRING_SORT_STABLE = 1 << 0,
+    STRING_SORT_IGNORE_CASE = 1 << 1,
+    STRING_SORT_PARALLEL = 1 << 2,
+} StringSortFlagsT;
+
+/// Transformation applied to every element by :func:`StringArray_transform`.
+typedef enum {
+    STRING_TRANSFORM_LOWER,
+    STRING_TRANSFORM_UPPER,
+    STRING_TRANSFORM_CASE_FOLD,
+    STRING_TRANSFORM_TRIM_WHITESPACE,
+    STRING_TRANSFORM_TRIM_LEFT,
+    STRING_TRANSFORM_TRIM_RIGHT,
+} StringTransformT;
+
+/// Predicate checked for every element by :func:`StringArray_test`.
+typedef enum {
+    STRING_TEST_INT,
+    STRING_TEST_REAL,
+    STRING_TEST_WHITESPACE,
+    STRING_TEST_ALPHANUMERIC,
+    STRING_TEST_UPPERCASE,
+    STRING_TEST_LOWERCASE,
+} StringTestT;
+
+/// Flags of the base64 functions, can be combined with ``|``.
+typedef enum {
+    STRING_BASE64_DEFAULT = 0,
+    STRING_BASE64_URL = 1 << 0,
+    STRING_BASE64_NO_PADDING = 1 << 1,
+    STRING_BASE64_LENIENT = 1 << 2,
+} StringBase64FlagsT;
+
+/// Flags of :func:`String_find_all`, can be combined with ``|``.
+typedef enum {
+    STRING_FIND_DEFAULT = 0,
+    STRING_FIND_OVERLAPPING = 1 << 0,
+} StringFindFlagsT;
+
+/// Positions of the matches found by :func:`String_find_all`, in increasing order.
+typedef struct {
+    int64_t *offsets;
+
+    ssize_t length;
+    ssize_t allocated;
+} StringMatchesT;
+
+/// Columnar collection of strings.
+/// Bytes of every element are stored back to back in ``data`` and element ``i``
+/// spans ``data[offsets[i]]`` up to ``data[offsets[i + 1]]``.
+typedef struct {
+    char *data;
+    int64_t *offsets;
+
+    ssize_t length;
+    ssize_t allocated;
+    ssize_t data_length;
+    ssize_t data_allocated;
+} StringArrayT;
+
 StringT *String_new(ssize_t size);
 StringT *String_from(const char *_string);
 
 char String_index(const StringT *self, ssize_t index);
 void String_concatenate_inplace(StringT *self, const StringT *other);
+bool String_eq(const StringT *self, const char *other);
 bool String_equals(const StringT *self, const StringT *other);
+int String_compare(const StringT *self, const StringT *other);
+ssize_t String_common_prefix_length(const StringT *self, const StringT *other);
+ssize_t String_mismatch(const StringT *self, const StringT *other);
+uint64_t String_hash(const StringT *self);
+uint64_t String_hash_seeded(const StringT *self, uint64_t seed);
+uint64_t String_hash_icase(const StringT *self);
+uint64_t String_hash_cached(StringT *self);
+uint64_t String_hash_char_array(const char *string, ssize_t length, uint64_t seed);
 bool String_ends_with(const StringT *self, const StringT *suffix);
 bool String_starts_with(const StringT *self, const StringT *prefix);
+bool String_equals_icase(const StringT *self, const StringT *other);
+bool String_ends_with_icase(const StringT *self, const StringT *suffix);
+bool String_starts_with_icase(const StringT *self, const StringT *prefix);
 bool String_is_alphanumeric(const StringT *self);
 bool String_is_uppercase(const StringT *self);
 bool String_is_lowercase(const StringT *self);
@@ -40,9 +122,15 @@ bool String_is_int(const StringT *self);
 bool String_is_real(const StringT *self);
 bool String_is_whitespace(const StringT *self);
 ssize_t String_count(const StringT *self, const StringT *sub_string);
+StringMatchesT *String_find_all(const StringT *self, const StringT *pattern, int flags);
+ssize_t String_find_all_into(const StringT *self, const StringT *pattern, int flags,
+                             int64_t *offsets, ssize_t capacity);
 StringIndexT String_contains(const StringT *self, const StringT *sub_string);
 StringIndexT String_contains_in_range(const StringT *self, const StringT *other,
                                       StringIndexT index);
+StringIndexT String_contains_icase(const StringT *self, const StringT *sub_string);
+StringIndexT String_contains_icase_in_range(const StringT *self, const StringT *other,
+                                            StringIndexT index);
 StringIndexT String_contains_char(const StringT *self, const char character);
 StringIndexT String_contains_char_in_range(const StringT *self, const char character,
                                            StringIndexT index);
@@ -63,6 +151,9 @@ StringIteratorT *String_right_split(const StringT *self, const StringT *delimite
 StringIteratorT *String_right_split_limit(const StringT *self, const StringT *delimiter,
                                           ssize_t limit);
 StringT *String_copy(const StringT *self);
+StringT *String_share(StringT *self);
+bool String_is_shared(const StringT *self);
+void String_unshare(StringT *self);
 StringT *String_join(StringIteratorT *self, const StringT *delimiter);
 StringT *String_slice(const StringT *self, StringIndexT index);
 StringT *String_concatenate(const StringT *self, const StringT *other);
@@ -75,6 +166,7 @@ StringT *String_to_lower(const StringT *self);
 StringT *String_to_title(const StringT *self);
 StringT *String_to_capital(const StringT *self);
 StringT *String_swap_case(const StringT *self);
+StringT *String_case_fold(const StringT *self);
 StringT *String_trim_whitespace(const StringT *self);
 StringT *String_trim_left(const StringT *self);
 StringT *String_trim_right(const StringT *self);
@@ -86,15 +178,70 @@ StringT *String_left_justify(const StringT *self, ssize_t width);
 StringT *String_right_justify(const StringT *self, ssize_t width);
 StringT *String_fill(const StringT *self, ssize_t width);
 StringIteratorT *String_chunks(const StringT *self, ssize_t chunk_size);
+bool String_utf8_validate(const StringT *self);
+bool String_utf8_validate_char_array(const char *string, ssize_t length);
+ssize_t String_utf8_length(const StringT *self);
+StringT *String_utf8_slice(const StringT *self, StringIndexT index);
+StringT *String_utf8_reverse(const StringT *self);
+StringT *String_json_escape(const StringT *self);
+void String_json_escape_into(StringT *output, const StringT *self);
+StringT *String_json_unescape(const StringT *self);
+bool String_json_unescape_into(StringT *output, const StringT *self);
+StringT *String_base64_encode(const StringT *self, int flags);
+void String_base64_encode_into(StringT *output, const StringT *self, int flags);
+StringT *String_base64_decode(const StringT *self, int flags);
+bool String_base64_decode_into(StringT *output, const StringT *self, int flags);
+ssize_t String_levenshtein(const StringT *self, const StringT *other);
+ssize_t String_levenshtein_bounded(const StringT *self, const StringT *other,
+                                   ssize_t max_distance);
+StringIndexT String_fuzzy_contains(const StringT *self, const StringT *pattern,
+                                   ssize_t max_errors);
+StringT *String_hex_encode(const StringT *self);
+void String_hex_encode_into(StringT *output, const StringT *self);
+StringT *String_hex_decode(const StringT *self);
+bool String_hex_decode_into(StringT *output, const StringT *self);
 
 void String_free(StringT *self);
 
+/* StringMatchesT */
+void StringMatches_free(StringMatchesT *self);
+
 /* StringIteratorT */
 StringIteratorT *StringIterator_new();
 const StringT *StringIterator_next(StringIteratorT *self);
 const StringT *StringIterator_get(StringIteratorT *self);
 void StringIterator_append(StringIteratorT *self, const StringT *string);
 void StringIterator_free(StringIteratorT *self);
+void StringIterator_sort(StringIteratorT *self, int flags);
+
+/* StringArrayT */
+StringArrayT *StringArray_new(ssize_t length, ssize_t data_size);
+StringArrayT *StringArray_from_iterator(const StringIteratorT *iterator);
+StringT StringArray_get(const StringArrayT *self, ssize_t index);
+void StringArray_append(StringArrayT *self, const StringT *string);
+void StringArray_append_char_array(StringArrayT *self, const char *string,
+                                   ssize_t length);
+void StringArray_free(StringArrayT *self);
+StringArrayT *String_split_array(const StringT *self, const StringT *delimiter);
+StringArrayT *String_split_array_limit(const StringT *self, const StringT *delimiter,
+                                       ssize_t limit);
+StringArrayT *String_split_whitespace_array(const StringT *self);
+StringArrayT *String_split_whitespace_array_limit(const StringT *self, ssize_t limit);
+StringArrayT *String_chunks_array(const StringT *self, ssize_t chunk_size);
+StringT *String_join_array(const StringArrayT *self, const StringT *delimiter);
+StringArrayT *StringArray_transform(const StringArrayT *self, StringTransformT transform,
+                                    int threads);
+StringArrayT *StringIterator_transform(const StringIteratorT *self,
+                                       StringTransformT transform, int threads);
+ssize_t StringArray_test(const StringArrayT *self, StringTestT test, bool *results,
+                         int threads);
+ssize_t StringIterator_test(const StringIteratorT *self, StringTestT test, bool *results,
+                            int threads);
+ssize_t StringArray_levenshtein(const StringArrayT *self, const StringT *query,
+                                ssize_t max_distance, ssize_t *distances, int threads);
+ssize_t StringIterator_levenshtein(const StringIteratorT *self, const StringT *query,
+                                   ssize_t max_distance, ssize_t *distances,
+                                   int threads);
 
 /* StringIndexT */
 // Helper macro to get number of arguments passed to a macro.
@@ -113,8 +260,10 @@ void StringIterator_free(StringIteratorT *self);
 /// StringIndexT index_with_start_stop_step = StringIndex(0, 10, 2);
 /// ```
 #define StringIndex(...)                                                                 \
-    StringIndex__init__(__NUM_ARGS(ssize_t, __VA_ARGS__), __VA_ARGS__)
-StringIndexT StringIndex__init__(size_t nargs, ...);
+    StringIndex__init__(__NUM_ARGS(ssize_t, __VA_ARGS__), (const ssize_t[]){__VA_ARGS__})
+StringIndexT StringIndex__init__(size_t nargs, const ssize_t *args);
 StringIndexT StringIndex_new(ssize_t start, ssize_t stop, ssize_t step);
+StringIndexT StringIndex_normalize(StringIndexT self, ssize_t length);
+ssize_t StringIndex_len(StringIndexT self);
 
 #endif /* STRING_H */
@@ -0,0 +1,22 @@
+#ifndef STRING_INDEX_TEXT_H
+#define STRING_INDEX_TEXT_H
+
+#include "string_ext.h"
+
+#include <stdbool.h>
+
+/// Suffix array over a fixed text for repeated searches, see ``src/string_index_text.c``.
+typedef struct StringIndexTextT StringIndexTextT;
+
+StringIndexTextT *StringIndexText_new(const StringT *text);
+StringIndexTextT *StringIndexText_load(const char *path);
+bool StringIndexText_save(const StringIndexTextT *self, const char *path);
+void StringIndexText_free(StringIndexTextT *self);
+
+StringT StringIndexText_text(const StringIndexTextT *self);
+bool StringIndexText_contains(const StringIndexTextT *self, const StringT *pattern);
+ssize_t StringIndexText_count(const StringIndexTextT *self, const StringT *pattern);
+ssize_t StringIndexText_locate(const StringIndexTextT *self, const StringT *pattern,
+                               ssize_t *positions, ssize_t capacity);
+
+#endif /* STRING_INDEX_TEXT_H */
@@ -0,0 +1,24 @@
+#ifndef STRING_INTERN_H
+#define STRING_INTERN_H
+
+#include "string_ext.h"
+
+#include <stdint.h> /* uint32_t */
+
+/// Thread-safe pool of unique strings, see ``src/string_intern.c``.
+typedef struct StringInternPoolT StringInternPoolT;
+
+StringInternPoolT *StringInternPool_new(void);
+const StringT *StringInternPool_intern(StringInternPoolT *self, const StringT *string,
+                                       uint32_t *id);
+const StringT *StringInternPool_intern_char_array(StringInternPoolT *self,
+                                                  const char *string, ssize_t length,
+                                                  uint32_t *id);
+const StringT *StringInternPool_find(StringInternPoolT *self, const StringT *string,
+                                     uint32_t *id);
+const StringT *StringInternPool_get(const StringInternPoolT *self, uint32_t id);
+uint32_t StringInternPool_id(const StringT *canonical);
+ssize_t StringInternPool_len(const StringInternPoolT *self);
+void StringInternPool_free(StringInternPoolT *self);
+
+#endif /* STRING_INTERN_H */
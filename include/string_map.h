@@ -0,0 +1,48 @@
+#ifndef STRING_MAP_H
+#define STRING_MAP_H
+
+#include "string_ext.h"
+
+#include <stdbool.h>
+#include <stdint.h> /* int64_t, uint64_t */
+
+/// Value stored for a key, either a pointer or an integer (e.g. a counter).
+typedef union {
+    void *pointer;
+    int64_t integer;
+} StringMapValueT;
+
+/// Entry of a ``StringMapT``, ``key`` is a NULL terminated copy owned by the map.
+typedef struct {
+    const char *key;
+    ssize_t length;
+    uint64_t hash;
+
+    StringMapValueT value;
+} StringMapEntryT;
+
+/// Open addressing hash map keyed by strings, see ``src/string_map.c``.
+typedef struct StringMapT StringMapT;
+
+StringMapT *StringMap_new(ssize_t capacity);
+ssize_t StringMap_len(const StringMapT *self);
+StringMapEntryT *StringMap_entry(StringMapT *self, const StringT *key, bool *inserted);
+StringMapEntryT *StringMap_entry_char_array(StringMapT *self, const char *key,
+                                            ssize_t length, bool *inserted);
+StringMapEntryT *StringMap_find(const StringMapT *self, const StringT *key);
+StringMapEntryT *StringMap_find_char_array(const StringMapT *self, const char *key,
+                                           ssize_t length);
+StringMapEntryT *StringMap_next(const StringMapT *self, ssize_t *cursor);
+void StringMap_set(StringMapT *self, const StringT *key, void *value);
+void *StringMap_get(const StringMapT *self, const StringT *key);
+void StringMap_set_int(StringMapT *self, const StringT *key, int64_t value);
+int64_t StringMap_get_int(const StringMapT *self, const StringT *key, int64_t missing);
+int64_t StringMap_increment(StringMapT *self, const StringT *key, int64_t delta);
+int64_t StringMap_increment_char_array(StringMapT *self, const char *key,
+                                       ssize_t length, int64_t delta);
+bool StringMap_remove(StringMapT *self, const StringT *key);
+bool StringMap_remove_char_array(StringMapT *self, const char *key, ssize_t length);
+ssize_t StringMap_memory(const StringMapT *self);
+void StringMap_free(StringMapT *self);
+
+#endif /* STRING_MAP_H */
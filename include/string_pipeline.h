@@ -0,0 +1,25 @@
+#ifndef STRING_PIPELINE_H
+#define STRING_PIPELINE_H
+
+#include "string_ext.h"
+
+#include <stdbool.h>
+
+/// Split, transform, filter and join stages run in one pass, see
+/// ``src/string_pipeline.c``.
+typedef struct StringPipelineT StringPipelineT;
+
+StringPipelineT *StringPipeline_new(void);
+void StringPipeline_split(StringPipelineT *self, const StringT *delimiter);
+void StringPipeline_split_lines(StringPipelineT *self);
+void StringPipeline_split_whitespace(StringPipelineT *self);
+void StringPipeline_transform(StringPipelineT *self, StringTransformT transform);
+void StringPipeline_replace(StringPipelineT *self, const StringT *old,
+                            const StringT *new);
+void StringPipeline_filter(StringPipelineT *self, StringTestT test, bool keep);
+void StringPipeline_drop_empty(StringPipelineT *self);
+void StringPipeline_join(StringPipelineT *self, const StringT *delimiter);
+StringT *StringPipeline_run(const StringPipelineT *self, const StringT *input);
+void StringPipeline_free(StringPipelineT *self);
+
+#endif /* STRING_PIPELINE_H */
@@ -0,0 +1,21 @@
+#ifndef STRING_PREFIX_SET_H
+#define STRING_PREFIX_SET_H
+
+#include "string_ext.h"
+
+#include <stdbool.h>
+
+/// Immutable radix tree of prefixes, see ``src/string_prefix_set.c``.
+typedef struct StringPrefixSetT StringPrefixSetT;
+
+StringPrefixSetT *StringPrefixSet_new(const StringIteratorT *prefixes);
+void StringPrefixSet_free(StringPrefixSetT *self);
+
+ssize_t StringPrefixSet_length(const StringPrefixSetT *self);
+bool StringPrefixSet_contains(const StringPrefixSetT *self, const StringT *string);
+ssize_t StringPrefixSet_longest_match(const StringPrefixSetT *self, const StringT *key,
+                                      ssize_t *length);
+ssize_t StringPrefixSet_all_matches(const StringPrefixSetT *self, const StringT *key,
+                                    ssize_t *ids, ssize_t capacity);
+
+#endif /* STRING_PREFIX_SET_H */
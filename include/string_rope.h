@@ -0,0 +1,46 @@
+#ifndef STRING_ROPE_H
+#define STRING_ROPE_H
+
+#include "string_ext.h"
+
+#include <stdbool.h>
+
+/// Maximum depth of a rope, enough for any rope which fits in memory.
+#define STRING_ROPE_MAX_DEPTH 96
+
+/// Balanced tree of text chunks for large editable texts, see ``src/string_rope.c``.
+typedef struct StringRopeT StringRopeT;
+typedef struct StringRopeNodeT StringRopeNodeT;
+
+/// Walks the chunks (leaves) of a rope in order, see :func:`StringRope_iterator`.
+typedef struct {
+    const StringRopeNodeT *stack[STRING_ROPE_MAX_DEPTH];
+    int depth;
+    ssize_t offset;
+} StringRopeIteratorT;
+
+StringRopeT *StringRope_new(void);
+StringRopeT *StringRope_from(const StringT *string);
+StringRopeT *StringRope_from_char_array(const char *string, ssize_t length);
+ssize_t StringRope_len(const StringRopeT *self);
+char StringRope_index(const StringRopeT *self, ssize_t index);
+void StringRope_insert(StringRopeT *self, ssize_t index, const StringT *string);
+void StringRope_insert_char_array(StringRopeT *self, ssize_t index, const char *string,
+                                  ssize_t length);
+void StringRope_append(StringRopeT *self, const StringT *string);
+void StringRope_delete(StringRopeT *self, ssize_t start, ssize_t stop);
+void StringRope_replace_range(StringRopeT *self, ssize_t start, ssize_t stop,
+                              const StringT *replacement);
+StringRopeT *StringRope_slice(const StringRopeT *self, ssize_t start, ssize_t stop);
+StringRopeT *StringRope_concatenate(const StringRopeT *self, const StringRopeT *other);
+void StringRope_concatenate_inplace(StringRopeT *self, const StringRopeT *other);
+StringIndexT StringRope_contains(const StringRopeT *self, const StringT *sub_string);
+StringIndexT StringRope_contains_from(const StringRopeT *self, const StringT *sub_string,
+                                      ssize_t start);
+void StringRope_iterator(const StringRopeT *self, ssize_t start,
+                         StringRopeIteratorT *iterator);
+bool StringRope_next_chunk(StringRopeIteratorT *iterator, StringT *chunk);
+StringT *StringRope_flatten(const StringRopeT *self);
+void StringRope_free(StringRopeT *self);
+
+#endif /* STRING_ROPE_H */
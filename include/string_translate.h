@@ -0,0 +1,20 @@
+#ifndef STRING_TRANSLATE_H
+#define STRING_TRANSLATE_H
+
+#include "string_ext.h"
+
+#include <stdbool.h>
+
+/// Compiled byte translation table, see ``src/string_translate.c``.
+typedef struct StringTranslateT StringTranslateT;
+
+StringTranslateT *StringTranslate_new(const unsigned char *map, const bool *deleted);
+StringTranslateT *StringTranslate_from(const StringT *from, const StringT *to,
+                                       const StringT *deleted);
+void StringTranslate_free(StringTranslateT *self);
+
+StringT *String_translate(const StringT *self, const StringTranslateT *table);
+void String_translate_into(StringT *output, const StringT *self,
+                           const StringTranslateT *table);
+
+#endif /* STRING_TRANSLATE_H */
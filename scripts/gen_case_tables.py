@@ -0,0 +1,83 @@
+#!/usr/bin/env python3
+"""Generate ``src/string_case_tables.h``, the Unicode case mapping tables.
+
+The tables are derived from the Unicode database bundled with Python, run
+``python3 scripts/gen_case_tables.py > src/string_case_tables.h`` to update them.
+
+Mappings to a single code point are stored as runs of code points which share the
+same delta, with a stride of 1 or 2 (upper and lower case letters often alternate).
+Mappings to several code points (e.g. ``ß`` to ``SS``) are stored separately as
+UTF-8 strings.
+"""
+
+import sys
+import unicodedata
+
+MAPPINGS = (("upper", str.upper), ("lower", str.lower), ("fold", str.casefold))
+
+
+def code_points():
+    for code_point in range(0x110000):
+        if not 0xD800 <= code_point <= 0xDFFF:
+            yield code_point
+
+
+def runs(deltas):
+    """Merge sorted ``(code_point, delta)`` pairs into ``(start, count, stride, delta)``."""
+    result = []
+    for code_point, delta in deltas:
+        if result:
+            start, count, stride, run_delta = result[-1]
+            last = start + (count - 1) * stride
+            if run_delta == delta and (
+                (count == 1 and code_point - last in (1, 2))
+                or (count > 1 and code_point - last == stride)
+            ):
+                result[-1] = (start, count + 1, code_point - start if count == 1 else stride,
+                              delta)
+                continue
+        result.append((code_point, 1, 1, delta))
+    return result
+
+
+def c_string(text):
+    return '"' + "".join("\\x%02X" % byte for byte in text.encode()) + '"'
+
+
+def main():
+    out = sys.stdout
+    out.write("/* Generated by scripts/gen_case_tables.py from Unicode %s, do not edit. */\n\n"
+              % unicodedata.unidata_version)
+    out.write("#ifndef STRING_CASE_TABLES_H\n#define STRING_CASE_TABLES_H\n\n")
+    out.write("#include <stdint.h> /* uint32_t, int32_t */\n\n")
+    out.write("/// Code points ``start + k * stride`` for ``k < count`` map to ``+ delta``.\n")
+    out.write("typedef struct {\n    uint32_t start;\n    uint16_t count;\n"
+              "    uint8_t stride;\n    int32_t delta;\n} CaseRunT;\n\n")
+    out.write("/// Code point mapped to several code points, ``mapped`` is UTF-8.\n")
+    out.write("typedef struct {\n    uint32_t code_point;\n    const char *mapped;\n"
+              "} CaseSpecialT;\n\n")
+
+    for name, function in MAPPINGS:
+        deltas, specials = [], []
+        for code_point in code_points():
+            mapped = function(chr(code_point))
+            if len(mapped) > 1:
+                specials.append((code_point, mapped))
+            elif ord(mapped) != code_point:
+                deltas.append((code_point, ord(mapped) - code_point))
+
+        out.write("static const CaseRunT CASE_%s_RUNS[] = {\n" % name.upper())
+        for start, count, stride, delta in runs(deltas):
+            out.write("    {0x%05X, %d, %d, %d},\n" % (start, count, stride, delta))
+        out.write("};\n\n")
+
+        out.write("static const CaseSpecialT CASE_%s_SPECIALS[] = {\n" % name.upper())
+        for code_point, mapped in specials:
+            out.write("    {0x%05X, %s},\n" % (code_point, c_string(mapped)))
+        out.write("};\n\n")
+
+    out.write("#endif /* STRING_CASE_TABLES_H */\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,88 @@
+#include "string_dbg.h"
+#include "string_internal.h"
+
+#include <stdlib.h> /* malloc, free */
+
+
+/// Size of a regular arena block.
+#define ARENA_BLOCK_SIZE (64 * 1024)
+/// Alignment of every allocation, enough for any scalar or pointer.
+#define ARENA_ALIGNMENT 16
+
+struct StringArenaBlockT {
+    struct StringArenaBlockT *next;
+    size_t used;
+    size_t size;
+    _Alignas(ARENA_ALIGNMENT) char data[];
+};
+
+/** Internal function to allocate a block with room for ``size`` bytes. */
+static StringArenaBlockT *
+_arena_block_new(size_t size) {
+    StringArenaBlockT *block = malloc(sizeof *block + size);
+
+    if (block == NULL) {
+        ERR("Unable to allocate memory for arena block");
+    }
+    DBG("Allocating arena block of %zu bytes", size);
+
+    *block = (StringArenaBlockT){.next = NULL, .used = 0, .size = size};
+    return block;
+}
+
+/**
+ * Allocate ``size`` bytes from the arena. The memory stays valid, at the same
+ * address, until :func:`string_arena_free` releases the whole arena.
+ *
+ * .. note:: Large requests get a block of their own which is linked behind the
+ *           current block, so the free space of the current block isn't wasted.
+ */
+void *
+string_arena_allocate(StringArenaT *self, size_t size) {
+    StringArenaBlockT *block = self->head;
+    size_t aligned = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+
+    if (aligned > ARENA_BLOCK_SIZE / 4) {
+        StringArenaBlockT *dedicated = _arena_block_new(aligned);
+
+        if (block == NULL) {
+            self->head = dedicated;
+        } else {
+            dedicated->next = block->next;
+            block->next = dedicated;
+        }
+        dedicated->used = aligned;
+        return dedicated->data;
+    }
+
+    if (block == NULL || block->size - block->used < aligned) {
+        block = _arena_block_new(ARENA_BLOCK_SIZE);
+        block->next = self->head;
+        self->head = block;
+    }
+
+    block->used += aligned;
+    return block->data + block->used - aligned;
+}
+
+/** Get the number of bytes allocated by the arena, headers of the blocks included. */
+size_t
+string_arena_memory(const StringArenaT *self) {
+    size_t memory = 0;
+
+    for (const StringArenaBlockT *block = self->head; block; block = block->next) {
+        memory += sizeof *block + block->size;
+    }
+    return memory;
+}
+
+/** Release every block of the arena, the arena can be reused afterwards. */
+void
+string_arena_free(StringArenaT *self) {
+    while (self->head) {
+        StringArenaBlockT *next = self->head->next;
+
+        free(self->head);
+        self->head = next;
+    }
+}
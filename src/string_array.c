@@ -0,0 +1,314 @@
+#include "string_ext.h"
+
+#include "string_dbg.h"
+#include "string_internal.h"
+
+#include <stdlib.h> /* malloc, realloc, free */
+#include <string.h> /* memcpy */
+
+
+/**
+ * Internal function to make room for at least ``length`` elements in the offsets
+ * array.
+ */
+static void
+StringArray_reserve(StringArrayT *self, ssize_t length) {
+    if (length <= self->allocated) return;
+
+    self->allocated = GROW_CAPACITY(length);
+    DBG("Re-allocating offsets to %ld", self->allocated);
+    self->offsets = realloc(self->offsets, (self->allocated + 1) * sizeof *self->offsets);
+
+    if (self->offsets == NULL) {
+        ERR("Unable to reallocate memory for offsets");
+    }
+}
+
+/**
+ * Internal function to make room for at least ``size`` bytes in the data buffer.
+ */
+static void
+StringArray_reserve_data(StringArrayT *self, ssize_t size) {
+    if (size <= self->data_allocated) return;
+
+    self->data_allocated = GROW_CAPACITY(size);
+    DBG("Re-allocating data to %ld", self->data_allocated);
+    self->data = realloc(self->data, self->data_allocated * sizeof *self->data);
+
+    if (self->data == NULL) {
+        ERR("Unable to reallocate memory for data");
+    }
+}
+
+/**
+ * Create and return a new ``StringArrayT`` with room for ``length`` elements holding
+ * ``data_size`` bytes in total.
+ * When both sizes are known up front the array never re-allocates while being filled.
+ *
+ * .. code-block:: c
+ *
+ *    StringArrayT *array = StringArray_new(2, 6);
+ *    StringArray_append_char_array(array, "foo", 3);
+ *    StringArray_append_char_array(array, "bar", 3);
+ */
+StringArrayT *
+StringArray_new(ssize_t length, ssize_t data_size) {
+    StringArrayT *self = malloc(sizeof *self);
+    int64_t *offsets = malloc((length + 1) * sizeof *offsets);
+    char *data = malloc(MAX_2(data_size, 1) * sizeof *data);
+
+    if (self == NULL) {
+        ERR("Unable to allocate memory for `StringArrayT`");
+    }
+    if (offsets == NULL || data == NULL) {
+        ERR("Unable to allocate memory for `StringArrayT` buffers");
+    }
+
+    offsets[0] = 0;
+    *self = (StringArrayT){.data = data,
+                           .offsets = offsets,
+                           .length = 0,
+                           .allocated = length,
+                           .data_length = 0,
+                           .data_allocated = MAX_2(data_size, 1)};
+    return self;
+}
+
+/**
+ * Create a ``StringArrayT`` holding a copy of every string in the iterator.
+ * The array is sized exactly, so this performs a single allocation per buffer.
+ *
+ * .. note:: The position of the iterator is neither used nor modified.
+ */
+StringArrayT *
+StringArray_from_iterator(const StringIteratorT *iterator) {
+    ssize_t data_size = 0;
+    StringArrayT *self;
+
+    for (ssize_t i = 0; i < iterator->length; ++i) {
+        data_size += iterator->strings[i]->length;
+    }
+
+    self = StringArray_new(iterator->length, data_size);
+    for (ssize_t i = 0; i < iterator->length; ++i) {
+        StringArray_append(self, iterator->strings[i]);
+    }
+
+    return self;
+}
+
+/**
+ * Get a view of the element at the given index in O(1).
+ * Negative indices are supported.
+ *
+ * .. note::
+ *    * The returned ``StringT`` borrows the array's buffer, it is not NULL terminated
+ *      and must not be freed or modified. It is invalidated by appending to the array.
+ *    * If index is out of range, this function will throw an error and exit.
+ *
+ * .. code-block:: c
+ *
+ *    StringArrayT *words = String_split_array(String_from("foo bar"), String_from(" "));
+ *    StringT last = StringArray_get(words, -1);
+ *
+ *    assert(last.length == 3);
+ */
+StringT
+StringArray_get(const StringArrayT *self, ssize_t index) {
+    if (index < 0) {
+        index += self->length;
+    }
+    if (index < 0 || index >= self->length) {
+        ERR("StringArray_get: index out of range");
+    }
+
+    return (StringT){.string = self->data + self->offsets[index],
+                     .length = self->offsets[index + 1] - self->offsets[index],
+                     .allocated = 0};
+}
+
+/** Append a copy of ``length`` bytes of ``string`` to the end of the array. */
+void
+StringArray_append_char_array(StringArrayT *self, const char *string, ssize_t length) {
+    StringArray_reserve(self, self->length + 1);
+    StringArray_reserve_data(self, self->data_length + length);
+
+    memcpy(self->data + self->data_length, string, length);
+    self->data_length += length;
+    self->offsets[++self->length] = self->data_length;
+}
+
+/** Append a copy of a ``StringT`` to the end of the array. */
+void
+StringArray_append(StringArrayT *self, const StringT *string) {
+    StringArray_append_char_array(self, string->string, string->length);
+}
+
+/** De-allocate the array along with the bytes of all its elements. */
+void
+StringArray_free(StringArrayT *self) {
+    free(self->data);
+    free(self->offsets);
+    free(self);
+}
+
+/**
+ * Split the string by the delimiter and return the pieces as a ``StringArrayT``.
+ * See :func:`String_split` for more info.
+ *
+ * .. code-block:: c
+ *
+ *    StringT *string = String_from("foo,bar,spam");
+ *    StringArrayT *array = String_split_array(string, String_from(","));
+ *
+ *    assert(array->length == 3);
+ */
+StringArrayT *
+String_split_array(const StringT *self, const StringT *delimiter) {
+    return String_split_array_limit(self, delimiter, -1);
+}
+
+/**
+ * Split the string by the delimiter for a fixed ``limit`` and return the pieces as a
+ * ``StringArrayT``. See :func:`String_split_limit` for more info.
+ *
+ * .. note:: The pieces never hold more bytes than the original string, so the data
+ *           buffer is allocated once up front.
+ */
+StringArrayT *
+String_split_array_limit(const StringT *self, const StringT *delimiter, ssize_t limit) {
+    StringArrayT *array = StringArray_new(4, self->length);
+    StringMatchesT matches = {0};
+    ssize_t start = 0;
+
+    // Special case for `limit`
+    // If limit is -1, then we iterate until the string is exhausted
+    if (!limit) {
+        StringArray_append(array, self);
+        return array;
+    } else if (limit < -1) {
+        ERR("String_split_array_limit: limit must be greater than -1");
+    }
+
+    string_find_all(self, delimiter, STRING_FIND_DEFAULT, limit, &matches);
+    for (ssize_t i = 0; i < matches.length; ++i) {
+        StringArray_append_char_array(array, self->string + start,
+                                      matches.offsets[i] - start);
+        start = matches.offsets[i] + delimiter->length;
+    }
+
+    StringArray_append_char_array(array, self->string + start, self->length - start);
+
+    free(matches.offsets);
+    return array;
+}
+
+static void
+_append_token(const char *string, ssize_t length, void *context) {
+    StringArray_append_char_array(context, string, length);
+}
+
+/**
+ * Split the string on runs of whitespace and return the tokens as a ``StringArrayT``.
+ * See :func:`String_split_whitespace` for more info.
+ *
+ * .. note:: The data buffer is allocated once up front, so this performs a constant
+ *           number of allocations whatever the number of tokens.
+ *
+ * .. code-block:: c
+ *
+ *    StringT *string = String_from("  foo bar\tspam  ");
+ *    StringArrayT *tokens = String_split_whitespace_array(string);
+ *
+ *    assert(tokens->length == 3);
+ */
+StringArrayT *
+String_split_whitespace_array(const StringT *self) {
+    return String_split_whitespace_array_limit(self, -1);
+}
+
+/**
+ * Split the string on runs of whitespace for a fixed ``limit`` and return the tokens
+ * as a ``StringArrayT``. See :func:`String_split_whitespace_limit` for more info.
+ */
+StringArrayT *
+String_split_whitespace_array_limit(const StringT *self, ssize_t limit) {
+    StringArrayT *array = StringArray_new(4, self->length);
+
+    if (limit < -1) {
+        ERR("String_split_whitespace_array_limit: limit must be greater than -1");
+    }
+
+    string_split_whitespace(self->string, self->length, limit, _append_token, array);
+
+    return array;
+}
+
+/**
+ * Split the string into chunks of ``chunk_size`` bytes, the last chunk holds the
+ * remainder. Both buffers of the returned array are sized exactly.
+ *
+ * .. code-block:: c
+ *
+ *    StringT *string = String_from("abcdefg");
+ *    StringArrayT *chunks = String_chunks_array(string, 3);
+ *
+ *    assert(chunks->length == 3);
+ */
+StringArrayT *
+String_chunks_array(const StringT *self, ssize_t chunk_size) {
+    StringArrayT *array;
+
+    if (chunk_size <= 0) {
+        ERR("String_chunks_array: chunk_size must be greater than 0");
+    }
+
+    array = StringArray_new((self->length + chunk_size - 1) / chunk_size, self->length);
+    for (ssize_t i = 0; i < self->length; i += chunk_size) {
+        StringArray_append_char_array(array, self->string + i,
+                                      MIN_2(chunk_size, self->length - i));
+    }
+
+    return array;
+}
+
+/**
+ * Join the elements of a ``StringArrayT`` separated by a delimiter.
+ * The length of the result is known up front, so it is allocated exactly once.
+ *
+ * .. code-block:: c
+ *
+ *    StringArrayT *array = String_split_array(String_from("a b c"), String_from(" "));
+ *    StringT *string = String_join_array(array, String_from(", "));
+ *
+ *    assert(String_eq(string, "a, b, c"));
+ */
+StringT *
+String_join_array(const StringArrayT *self, const StringT *delimiter) {
+    ssize_t length = self->data_length;
+    StringT *string;
+    char *cursor;
+
+    if (self->length > 1) {
+        length += (self->length - 1) * delimiter->length;
+    }
+
+    string = String_new(length + 1);
+    cursor = string->string;
+
+    for (ssize_t i = 0; i < self->length; ++i) {
+        ssize_t element_length = self->offsets[i + 1] - self->offsets[i];
+
+        if (i) {
+            memcpy(cursor, delimiter->string, delimiter->length);
+            cursor += delimiter->length;
+        }
+        memcpy(cursor, self->data + self->offsets[i], element_length);
+        cursor += element_length;
+    }
+
+    *cursor = '\0';
+    string->length = length;
+
+    return string;
+}
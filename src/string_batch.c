@@ -0,0 +1,357 @@
+#include "string_ext.h"
+
+#include "string_dbg.h"
+#include "string_internal.h"
+
+#include <stdatomic.h> /* atomic_long, atomic_fetch_add */
+#include <stdlib.h>    /* malloc */
+#include <string.h>    /* memcpy */
+
+
+/*
+ * Batch transforms, predicates and edit distances over whole ``StringArrayT`` or
+ * ``StringIteratorT`` collections.
+ *
+ * A transform makes two passes over the batch: the first one measures the result of
+ * every element into the offsets of the output, the second one writes the elements
+ * at their final position. The output buffers are thus allocated exactly once, and
+ * both passes can be spread over several threads since elements never overlap.
+ */
+
+/// Number of elements handed to a thread at once, smaller batches use one thread.
+#define BATCH_GRAIN 1024
+
+/// The same for edit distances, which cost more per element.
+#define BATCH_DISTANCE_GRAIN 64
+
+/// Elements of a batch, exactly one of the two collections is set.
+typedef struct {
+    const StringArrayT *array;
+    const StringIteratorT *iterator;
+} BatchSourceT;
+
+typedef struct {
+    BatchSourceT source;
+    StringTransformT transform;
+    StringArrayT *output;
+} TransformJobT;
+
+typedef struct {
+    BatchSourceT source;
+    StringPredicateFnT predicate;
+    bool *results;
+    atomic_long matches;
+} TestJobT;
+
+typedef struct {
+    BatchSourceT source;
+    const StringEditPatternT *query;
+    ssize_t max_distance;
+    ssize_t *distances;
+    atomic_long matches;
+} DistanceJobT;
+
+static inline ssize_t
+_batch_length(const BatchSourceT *source) {
+    return source->array ? source->array->length : source->iterator->length;
+}
+
+/** Internal function to get a view of the element at ``index`` of the batch. */
+static inline StringT
+_batch_get(const BatchSourceT *source, ssize_t index) {
+    const StringArrayT *array = source->array;
+
+    if (!array) {
+        return *source->iterator->strings[index];
+    }
+
+    return (StringT){.string = array->data + array->offsets[index],
+                     .length = array->offsets[index + 1] - array->offsets[index]};
+}
+
+/**
+ * Internal function to apply the transform to one element, writing it to ``output``
+ * unless it is ``NULL``. Returns the length of the transformed element.
+ */
+static ssize_t
+_transform_element(StringTransformT transform, StringT element, char *output) {
+    ssize_t start = 0, stop = element.length;
+
+    switch (transform) {
+    case STRING_TRANSFORM_LOWER:
+        return string_case_map(element.string, element.length, CASE_LOWER, output);
+    case STRING_TRANSFORM_UPPER:
+        return string_case_map(element.string, element.length, CASE_UPPER, output);
+    case STRING_TRANSFORM_CASE_FOLD:
+        return string_case_map(element.string, element.length, CASE_FOLD, output);
+    case STRING_TRANSFORM_TRIM_WHITESPACE:
+    case STRING_TRANSFORM_TRIM_LEFT:
+    case STRING_TRANSFORM_TRIM_RIGHT:
+        if (transform != STRING_TRANSFORM_TRIM_RIGHT) {
+            while (start < stop && CHAR_IS_WHITESPACE(element.string[start])) start++;
+        }
+        if (transform != STRING_TRANSFORM_TRIM_LEFT) {
+            while (stop > start && CHAR_IS_WHITESPACE(element.string[stop - 1])) stop--;
+        }
+        if (output) memcpy(output, element.string + start, stop - start);
+        return stop - start;
+    }
+
+    ERR("StringArray_transform: unknown transform %d", transform);
+}
+
+static void
+_transform_measure(ssize_t begin, ssize_t end, void *context) {
+    TransformJobT *job = context;
+
+    for (ssize_t i = begin; i < end; ++i) {
+        job->output->offsets[i + 1] =
+            _transform_element(job->transform, _batch_get(&job->source, i), NULL);
+    }
+}
+
+static void
+_transform_write(ssize_t begin, ssize_t end, void *context) {
+    TransformJobT *job = context;
+    StringArrayT *output = job->output;
+
+    for (ssize_t i = begin; i < end; ++i) {
+        _transform_element(job->transform, _batch_get(&job->source, i),
+                           output->data + output->offsets[i]);
+    }
+}
+
+static StringArrayT *
+_batch_transform(BatchSourceT source, StringTransformT transform, int threads) {
+    ssize_t length = _batch_length(&source);
+    StringArrayT *output = malloc(sizeof *output);
+    TransformJobT job = {.source = source, .transform = transform, .output = output};
+
+    if (output == NULL) {
+        ERR("Unable to allocate memory for `StringArrayT`");
+    }
+
+    *output = (StringArrayT){.offsets = malloc((length + 1) * sizeof *output->offsets),
+                             .length = length,
+                             .allocated = length};
+    if (output->offsets == NULL) {
+        ERR("Unable to allocate memory for `StringArrayT` buffers");
+    }
+
+    string_parallel_for(length, threads, BATCH_GRAIN, _transform_measure, &job);
+
+    // Turn the lengths into offsets, then every element knows where to go.
+    output->offsets[0] = 0;
+    for (ssize_t i = 0; i < length; ++i) {
+        output->offsets[i + 1] += output->offsets[i];
+    }
+
+    output->data_length = output->offsets[length];
+    output->data_allocated = MAX_2(output->data_length, 1);
+    output->data = malloc(output->data_allocated * sizeof *output->data);
+    if (output->data == NULL) {
+        ERR("Unable to allocate memory for `StringArrayT` buffers");
+    }
+
+    string_parallel_for(length, threads, BATCH_GRAIN, _transform_write, &job);
+
+    return output;
+}
+
+/**
+ * Apply a transformation to every element of the array and return the results as a
+ * new ``StringArrayT``. The transformations match :func:`String_to_lower`,
+ * :func:`String_to_upper`, :func:`String_case_fold`, :func:`String_trim_whitespace`,
+ * :func:`String_trim_left` and :func:`String_trim_right`.
+ *
+ * The work is spread over ``threads`` threads, a value <= 0 uses one thread per
+ * online CPU. Batches of less than a thousand elements always use one thread.
+ *
+ * .. note:: Has time complexity of O(n) in the total number of bytes. Both buffers of
+ *           the result are allocated exactly once, however many elements there are.
+ *
+ * .. code-block:: c
+ *
+ *    StringArrayT *words = String_split_array(String_from("Foo BAR"), String_from(" "));
+ *    StringArrayT *lower = StringArray_transform(words, STRING_TRANSFORM_LOWER, 1);
+ *    StringT last = StringArray_get(lower, -1);
+ *
+ *    assert(last.length == 3 && memcmp(last.string, "bar", 3) == 0);
+ */
+StringArrayT *
+StringArray_transform(const StringArrayT *self, StringTransformT transform, int threads) {
+    return _batch_transform((BatchSourceT){.array = self}, transform, threads);
+}
+
+/**
+ * Apply a transformation to every string of the iterator and return the results as a
+ * ``StringArrayT``. See :func:`StringArray_transform` for more info.
+ *
+ * .. note:: The position of the iterator is neither used nor modified.
+ */
+StringArrayT *
+StringIterator_transform(const StringIteratorT *self, StringTransformT transform,
+                         int threads) {
+    return _batch_transform((BatchSourceT){.iterator = self}, transform, threads);
+}
+
+static void
+_test_range(ssize_t begin, ssize_t end, void *context) {
+    TestJobT *job = context;
+    long matches = 0;
+
+    for (ssize_t i = begin; i < end; ++i) {
+        StringT element = _batch_get(&job->source, i);
+        bool result = job->predicate(&element);
+
+        if (job->results) job->results[i] = result;
+        matches += result;
+    }
+
+    atomic_fetch_add(&job->matches, matches);
+}
+
+/** Return the ``String_is_*`` function checking the given ``StringTestT``. */
+StringPredicateFnT
+string_test_predicate(StringTestT test) {
+    switch (test) {
+    case STRING_TEST_INT:
+        return String_is_int;
+    case STRING_TEST_REAL:
+        return String_is_real;
+    case STRING_TEST_WHITESPACE:
+        return String_is_whitespace;
+    case STRING_TEST_ALPHANUMERIC:
+        return String_is_alphanumeric;
+    case STRING_TEST_UPPERCASE:
+        return String_is_uppercase;
+    case STRING_TEST_LOWERCASE:
+        return String_is_lowercase;
+    }
+
+    ERR("Unknown string test %d", test);
+}
+
+static ssize_t
+_batch_test(BatchSourceT source, StringTestT test, bool *results, int threads) {
+    TestJobT job = {
+        .source = source, .predicate = string_test_predicate(test), .results = results};
+
+    atomic_init(&job.matches, 0);
+    string_parallel_for(_batch_length(&source), threads, BATCH_GRAIN, _test_range, &job);
+
+    return atomic_load(&job.matches);
+}
+
+/**
+ * Check a predicate for every element of the array, matching :func:`String_is_int`,
+ * :func:`String_is_real`, :func:`String_is_whitespace`,
+ * :func:`String_is_alphanumeric`, :func:`String_is_uppercase` or
+ * :func:`String_is_lowercase`. Returns the number of elements for which it holds.
+ *
+ * The result of element ``i`` is stored in ``results[i]`` unless ``results`` is
+ * ``NULL``, the caller provides room for ``self->length`` values. See
+ * :func:`StringArray_transform` for the meaning of ``threads``.
+ *
+ * .. code-block:: c
+ *
+ *    StringArrayT *tokens = String_split_array(String_from("1 a 22"), String_from(" "));
+ *    bool results[3];
+ *
+ *    assert(StringArray_test(tokens, STRING_TEST_INT, results, 1) == 2);
+ *    assert(results[0] && !results[1] && results[2]);
+ */
+ssize_t
+StringArray_test(const StringArrayT *self, StringTestT test, bool *results, int threads) {
+    return _batch_test((BatchSourceT){.array = self}, test, results, threads);
+}
+
+/**
+ * Check a predicate for every string of the iterator.
+ * See :func:`StringArray_test` for more info.
+ *
+ * .. note:: The position of the iterator is neither used nor modified.
+ */
+ssize_t
+StringIterator_test(const StringIteratorT *self, StringTestT test, bool *results,
+                    int threads) {
+    return _batch_test((BatchSourceT){.iterator = self}, test, results, threads);
+}
+
+static void
+_distance_range(ssize_t begin, ssize_t end, void *context) {
+    DistanceJobT *job = context;
+    long matches = 0;
+
+    for (ssize_t i = begin; i < end; ++i) {
+        StringT element = _batch_get(&job->source, i);
+        ssize_t distance = string_edit_distance(job->query, element.string,
+                                                element.length, job->max_distance);
+
+        if (job->distances) job->distances[i] = distance;
+        matches += distance >= 0;
+    }
+
+    atomic_fetch_add(&job->matches, matches);
+}
+
+static ssize_t
+_batch_levenshtein(BatchSourceT source, const StringT *query, ssize_t max_distance,
+                   ssize_t *distances, int threads) {
+    StringEditPatternT pattern;
+    DistanceJobT job = {.source = source,
+                        .query = &pattern,
+                        .max_distance = max_distance,
+                        .distances = distances};
+
+    // Compiled once, the masks are only read by the threads.
+    string_edit_pattern_init(&pattern, query->string, query->length);
+    atomic_init(&job.matches, 0);
+    string_parallel_for(_batch_length(&source), threads, BATCH_DISTANCE_GRAIN,
+                        _distance_range, &job);
+    string_edit_pattern_free(&pattern);
+
+    return atomic_load(&job.matches);
+}
+
+/**
+ * Compute the Levenshtein distance between the query and every element of the array,
+ * for instance to look up the words of a dictionary close to a misspelt one. Returns
+ * the number of elements at distance of at most ``max_distance``, every element if
+ * it is negative. See :func:`String_levenshtein_bounded`.
+ *
+ * The distance of element ``i`` is stored in ``distances[i]`` unless ``distances`` is
+ * ``NULL``, ``-1`` when it exceeds ``max_distance``. See :func:`StringArray_transform`
+ * for the meaning of ``threads``.
+ *
+ * .. note:: The query is compiled once for the whole batch.
+ *
+ * .. code-block:: c
+ *
+ *    StringArrayT *words = String_split_array(String_from("receive deceive recipe"),
+ *                                             String_from(" "));
+ *    StringT *query = String_from("recieve");
+ *    ssize_t distances[3];
+ *
+ *    assert(StringArray_levenshtein(words, query, 2, distances, 1) == 2);
+ *    assert(distances[0] == 2 && distances[1] == -1 && distances[2] == 2);
+ */
+ssize_t
+StringArray_levenshtein(const StringArrayT *self, const StringT *query,
+                        ssize_t max_distance, ssize_t *distances, int threads) {
+    return _batch_levenshtein((BatchSourceT){.array = self}, query, max_distance,
+                              distances, threads);
+}
+
+/**
+ * Compute the Levenshtein distance between the query and every string of the
+ * iterator. See :func:`StringArray_levenshtein` for more info.
+ *
+ * .. note:: The position of the iterator is neither used nor modified.
+ */
+ssize_t
+StringIterator_levenshtein(const StringIteratorT *self, const StringT *query,
+                           ssize_t max_distance, ssize_t *distances, int threads) {
+    return _batch_levenshtein((BatchSourceT){.iterator = self}, query, max_distance,
+                              distances, threads);
+}
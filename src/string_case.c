@@ -0,0 +1,343 @@
+#include "string_ext.h"
+
+#include "string_case_tables.h"
+#include "string_dbg.h"
+#include "string_internal.h"
+#include "string_simd.h"
+
+#include <string.h> /* memcmp, memcpy, strlen */
+
+
+/*
+ * Unicode case conversion of UTF-8 strings.
+ *
+ * Blocks of 16 ASCII bytes are converted at once with SSE2, a block holding any
+ * other byte is decoded code point by code point and mapped with the generated tables
+ * of ``string_case_tables.h`` (see ``scripts/gen_case_tables.py``). One pass measures
+ * the result and a second one writes it into an exact allocation, the same kernel
+ * serving the ``String_*`` conversions and the batch and pipeline transforms.
+ */
+
+typedef struct {
+    const CaseRunT *runs;
+    ssize_t runs_length;
+    const CaseSpecialT *specials;
+    ssize_t specials_length;
+} CaseTableT;
+
+#define CASE_TABLE(runs, specials)                                                       \
+    {runs, sizeof runs / sizeof *runs, specials, sizeof specials / sizeof *specials}
+
+static const CaseTableT CASE_TABLES[] = {
+    [CASE_UPPER] = CASE_TABLE(CASE_UPPER_RUNS, CASE_UPPER_SPECIALS),
+    [CASE_LOWER] = CASE_TABLE(CASE_LOWER_RUNS, CASE_LOWER_SPECIALS),
+    [CASE_FOLD] = CASE_TABLE(CASE_FOLD_RUNS, CASE_FOLD_SPECIALS),
+};
+
+/// Longest UTF-8 result of mapping one code point (3 code points of 4 bytes at most).
+#define CASE_MAX_MAPPED 12
+
+/**
+ * Internal function to map a code point with one of the tables. Returns the mapped
+ * code point, or ``0`` and the UTF-8 result in ``special`` when it maps to several.
+ */
+static uint32_t
+_case_map_table(const CaseTableT *table, uint32_t code_point, const char **special) {
+    ssize_t low = 0, high = table->specials_length - 1;
+    const CaseRunT *run;
+
+    while (low <= high) {
+        ssize_t middle = (low + high) / 2;
+
+        if (table->specials[middle].code_point == code_point) {
+            *special = table->specials[middle].mapped;
+            return 0;
+        }
+        if (table->specials[middle].code_point < code_point) {
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+
+    // Find the last run starting at or before the code point.
+    low = 0, high = table->runs_length;
+    while (low < high) {
+        ssize_t middle = (low + high) / 2;
+
+        if (table->runs[middle].start <= code_point) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low == 0) return code_point;
+
+    run = &table->runs[low - 1];
+    if ((code_point - run->start) % run->stride == 0 &&
+        (code_point - run->start) / run->stride < run->count) {
+        return code_point + run->delta;
+    }
+    return code_point;
+}
+
+/** Internal function to map a code point in the given mode, see ``_case_map_table``. */
+static uint32_t
+_case_map(CaseModeT mode, uint32_t code_point, const char **special) {
+    uint32_t mapped;
+
+    if (mode != CASE_SWAP) {
+        return _case_map_table(&CASE_TABLES[mode], code_point, special);
+    }
+
+    // A code point which has a lowercase form is uppercase, and the other way round.
+    mapped = _case_map_table(&CASE_TABLES[CASE_LOWER], code_point, special);
+    if (mapped != code_point) return mapped;
+    return _case_map_table(&CASE_TABLES[CASE_UPPER], code_point, special);
+}
+
+/**
+ * Internal function to decode the UTF-8 sequence at ``string``. Returns its length, or
+ * ``0`` if it is not a valid sequence (the byte is then kept as it is).
+ */
+static inline int
+_utf8_decode(const unsigned char *string, ssize_t remaining, uint32_t *code_point) {
+    static const uint32_t minimum[] = {0, 0, 0x80, 0x800, 0x10000};
+    int length = string[0] >= 0xF0   ? 4
+                 : string[0] >= 0xE0 ? 3
+                 : string[0] >= 0xC0 ? 2
+                                     : 0;
+
+    if (length == 0 || length > remaining || string[0] > 0xF4) {
+        return 0;
+    }
+
+    *code_point = string[0] & (0x7F >> length);
+    for (int i = 1; i < length; ++i) {
+        if ((string[i] & 0xC0) != 0x80) return 0;
+        *code_point = (*code_point << 6) | (string[i] & 0x3F);
+    }
+    if (*code_point < minimum[length] || *code_point > 0x10FFFF ||
+        (*code_point >= 0xD800 && *code_point <= 0xDFFF)) {
+        return 0;
+    }
+
+    return length;
+}
+
+static inline int
+_utf8_encode(uint32_t code_point, char *output) {
+    if (code_point < 0x80) {
+        output[0] = (char)code_point;
+        return 1;
+    }
+    if (code_point < 0x800) {
+        output[0] = (char)(0xC0 | (code_point >> 6));
+        output[1] = (char)(0x80 | (code_point & 0x3F));
+        return 2;
+    }
+    if (code_point < 0x10000) {
+        output[0] = (char)(0xE0 | (code_point >> 12));
+        output[1] = (char)(0x80 | ((code_point >> 6) & 0x3F));
+        output[2] = (char)(0x80 | (code_point & 0x3F));
+        return 3;
+    }
+    output[0] = (char)(0xF0 | (code_point >> 18));
+    output[1] = (char)(0x80 | ((code_point >> 12) & 0x3F));
+    output[2] = (char)(0x80 | ((code_point >> 6) & 0x3F));
+    output[3] = (char)(0x80 | (code_point & 0x3F));
+    return 4;
+}
+
+static inline char
+_case_map_ascii(CaseModeT mode, char ch) {
+    bool is_upper = ch >= 'A' && ch <= 'Z', is_lower = ch >= 'a' && ch <= 'z';
+
+    switch (mode) {
+    case CASE_UPPER:
+        return is_lower ? ch ^ 0x20 : ch;
+    case CASE_SWAP:
+        return is_lower || is_upper ? ch ^ 0x20 : ch;
+    default:
+        return is_upper ? ch ^ 0x20 : ch;
+    }
+}
+
+#ifdef STRING_SIMD_X86
+/** Internal function returning which of 16 ASCII bytes change case, as ``0xFF`` bytes. */
+static inline __m128i
+_case_ascii_block_flips(CaseModeT mode, __m128i bytes) {
+    __m128i is_upper = _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8('A' - 1)),
+                                     _mm_cmplt_epi8(bytes, _mm_set1_epi8('Z' + 1)));
+    __m128i is_lower = _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8('a' - 1)),
+                                     _mm_cmplt_epi8(bytes, _mm_set1_epi8('z' + 1)));
+
+    return mode == CASE_UPPER  ? is_lower
+           : mode == CASE_SWAP ? _mm_or_si128(is_upper, is_lower)
+                               : is_upper;
+}
+#endif
+
+/**
+ * Map the case of ``length`` bytes of ``string`` into ``output`` and return the length
+ * of the result. When ``output`` is ``NULL`` nothing is written, which measures the
+ * result so that the batch transforms can allocate their output once up front.
+ */
+ssize_t
+string_case_map(const char *string, ssize_t length, CaseModeT mode, char *output) {
+    const unsigned char *bytes = (const unsigned char *)string;
+    ssize_t i = 0, size = 0;
+
+    while (i < length) {
+        ssize_t block_end = length;
+
+#ifdef STRING_SIMD_X86
+        if (i + 16 <= length) {
+            __m128i block = _mm_loadu_si128((const __m128i *)(bytes + i));
+
+            if (!_mm_movemask_epi8(block)) {
+                if (output) {
+                    __m128i flip = _mm_and_si128(_case_ascii_block_flips(mode, block),
+                                                 _mm_set1_epi8(0x20));
+                    _mm_storeu_si128((__m128i *)(output + size),
+                                     _mm_xor_si128(block, flip));
+                }
+                i += 16, size += 16;
+                continue;
+            }
+            block_end = i + 16;
+        }
+#endif
+
+        while (i < block_end) {
+            char mapped[CASE_MAX_MAPPED];
+            const char *special = NULL;
+            uint32_t code_point;
+            int decoded = bytes[i] < 0x80 ? 0 : _utf8_decode(bytes + i, length - i,
+                                                             &code_point);
+            int mapped_length;
+
+            if (decoded == 0) {
+                // ASCII, or an invalid byte which is kept as it is.
+                if (output) {
+                    output[size] = bytes[i] < 0x80 ? _case_map_ascii(mode, bytes[i])
+                                                   : (char)bytes[i];
+                }
+                i++, size++;
+                continue;
+            }
+
+            code_point = _case_map(mode, code_point, &special);
+            if (special) {
+                mapped_length = strlen(special);
+                if (output) memcpy(output + size, special, mapped_length);
+            } else {
+                mapped_length = _utf8_encode(code_point, mapped);
+                if (output) memcpy(output + size, mapped, mapped_length);
+            }
+            i += decoded, size += mapped_length;
+        }
+    }
+
+    return size;
+}
+
+/**
+ * Internal function to map the case of the string into a new string allocated with
+ * the measured size. A string which doesn't change is returned as a
+ * :func:`String_copy`, which shares the buffer of a shared string.
+ */
+static StringT *
+_case_convert(const StringT *self, CaseModeT mode) {
+    ssize_t size = string_case_map(self->string, self->length, mode, NULL);
+    StringT *result = String_new(size + 1);
+
+    result->length = string_case_map(self->string, self->length, mode, result->string);
+    result->string[result->length] = '\0';
+
+    if (result->length == self->length &&
+        memcmp(result->string, self->string, self->length) == 0) {
+        // Unchanged: the result already is a copy, unless the buffer can be shared.
+        if (self->shared) {
+            String_free(result);
+            return String_copy(self);
+        }
+        result->hash = self->hash;
+    }
+
+    return result;
+}
+
+/**
+ * Convert the string to uppercase and return the uppercase string.
+ * The string is treated as UTF-8 and converted with the full Unicode case mapping,
+ * so that e.g. ``ß`` becomes ``SS``. Invalid UTF-8 bytes are kept as they are.
+ *
+ * .. note:: Has time complexity of O(n). Blocks of 16 ASCII bytes are converted at
+ *           once. Context dependent and language specific rules (e.g. Turkish
+ *           dotted i) are not applied. When nothing changes, the result is a
+ *           :func:`String_copy` of the string.
+ *
+ * .. code-block:: c
+ *
+ *    StringT *string = String_from("Hello, Straße");
+ *    StringT *upper_string = String_to_upper(string);
+ *
+ *    assert(String_eq(upper_string, "HELLO, STRASSE"));
+ */
+StringT *
+String_to_upper(const StringT *self) {
+    return _case_convert(self, CASE_UPPER);
+}
+
+/**
+ * Convert the string to lowercase and return the lowercase string.
+ * See :func:`String_to_upper` for more info.
+ *
+ * .. code-block:: c
+ *
+ *    StringT *string = String_from("Hello, ΑΘΗΝΑ");
+ *    StringT *lower_string = String_to_lower(string);
+ *
+ *    assert(String_eq(lower_string, "hello, αθηνα"));
+ */
+StringT *
+String_to_lower(const StringT *self) {
+    return _case_convert(self, CASE_LOWER);
+}
+
+/**
+ * Swap the case of the string and return the new string.
+ * See :func:`String_to_upper` for more info.
+ *
+ * .. code-block:: c
+ *
+ *    StringT *string = String_from("Hello, Ωmega");
+ *    StringT *swapped_string = String_swap_case(string);
+ *
+ *    assert(String_eq(swapped_string, "hELLO, ωMEGA"));
+ */
+StringT *
+String_swap_case(const StringT *self) {
+    return _case_convert(self, CASE_SWAP);
+}
+
+/**
+ * Apply the full Unicode case folding to the string and return the folded string.
+ * Strings which only differ by case fold to the same string, which makes folded
+ * strings suitable as keys for case-insensitive lookups (e.g. ``Straße``,
+ * ``STRASSE`` and ``strasse`` all fold to ``strasse``).
+ *
+ * .. note:: Has time complexity of O(n). See :func:`String_to_upper` for more info.
+ *
+ * .. code-block:: c
+ *
+ *    StringT *string1 = String_from("Straße");
+ *    StringT *string2 = String_from("STRASSE");
+ *
+ *    assert(String_equals(String_case_fold(string1), String_case_fold(string2)));
+ */
+StringT *
+String_case_fold(const StringT *self) {
+    return _case_convert(self, CASE_FOLD);
+}
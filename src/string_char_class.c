@@ -0,0 +1,317 @@
+#include "string_char_class.h"
+
+#include "string_dbg.h"
+#include "string_internal.h"
+#include "string_simd.h"
+
+#include <stdint.h> /* uint32_t, uint64_t */
+#include <string.h> /* memset */
+
+
+/*
+ * Character classes: sets of bytes searched for like ``strpbrk`` / ``strspn``.
+ *
+ * A class is compiled once into a 256 bit bitmap, which answers the scalar membership
+ * test with a shift, and into vector lookups testing 32 bytes at a time with AVX2.
+ * Classes of a few bytes compare every block against each of them. Larger ones look
+ * up the low nibble of each byte in a 16 byte table (one per half of the byte values)
+ * holding, as bits, the high nibbles which are members with that low nibble, and test
+ * the bit of the high nibble: three ``pshufb`` and a blend, whatever the size of the
+ * class. Every search is linear in the length of the searched string.
+ */
+
+/**
+ * Internal function to compile the class of ``length`` bytes into ``self``. Used for
+ * the classes of :func:`String_find_from_char_class`, which live on the stack.
+ */
+void
+string_char_class_init(StringCharClassT *self, const char *characters,
+                       ssize_t length) {
+    memset(self, 0, sizeof *self);
+
+    for (ssize_t i = 0; i < length; ++i) {
+        unsigned char ch = characters[i];
+
+        if (CHAR_CLASS_HAS(self, ch)) continue;
+
+        self->bitmap[ch >> 6] |= 1ull << (ch & 63);
+        if (ch < 0x80) {
+            self->low[ch & 0xF] |= 1 << (ch >> 4);
+        } else {
+            self->high[ch & 0xF] |= 1 << ((ch >> 4) - 8);
+        }
+        if (self->bytes_length < 16) {
+            self->bytes[self->bytes_length] = ch;
+        }
+        self->bytes_length++;
+    }
+
+#ifdef STRING_SIMD_X86
+    self->avx2 = STRING_CPU_HAS("avx2");
+#endif
+}
+
+/**
+ * Compile the bytes of ``characters`` into a character class, to search strings for
+ * any of them. Duplicate bytes are ignored.
+ *
+ * .. code-block:: c
+ *
+ *    StringT *delimiters = String_from(" ,;\t");
+ *    StringCharClassT *class = StringCharClass_new(delimiters);
+ */
+StringCharClassT *
+StringCharClass_new(const StringT *characters) {
+    StringCharClassT *self = malloc(sizeof *self);
+
+    if (self == NULL) {
+        ERR("Unable to allocate memory for `StringCharClassT`");
+    }
+
+    string_char_class_init(self, characters->string, characters->length);
+    return self;
+}
+
+void
+StringCharClass_free(StringCharClassT *self) {
+    free(self);
+}
+
+/** Check if the byte is a member of the class. */
+bool
+StringCharClass_contains(const StringCharClassT *self, char character) {
+    return CHAR_CLASS_HAS(self, character);
+}
+
+#ifdef STRING_SIMD_X86
+/** Internal function to get the mask of the members among the 32 bytes at ``string``. */
+STRING_TARGET("avx2")
+static inline uint32_t
+_char_class_block_avx2(const StringCharClassT *self, __m256i low_table,
+                       __m256i high_table, const char *string) {
+    const __m256i bits =
+        _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128, 1, 2,
+                         4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    __m256i bytes = _mm256_loadu_si256((const __m256i *)string);
+    __m256i low, high, column, bit;
+
+    if (self->bytes_length <= CHAR_CLASS_SMALL) {
+        __m256i found = _mm256_setzero_si256();
+
+        for (int k = 0; k < self->bytes_length; ++k) {
+            found = _mm256_or_si256(
+                found, _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8((char)self->bytes[k])));
+        }
+        return (uint32_t)_mm256_movemask_epi8(found);
+    }
+
+    low = _mm256_and_si256(bytes, _mm256_set1_epi8(0x0F));
+    high = _mm256_and_si256(_mm256_srli_epi16(bytes, 4), _mm256_set1_epi8(0x0F));
+    // The top bit of each byte selects the table of its half of the byte values.
+    column = _mm256_blendv_epi8(_mm256_shuffle_epi8(low_table, low),
+                                _mm256_shuffle_epi8(high_table, low), bytes);
+    bit = _mm256_shuffle_epi8(bits, high);
+
+    return (uint32_t)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(_mm256_and_si256(column, bit), bit));
+}
+
+#define CHAR_CLASS_TABLE(table) \
+    _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(table)))
+
+/**
+ * Internal function to find, by blocks of 32 from ``*index`` up to ``stop``, the first
+ * byte which is a member (or is not, with ``member`` false). Returns its index, or
+ * ``-1`` with ``*index`` moved past the blocks searched.
+ */
+STRING_TARGET("avx2")
+static ssize_t
+_char_class_find_avx2(const StringCharClassT *self, const char *string, ssize_t *index,
+                      ssize_t stop, bool member) {
+    __m256i low_table = CHAR_CLASS_TABLE(self->low);
+    __m256i high_table = CHAR_CLASS_TABLE(self->high);
+    ssize_t i = *index;
+
+    for (; i + 32 <= stop; i += 32) {
+        uint32_t mask = _char_class_block_avx2(self, low_table, high_table, string + i);
+
+        if (!member) mask = ~mask;
+        if (mask) return i + CTZ_64(mask);
+    }
+
+    *index = i;
+    return -1;
+}
+
+/** Internal function to find the last member backwards by blocks of 32, see above. */
+STRING_TARGET("avx2")
+static ssize_t
+_char_class_find_last_avx2(const StringCharClassT *self, const char *string,
+                           ssize_t *stop) {
+    __m256i low_table = CHAR_CLASS_TABLE(self->low);
+    __m256i high_table = CHAR_CLASS_TABLE(self->high);
+    ssize_t i = *stop;
+
+    for (; i >= 32; i -= 32) {
+        uint32_t mask =
+            _char_class_block_avx2(self, low_table, high_table, string + i - 32);
+
+        if (mask) return i - 1 - (CLZ_64(mask) - 32);
+    }
+
+    *stop = i;
+    return -1;
+}
+
+/** Internal function to count the members of blocks of 32, returns the end. */
+STRING_TARGET("avx2")
+static ssize_t
+_char_class_count_avx2(const StringCharClassT *self, const char *string, ssize_t length,
+                       ssize_t *count) {
+    __m256i low_table = CHAR_CLASS_TABLE(self->low);
+    __m256i high_table = CHAR_CLASS_TABLE(self->high);
+    ssize_t i = 0;
+
+    for (; i + 32 <= length; i += 32) {
+        *count += POPCOUNT_64(_char_class_block_avx2(self, low_table, high_table,
+                                                     string + i));
+    }
+
+    return i;
+}
+#endif
+
+/** Internal function to find the first byte from ``start`` up to ``stop`` matching. */
+static ssize_t
+_char_class_find(const StringCharClassT *self, const char *string, ssize_t start,
+                 ssize_t stop, bool member) {
+    ssize_t i = start;
+
+#ifdef STRING_SIMD_X86
+    if (self->avx2) {
+        ssize_t found = _char_class_find_avx2(self, string, &i, stop, member);
+
+        if (found >= 0) return found;
+    }
+#endif
+
+    for (; i < stop; ++i) {
+        if ((bool)CHAR_CLASS_HAS(self, string[i]) == member) return i;
+    }
+
+    return -1;
+}
+
+/**
+ * Internal function to find the first member in ``string[start:stop]``, ``-1`` if
+ * there is none.
+ */
+ssize_t
+string_char_class_find(const StringCharClassT *self, const char *string, ssize_t start,
+                       ssize_t stop) {
+    return _char_class_find(self, string, start, stop, true);
+}
+
+/** Internal function to check ``0 <= position <= string->length``. */
+static void
+_char_class_check_position(const StringT *string, ssize_t position, const char *name) {
+    if (position < 0 || position > string->length) {
+        ERR("%s: position %zd out of range", name, position);
+    }
+}
+
+/**
+ * Find the first byte of the string from ``start`` which is a member of the class,
+ * like ``strpbrk``. Returns its index, or ``-1`` if there is none.
+ *
+ * .. note:: Has time complexity of O(n), whatever the size of the class. With AVX2,
+ *           32 bytes are tested at a time.
+ *
+ * .. code-block:: c
+ *
+ *    StringT *delimiters = String_from(",;");
+ *    StringCharClassT *class = StringCharClass_new(delimiters);
+ *    StringT *string = String_from("key=value;other=1");
+ *
+ *    assert(StringCharClass_find_first(class, string, 0) == 9);
+ *    assert(StringCharClass_find_first(class, string, 10) == -1);
+ */
+ssize_t
+StringCharClass_find_first(const StringCharClassT *self, const StringT *string,
+                           ssize_t start) {
+    _char_class_check_position(string, start, __func__);
+    return _char_class_find(self, string->string, start, string->length, true);
+}
+
+/**
+ * Find the last byte of the string before ``stop`` which is a member of the class.
+ * Returns its index, or ``-1`` if there is none.
+ *
+ * .. code-block:: c
+ *
+ *    StringT *separators = String_from("/\\");
+ *    StringCharClassT *class = StringCharClass_new(separators);
+ *    StringT *path = String_from("usr/local\\bin");
+ *
+ *    assert(StringCharClass_find_last(class, path, path->length) == 9);
+ */
+ssize_t
+StringCharClass_find_last(const StringCharClassT *self, const StringT *string,
+                          ssize_t stop) {
+    _char_class_check_position(string, stop, __func__);
+
+#ifdef STRING_SIMD_X86
+    if (self->avx2) {
+        ssize_t found = _char_class_find_last_avx2(self, string->string, &stop);
+
+        if (found >= 0) return found;
+    }
+#endif
+
+    while (stop-- > 0) {
+        if (CHAR_CLASS_HAS(self, string->string[stop])) return stop;
+    }
+
+    return -1;
+}
+
+/**
+ * Get the length of the run of members of the class starting at ``start``, like
+ * ``strspn``.
+ *
+ * .. code-block:: c
+ *
+ *    StringT *digits = String_from("0123456789");
+ *    StringCharClassT *class = StringCharClass_new(digits);
+ *    StringT *string = String_from("port 8080/tcp");
+ *
+ *    assert(StringCharClass_span(class, string, 5) == 4);
+ */
+ssize_t
+StringCharClass_span(const StringCharClassT *self, const StringT *string,
+                     ssize_t start) {
+    ssize_t end;
+
+    _char_class_check_position(string, start, __func__);
+    end = _char_class_find(self, string->string, start, string->length, false);
+
+    return (end < 0 ? string->length : end) - start;
+}
+
+/** Count the bytes of the string which are members of the class. */
+ssize_t
+StringCharClass_count(const StringCharClassT *self, const StringT *string) {
+    ssize_t i = 0, count = 0;
+
+#ifdef STRING_SIMD_X86
+    if (self->avx2) {
+        i = _char_class_count_avx2(self, string->string, string->length, &count);
+    }
+#endif
+
+    for (; i < string->length; ++i) {
+        count += CHAR_CLASS_HAS(self, string->string[i]);
+    }
+
+    return count;
+}
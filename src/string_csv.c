@@ -0,0 +1,422 @@
+#include "string_csv.h"
+
+#include "string_dbg.h"
+#include "string_internal.h"
+#include "string_simd.h"
+
+#include <stdint.h> /* uint64_t, int64_t */
+#include <stdlib.h> /* malloc, realloc, free */
+#include <string.h> /* memchr, memcpy, memmove */
+
+
+/*
+ * CSV parsing in two stages, after simdcsv.
+ *
+ * The first stage classifies the input 64 bytes at a time into bitmasks of quotes,
+ * delimiters and newlines. Bytes inside quotes are the prefix XOR of the quote mask
+ * (a carry-less multiplication by all ones), carried from one block to the next, and
+ * the delimiters and newlines outside of them are the structural characters whose
+ * positions are recorded. Blocks holding an escape character take a byte by byte
+ * path instead, so inputs without escapes never pay for them.
+ *
+ * The second stage walks the structural positions to cut records into fields, which
+ * are views into the buffer. Unescaping is left to the caller for the few fields
+ * which need it, see :func:`StringCsvParser_unescape`.
+ */
+
+#define CSV_BLOCK 64
+
+struct StringCsvParserT {
+    StringCsvOptionsT options;
+    bool clmul;
+
+    char *buffer;
+    ssize_t length;
+    ssize_t allocated;
+
+    /* First stage: bytes indexed so far and the state at that point. */
+    ssize_t scanned;
+    uint64_t in_quote;
+    bool escaped;
+    bool finished;
+
+    /* Positions of the structural characters, ``position << 1 | is_newline``. */
+    int64_t *structurals;
+    ssize_t structurals_length;
+    ssize_t structurals_allocated;
+    ssize_t structurals_position;
+
+    /* Second stage: start of the next record and the fields of the last one. */
+    ssize_t record_start;
+    StringCsvFieldT *fields;
+    ssize_t fields_allocated;
+};
+
+/**
+ * Create a parser for the given dialect, ``NULL`` selects RFC 4180: fields separated
+ * by ``,``, quoted with ``"`` and quotes escaped by doubling them. Records end with
+ * ``\n`` or ``\r\n``, and blank lines are skipped.
+ *
+ * .. code-block:: c
+ *
+ *    StringCsvOptionsT options = {.delimiter = '\t', .quote = '"', .escape = '\\'};
+ *    StringCsvParserT *parser = StringCsvParser_new(&options);
+ */
+StringCsvParserT *
+StringCsvParser_new(const StringCsvOptionsT *options) {
+    StringCsvParserT *self = malloc(sizeof *self);
+    StringCsvOptionsT dialect = options ? *options : (StringCsvOptionsT){',', '"', '\0'};
+
+    if (self == NULL) {
+        ERR("Unable to allocate memory for `StringCsvParserT`");
+    }
+    if (!dialect.delimiter || dialect.delimiter == '\n' ||
+        dialect.delimiter == dialect.quote || dialect.delimiter == dialect.escape) {
+        ERR("StringCsvParser_new: invalid delimiter");
+    }
+    if (dialect.escape == dialect.quote) {
+        // Doubled quotes are always understood.
+        dialect.escape = '\0';
+    }
+
+    *self = (StringCsvParserT){.options = dialect};
+#ifdef STRING_SIMD_X86
+    self->clmul = STRING_CPU_HAS("pclmul");
+#endif
+
+    return self;
+}
+
+#ifdef STRING_SIMD_X86
+STRING_TARGET("pclmul")
+static uint64_t
+_prefix_xor_clmul(uint64_t bits) {
+    __m128i product = _mm_clmulepi64_si128(_mm_set_epi64x(0, (int64_t)bits),
+                                           _mm_set1_epi8((char)0xFF), 0);
+
+    return (uint64_t)_mm_cvtsi128_si64(product);
+}
+
+/** Internal function to find the bytes of 16 which are equal to ``ch``. */
+static inline uint64_t
+_csv_mask_16(__m128i bytes, char ch) {
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(ch)));
+}
+#endif
+
+/** Internal function to set every bit from each set bit to the next one. */
+static inline uint64_t
+_prefix_xor(uint64_t bits, bool clmul) {
+#ifdef STRING_SIMD_X86
+    if (clmul) {
+        return _prefix_xor_clmul(bits);
+    }
+#else
+    (void)clmul;
+#endif
+
+    for (int shift = 1; shift < 64; shift *= 2) {
+        bits ^= bits << shift;
+    }
+    return bits;
+}
+
+typedef struct {
+    uint64_t quotes;
+    uint64_t delimiters;
+    uint64_t newlines;
+    uint64_t escapes;
+} CsvMasksT;
+
+/** Internal function to classify a block of 64 bytes. */
+static inline CsvMasksT
+_csv_masks(const StringCsvOptionsT *options, const char *block) {
+    CsvMasksT masks = {0, 0, 0, 0};
+
+#ifdef STRING_SIMD_X86
+    for (int i = 0; i < 4; ++i) {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)(block + 16 * i));
+
+        masks.quotes |= _csv_mask_16(bytes, options->quote) << (16 * i);
+        masks.delimiters |= _csv_mask_16(bytes, options->delimiter) << (16 * i);
+        masks.newlines |= _csv_mask_16(bytes, '\n') << (16 * i);
+        masks.escapes |= _csv_mask_16(bytes, options->escape) << (16 * i);
+    }
+#else
+    for (int i = 0; i < CSV_BLOCK; ++i) {
+        masks.quotes |= (uint64_t)(block[i] == options->quote) << i;
+        masks.delimiters |= (uint64_t)(block[i] == options->delimiter) << i;
+        masks.newlines |= (uint64_t)(block[i] == '\n') << i;
+        masks.escapes |= (uint64_t)(block[i] == options->escape) << i;
+    }
+#endif
+
+    // A disabled quote or escape character matches no byte, not the NUL ones.
+    if (!options->quote) masks.quotes = 0;
+    if (!options->escape) masks.escapes = 0;
+    return masks;
+}
+
+/** Internal function to record the structural positions of a block. */
+static void
+_csv_record_structurals(StringCsvParserT *self, ssize_t position, uint64_t structural,
+                        uint64_t newlines) {
+    ssize_t needed = self->structurals_length + POPCOUNT_64(structural);
+
+    if (needed > self->structurals_allocated) {
+        self->structurals_allocated = GROW_CAPACITY(needed);
+        self->structurals = realloc(self->structurals, self->structurals_allocated *
+                                                           sizeof *self->structurals);
+        if (self->structurals == NULL) {
+            ERR("Unable to allocate memory for CSV structural positions");
+        }
+    }
+
+    for (; structural; structural &= structural - 1) {
+        int bit = CTZ_64(structural);
+
+        self->structurals[self->structurals_length++] =
+            (int64_t)(position + bit) << 1 | ((newlines >> bit) & 1);
+    }
+}
+
+/** Internal function to run the first stage on the ``valid`` bytes of ``block``. */
+static void
+_csv_scan_block(StringCsvParserT *self, const char *block, ssize_t valid) {
+    uint64_t valid_mask = valid == CSV_BLOCK ? ~0ull : (1ull << valid) - 1;
+    CsvMasksT masks = _csv_masks(&self->options, block);
+    uint64_t inside = 0, escaped = 0;
+
+    masks.quotes &= valid_mask;
+    masks.escapes &= valid_mask;
+
+    if (!masks.escapes && !self->escaped) {
+        inside = _prefix_xor(masks.quotes, self->clmul) ^ self->in_quote;
+        self->in_quote = (uint64_t)((int64_t)inside >> 63);
+    } else {
+        // Escapes change which quotes count, follow them byte by byte.
+        for (ssize_t i = 0; i < valid; ++i) {
+            uint64_t bit = 1ull << i;
+
+            if (self->escaped) {
+                escaped |= bit;
+                self->escaped = false;
+            } else if (masks.escapes & bit) {
+                self->escaped = true;
+            } else if (masks.quotes & bit) {
+                self->in_quote = ~self->in_quote;
+            }
+            inside |= self->in_quote & bit;
+        }
+        if (valid < CSV_BLOCK && self->in_quote) {
+            inside |= ~valid_mask;
+        }
+    }
+
+    _csv_record_structurals(self, self->scanned,
+                            (masks.delimiters | masks.newlines) & ~inside & ~escaped &
+                                valid_mask,
+                            masks.newlines);
+    self->scanned += valid;
+}
+
+/** Internal function to index every complete block, and the rest once finished. */
+static void
+_csv_scan(StringCsvParserT *self) {
+    char tail[CSV_BLOCK] = {0};
+
+    while (self->scanned + CSV_BLOCK <= self->length) {
+        _csv_scan_block(self, self->buffer + self->scanned, CSV_BLOCK);
+    }
+
+    if (self->finished && self->scanned < self->length) {
+        memcpy(tail, self->buffer + self->scanned, self->length - self->scanned);
+        _csv_scan_block(self, tail, self->length - self->scanned);
+    }
+}
+
+/**
+ * Internal function to drop the bytes of the records already returned, so the buffer
+ * only grows with the size of the records in flight.
+ */
+static void
+_csv_compact(StringCsvParserT *self) {
+    ssize_t consumed = self->record_start;
+    ssize_t kept = 0;
+
+    memmove(self->buffer, self->buffer + consumed, self->length - consumed);
+    self->length -= consumed;
+    self->scanned -= consumed;
+
+    for (ssize_t i = self->structurals_position; i < self->structurals_length; ++i) {
+        self->structurals[kept++] = self->structurals[i] - ((int64_t)consumed << 1);
+    }
+    self->structurals_length = kept;
+    self->structurals_position = 0;
+    self->record_start = 0;
+}
+
+/**
+ * Append ``length`` bytes of input to the parser and index them. The input may be
+ * cut anywhere, even inside a field or a quoted string.
+ *
+ * .. note:: Invalidates the records returned so far. Records are returned by
+ *           :func:`StringCsvParser_next` once the 64 bytes block holding their end
+ *           was fed, the rest is returned after :func:`StringCsvParser_finish`.
+ */
+void
+StringCsvParser_feed(StringCsvParserT *self, const char *data, ssize_t length) {
+    if (self->finished) {
+        ERR("StringCsvParser_feed: the parser is already finished");
+    }
+    if (self->record_start) {
+        _csv_compact(self);
+    }
+
+    if (self->length + length > self->allocated) {
+        self->allocated = GROW_CAPACITY(self->length + length);
+        self->buffer = realloc(self->buffer, self->allocated);
+        if (self->buffer == NULL) {
+            ERR("Unable to allocate memory for CSV buffer");
+        }
+    }
+
+    memcpy(self->buffer + self->length, data, length);
+    self->length += length;
+    _csv_scan(self);
+}
+
+/** Mark the end of the input, the last record may then lack its newline. */
+void
+StringCsvParser_finish(StringCsvParserT *self) {
+    self->finished = true;
+    _csv_scan(self);
+}
+
+/** Internal function to store field ``index`` of the record being cut. */
+static void
+_csv_add_field(StringCsvParserT *self, ssize_t index, ssize_t start, ssize_t stop,
+               bool record_end) {
+    const StringCsvOptionsT *options = &self->options;
+    const char *buffer = self->buffer;
+    StringCsvFieldT *field;
+
+    if (index >= self->fields_allocated) {
+        self->fields_allocated = GROW_CAPACITY(index + 1);
+        self->fields =
+            realloc(self->fields, self->fields_allocated * sizeof *self->fields);
+        if (self->fields == NULL) {
+            ERR("Unable to allocate memory for CSV fields");
+        }
+    }
+    field = &self->fields[index];
+
+    if (record_end && stop > start && buffer[stop - 1] == '\r') {
+        stop--;
+    }
+
+    field->quoted = options->quote && stop > start && buffer[start] == options->quote;
+    if (field->quoted) {
+        start++;
+        if (stop > start && buffer[stop - 1] == options->quote) stop--;
+    }
+
+    field->string = buffer + start;
+    field->length = stop - start;
+    field->escaped =
+        (field->quoted && memchr(field->string, options->quote, field->length)) ||
+        (options->escape && memchr(field->string, options->escape, field->length));
+}
+
+/**
+ * Cut the next complete record. Returns ``false`` when every complete record was
+ * returned, feed more input or finish the parser to get the next ones.
+ *
+ * .. note:: The fields are views into the parser, valid until the next call to
+ *           :func:`StringCsvParser_next` or :func:`StringCsvParser_feed`. Quoted
+ *           fields are returned without their quotes.
+ *
+ * .. code-block:: c
+ *
+ *    StringCsvParserT *parser = StringCsvParser_new(NULL);
+ *    StringCsvRecordT record;
+ *
+ *    StringCsvParser_feed(parser, "a,\"b,c\"\n", 8);
+ *    StringCsvParser_finish(parser);
+ *    assert(StringCsvParser_next(parser, &record) && record.length == 2);
+ *    assert(record.fields[1].length == 3);
+ */
+bool
+StringCsvParser_next(StringCsvParserT *self, StringCsvRecordT *record) {
+    for (;;) {
+        ssize_t position = self->structurals_position, start = self->record_start;
+        ssize_t length = 0;
+        bool complete = false;
+
+        while (!complete && position < self->structurals_length) {
+            int64_t structural = self->structurals[position++];
+            ssize_t stop = structural >> 1;
+
+            complete = structural & 1;
+            _csv_add_field(self, length++, start, stop, complete);
+            start = stop + 1;
+        }
+
+        if (!complete) {
+            if (!self->finished || (start >= self->length && !length)) {
+                return false;
+            }
+            _csv_add_field(self, length++, start, self->length, true);
+            start = self->length;
+        }
+
+        self->structurals_position = position;
+        self->record_start = start;
+
+        // Skip blank lines.
+        if (length == 1 && !self->fields[0].length && !self->fields[0].quoted) {
+            continue;
+        }
+
+        *record = (StringCsvRecordT){.fields = self->fields, .length = length};
+        return true;
+    }
+}
+
+/**
+ * Return a new ``StringT`` with the escapes of the field resolved: doubled quotes of
+ * quoted fields and, when the dialect has one, escape characters. Only fields whose
+ * ``escaped`` flag is set need it, the others can be used as they are.
+ */
+StringT *
+StringCsvParser_unescape(const StringCsvParserT *self, const StringCsvFieldT *field) {
+    const StringCsvOptionsT *options = &self->options;
+    StringT *string = String_new(field->length + 1);
+    char *cursor = string->string;
+
+    for (ssize_t i = 0; i < field->length; ++i) {
+        char ch = field->string[i];
+
+        if (options->escape && ch == options->escape && i + 1 < field->length) {
+            ch = field->string[++i];
+        } else if (field->quoted && ch == options->quote && i + 1 < field->length &&
+                   field->string[i + 1] == options->quote) {
+            i++;
+        }
+        *cursor++ = ch;
+    }
+
+    *cursor = '\0';
+    string->length = cursor - string->string;
+
+    return string;
+}
+
+/** De-allocate the parser and its buffers, invalidating the records returned. */
+void
+StringCsvParser_free(StringCsvParserT *self) {
+    free(self->buffer);
+    free(self->structurals);
+    free(self->fields);
+    free(self);
+}
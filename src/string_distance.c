@@ -0,0 +1,334 @@
+#include "string_ext.h"
+
+#include "string_dbg.h"
+#include "string_internal.h"
+
+#include <stdint.h> /* uint64_t */
+#include <stdlib.h> /* malloc, free */
+#include <string.h> /* memset */
+
+
+/*
+ * Levenshtein distance and approximate search, with the bit-parallel algorithm of
+ * Myers as formulated by Hyyrö.
+ *
+ * A column of the dynamic programming matrix (one row per byte of the pattern) is
+ * kept as two bit vectors of its vertical deltas, +1 and -1, and advanced by one byte
+ * of the text with a few word operations, using precomputed masks of the positions of
+ * every byte value in the pattern. Patterns of up to 64 bytes fit in one machine word
+ * and have their own loop; longer ones are split into blocks of 64 rows chained by the
+ * horizontal delta leaving each block. Only the score of the last row is tracked, in
+ * O(n * ceil(m / 64)) time.
+ *
+ * Distances are counted in bytes, a multibyte UTF-8 character counts as several.
+ */
+
+/// Words of a column kept on the stack, longer patterns allocate theirs.
+#define EDIT_STACK_WORDS 8
+
+/// Vertical deltas of a column, ``+1`` in ``vp`` and ``-1`` in ``vn``.
+typedef struct {
+    uint64_t *vp;
+    uint64_t *vn;
+    uint64_t stack[2 * EDIT_STACK_WORDS];
+} EditColumnT;
+
+/**
+ * Internal function to compile the masks of the pattern. Patterns of one word use
+ * the storage of ``self``, which must then not be copied.
+ */
+void
+string_edit_pattern_init(StringEditPatternT *self, const char *pattern,
+                         ssize_t length) {
+    self->length = length;
+    self->words = (length + 63) / 64;
+    self->last_bit = 1ull << ((length - 1) & 63);
+    self->masks = self->single;
+
+    if (self->words > 1) {
+        self->masks = malloc(256 * self->words * sizeof *self->masks);
+        if (self->masks == NULL) {
+            ERR("Unable to allocate memory for the edit distance masks");
+        }
+    }
+    memset(self->masks, 0, 256 * MAX_2(self->words, 1) * sizeof *self->masks);
+
+    for (ssize_t i = 0; i < length; ++i) {
+        unsigned char ch = pattern[i];
+
+        self->masks[ch * self->words + i / 64] |= 1ull << (i & 63);
+    }
+}
+
+void
+string_edit_pattern_free(StringEditPatternT *self) {
+    if (self->masks != self->single) {
+        free(self->masks);
+    }
+}
+
+/** Internal function to start a column where row ``i`` holds ``i``. */
+static void
+_edit_column_init(EditColumnT *self, ssize_t words) {
+    self->vp = self->stack;
+    if (words > EDIT_STACK_WORDS) {
+        self->vp = malloc(2 * words * sizeof *self->vp);
+        if (self->vp == NULL) {
+            ERR("Unable to allocate memory for the edit distance column");
+        }
+    }
+    self->vn = self->vp + words;
+
+    for (ssize_t w = 0; w < words; ++w) {
+        self->vp[w] = ~0ull;
+        self->vn[w] = 0;
+    }
+}
+
+static void
+_edit_column_free(EditColumnT *self) {
+    if (self->vp != self->stack) {
+        free(self->vp);
+    }
+}
+
+/**
+ * Internal function to advance a column of one word by the byte ``ch``. ``carry`` is
+ * the horizontal delta entering the first row: ``1`` for the distance between whole
+ * strings, ``0`` for a search. Returns the change of the score of the last row.
+ */
+static inline int
+_edit_step_word(const StringEditPatternT *self, EditColumnT *column, unsigned char ch,
+                int carry) {
+    uint64_t vp = *column->vp, vn = *column->vn;
+    uint64_t eq = self->masks[ch], xv = eq | vn;
+    uint64_t xh = (((eq & vp) + vp) ^ vp) | eq;
+    uint64_t hp = vn | ~(xh | vp), hn = vp & xh;
+    int out = (hp & self->last_bit) ? 1 : (hn & self->last_bit) ? -1 : 0;
+
+    hp = hp << 1 | (uint64_t)carry;
+    hn <<= 1;
+    *column->vp = hn | ~(xv | hp);
+    *column->vn = hp & xv;
+
+    return out;
+}
+
+/** Internal function to advance a column of several words, see above. */
+static inline int
+_edit_step_blocks(const StringEditPatternT *self, EditColumnT *column, unsigned char ch,
+                  int carry) {
+    const uint64_t *masks = self->masks + ch * self->words;
+    uint64_t *vp = column->vp, *vn = column->vn;
+
+    for (ssize_t w = 0; w < self->words; ++w) {
+        uint64_t eq = masks[w], xv = eq | vn[w], xh, hp, hn;
+        uint64_t bit = w + 1 < self->words ? 1ull << 63 : self->last_bit;
+        int out;
+
+        // A -1 entering the block acts as a match on its first row.
+        if (carry < 0) eq |= 1;
+        xh = (((eq & vp[w]) + vp[w]) ^ vp[w]) | eq;
+        hp = vn[w] | ~(xh | vp[w]);
+        hn = vp[w] & xh;
+        out = (hp & bit) ? 1 : (hn & bit) ? -1 : 0;
+
+        hp = hp << 1 | (uint64_t)(carry > 0);
+        hn = hn << 1 | (uint64_t)(carry < 0);
+        vp[w] = hn | ~(xv | hp);
+        vn[w] = hp & xv;
+        carry = out;
+    }
+
+    return carry;
+}
+
+static inline int
+_edit_step(const StringEditPatternT *self, EditColumnT *column, unsigned char ch,
+           int carry) {
+    return self->words == 1 ? _edit_step_word(self, column, ch, carry)
+                            : _edit_step_blocks(self, column, ch, carry);
+}
+
+/**
+ * Internal function to compute the distance between the compiled pattern and the
+ * text, or ``-1`` as soon as it is known to exceed ``max_distance`` (if >= 0).
+ */
+ssize_t
+string_edit_distance(const StringEditPatternT *self, const char *text, ssize_t length,
+                     ssize_t max_distance) {
+    bool bounded = max_distance >= 0;
+    ssize_t score = self->length;
+    EditColumnT column;
+
+    if (bounded && labs(length - self->length) > max_distance) return -1;
+    if (self->length == 0) return length;
+
+    _edit_column_init(&column, self->words);
+    for (ssize_t j = 0; j < length; ++j) {
+        score += _edit_step(self, &column, text[j], 1);
+
+        // Each of the bytes left can lower the score by one at most.
+        if (bounded && score - (length - j - 1) > max_distance) {
+            score = -1;
+            break;
+        }
+    }
+    _edit_column_free(&column);
+
+    return score;
+}
+
+/**
+ * Compute the Levenshtein distance between the two strings: the least number of
+ * bytes to insert, delete or substitute to turn one into the other.
+ *
+ * .. note:: Has time complexity of O(n * ceil(m / 64)) where m is the length of the
+ *           shorter string, O(n) when it holds at most 64 bytes.
+ *
+ * .. code-block:: c
+ *
+ *    StringT *string = String_from("kitten");
+ *    StringT *other = String_from("sitting");
+ *
+ *    assert(String_levenshtein(string, other) == 3);
+ */
+ssize_t
+String_levenshtein(const StringT *self, const StringT *other) {
+    return String_levenshtein_bounded(self, other, -1);
+}
+
+/**
+ * Compute the Levenshtein distance between the two strings if it is at most
+ * ``max_distance``, else return ``-1``. A negative ``max_distance`` sets no bound.
+ * See :func:`String_levenshtein`.
+ *
+ * .. note:: Strings whose lengths differ by more than the bound are rejected at
+ *           once, the others as soon as the distance can no longer fit the bound.
+ *
+ * .. code-block:: c
+ *
+ *    StringT *string = String_from("recieve");
+ *    StringT *other = String_from("receive");
+ *
+ *    assert(String_levenshtein_bounded(string, other, 2) == 2);
+ *    assert(String_levenshtein_bounded(string, other, 1) == -1);
+ */
+ssize_t
+String_levenshtein_bounded(const StringT *self, const StringT *other,
+                           ssize_t max_distance) {
+    StringEditPatternT pattern;
+    ssize_t distance;
+
+    // The shorter string is the pattern, the one which has to fit in the words.
+    if (self->length > other->length) {
+        const StringT *swap = self;
+
+        self = other;
+        other = swap;
+    }
+
+    if (max_distance >= 0 && other->length - self->length > max_distance) return -1;
+
+    string_edit_pattern_init(&pattern, self->string, self->length);
+    distance = string_edit_distance(&pattern, other->string, other->length, max_distance);
+    string_edit_pattern_free(&pattern);
+
+    return distance;
+}
+
+/**
+ * Internal function to find the first end of a match of the pattern in the text with
+ * at most ``max_errors`` errors, ``-1`` if there is none. Empty matches are skipped.
+ */
+static ssize_t
+_edit_search(const StringEditPatternT *self, const char *text, ssize_t length,
+             ssize_t max_errors) {
+    ssize_t score = self->length, end = -1;
+    EditColumnT column;
+
+    _edit_column_init(&column, self->words);
+    for (ssize_t j = 0; j < length; ++j) {
+        score += _edit_step(self, &column, text[j], 0);
+        if (score <= max_errors) {
+            end = j + 1;
+            break;
+        }
+    }
+    _edit_column_free(&column);
+
+    return end;
+}
+
+/**
+ * Internal function to find the start of the best match ending at ``end``, with the
+ * reversed pattern matched against the text read backwards from ``end``.
+ */
+static ssize_t
+_edit_match_start(const StringEditPatternT *reversed, const char *text, ssize_t end,
+                  ssize_t max_errors) {
+    ssize_t window = MIN_2(end, reversed->length + max_errors);
+    ssize_t score = reversed->length, best = -1, best_length = 0;
+    EditColumnT column;
+
+    _edit_column_init(&column, reversed->words);
+    for (ssize_t j = 0; j < window; ++j) {
+        score += _edit_step(reversed, &column, text[end - 1 - j], 1);
+        if (best < 0 || score < best) {
+            best = score;
+            best_length = j + 1;
+        }
+    }
+    _edit_column_free(&column);
+
+    return end - best_length;
+}
+
+/**
+ * Find the first approximate occurrence of the pattern in the string: a substring at
+ * Levenshtein distance of at most ``max_errors`` from the pattern. Returns the index
+ * of the substring, ``StringIndex(0, 0, 1)`` if there is none.
+ *
+ * The match is the one ending first; among the substrings ending there, the closest
+ * to the pattern and then the shortest. Matches are never empty, so an empty pattern
+ * is never found.
+ *
+ * .. note:: Has time complexity of O(n * ceil(m / 64)) where m is the length of the
+ *           pattern.
+ *
+ * .. code-block:: c
+ *
+ *    StringT *string = String_from("please recieve the parcel");
+ *    StringT *pattern = String_from("receive");
+ *    StringIndexT index = String_fuzzy_contains(string, pattern, 2);
+ *
+ *    assert(StringIndex_eq(index, StringIndex(7, 12))); // "recie"
+ */
+StringIndexT
+String_fuzzy_contains(const StringT *self, const StringT *pattern, ssize_t max_errors) {
+    StringEditPatternT compiled, reversed;
+    ssize_t start, end;
+    char *reversed_string;
+
+    if (max_errors < 0) ERR("String_fuzzy_contains: max_errors must be >= 0");
+    if (pattern->length == 0) return StringIndex(0, 0, 1);
+
+    string_edit_pattern_init(&compiled, pattern->string, pattern->length);
+    end = _edit_search(&compiled, self->string, self->length, max_errors);
+    string_edit_pattern_free(&compiled);
+    if (end < 0) return StringIndex(0, 0, 1);
+
+    reversed_string = malloc(pattern->length);
+    if (reversed_string == NULL) {
+        ERR("Unable to allocate memory for `char *`");
+    }
+    for (ssize_t i = 0; i < pattern->length; ++i) {
+        reversed_string[i] = pattern->string[pattern->length - 1 - i];
+    }
+    string_edit_pattern_init(&reversed, reversed_string, pattern->length);
+    start = _edit_match_start(&reversed, self->string, end, max_errors);
+    string_edit_pattern_free(&reversed);
+    free(reversed_string);
+
+    return StringIndex(start, end);
+}
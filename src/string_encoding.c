@@ -0,0 +1,620 @@
+#include "string_ext.h"
+
+#include "string_internal.h"
+#include "string_simd.h"
+
+#include <stdint.h> /* uint8_t, uint32_t */
+
+
+/*
+ * Base64 (RFC 4648, standard and URL-safe alphabets) and hexadecimal encoding of
+ * binary data held in a ``StringT``.
+ *
+ * The size of the result is known from the input alone, so it is allocated (or the
+ * caller's ``StringT`` grown) exactly once before being written. With AVX2 the bulk of
+ * the data goes through vectorised kernels: base64 encodes 24 bytes into 32 characters
+ * and decodes 32 characters into 24 bytes at a time, reshuffling the 6 bit groups
+ * with multiplications instead of shifts; hexadecimal splits the nibbles and maps them
+ * with ``pshufb``. The remainder, and builds without AVX2, use table driven scalar
+ * loops giving the same results.
+ */
+
+#define BASE64_INVALID 0xFF
+
+static const char BASE64_STANDARD[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char BASE64_URL[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+/// Value of each ASCII character in the standard alphabet, ``BASE64_INVALID`` if none.
+static const uint8_t BASE64_STANDARD_VALUES[128] = {
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 62,  255, 255, 255, 63,
+    52,  53,  54,  55,  56,  57,  58,  59,  60,  61,  255, 255, 255, 255, 255, 255,
+    255, 0,   1,   2,   3,   4,   5,   6,   7,   8,   9,   10,  11,  12,  13,  14,
+    15,  16,  17,  18,  19,  20,  21,  22,  23,  24,  25,  255, 255, 255, 255, 255,
+    255, 26,  27,  28,  29,  30,  31,  32,  33,  34,  35,  36,  37,  38,  39,  40,
+    41,  42,  43,  44,  45,  46,  47,  48,  49,  50,  51,  255, 255, 255, 255, 255,
+};
+
+/// Value of each ASCII character in the URL-safe alphabet.
+static const uint8_t BASE64_URL_VALUES[128] = {
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 62,  255, 255,
+    52,  53,  54,  55,  56,  57,  58,  59,  60,  61,  255, 255, 255, 255, 255, 255,
+    255, 0,   1,   2,   3,   4,   5,   6,   7,   8,   9,   10,  11,  12,  13,  14,
+    15,  16,  17,  18,  19,  20,  21,  22,  23,  24,  25,  255, 255, 255, 255, 63,
+    255, 26,  27,  28,  29,  30,  31,  32,  33,  34,  35,  36,  37,  38,  39,  40,
+    41,  42,  43,  44,  45,  46,  47,  48,  49,  50,  51,  255, 255, 255, 255, 255,
+};
+
+#define BASE64_VALUE(values, ch) \
+    ((unsigned char)(ch) < 0x80 ? (values)[(unsigned char)(ch)] : BASE64_INVALID)
+
+#ifdef STRING_SIMD_X86
+/// Bytes of ``x`` from ``lo`` to ``hi``, signed: bytes from 0x80 are in no ASCII range.
+#define AVX2_IN_RANGE(x, lo, hi)                                           \
+    _mm256_and_si256(_mm256_cmpgt_epi8((x), _mm256_set1_epi8((lo) - 1)), \
+                     _mm256_cmpgt_epi8(_mm256_set1_epi8((hi) + 1), (x)))
+#endif
+
+/* Base64 encoding */
+
+#ifdef STRING_SIMD_X86
+/**
+ * Internal function to encode ``length / 24`` blocks (as many as can be loaded 32
+ * bytes at a time) of ``data``, returns the number of bytes consumed.
+ */
+STRING_TARGET("avx2")
+static ssize_t
+_base64_encode_avx2(const uint8_t *data, ssize_t length, char *cursor,
+                    const char *alphabet) {
+    // Offsets from the 6 bit values to their characters, indexed as explained below.
+    const __m256i offsets = _mm256_setr_epi8(
+        'A', 'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, alphabet[62] - 62, alphabet[63] - 63, 0,
+        0, 'A', 'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, alphabet[62] - 62, alphabet[63] - 63, 0,
+        0);
+    ssize_t i = 0;
+
+    for (; i + 32 <= length; i += 24, cursor += 32) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i *)(data + i));
+        __m256i values, index;
+
+        // Bytes 0..11 to the top of the low lane, 12..23 to the bottom of the high one.
+        bytes = _mm256_permutevar8x32_epi32(bytes,
+                                            _mm256_setr_epi32(0, 0, 1, 2, 3, 4, 5, 6));
+        // Every 3 bytes ``abc`` become the 32 bit word ``b a c b``.
+        bytes = _mm256_shuffle_epi8(
+            bytes, _mm256_setr_epi8(5, 4, 6, 5, 8, 7, 9, 8, 11, 10, 12, 11, 14, 13, 15,
+                                    14, 1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11,
+                                    10));
+        // Move the four 6 bit groups of each word to their own byte.
+        values = _mm256_or_si256(
+            _mm256_mulhi_epu16(_mm256_and_si256(bytes, _mm256_set1_epi32(0x0FC0FC00)),
+                               _mm256_set1_epi32(0x04000040)),
+            _mm256_mullo_epi16(_mm256_and_si256(bytes, _mm256_set1_epi32(0x003F03F0)),
+                               _mm256_set1_epi32(0x01000010)));
+
+        // 0..25 -> 0, 26..51 -> 1, 52..61 -> 2..11, 62 -> 12 and 63 -> 13.
+        index = _mm256_subs_epu8(values, _mm256_set1_epi8(51));
+        index = _mm256_sub_epi8(index, _mm256_cmpgt_epi8(values, _mm256_set1_epi8(25)));
+        _mm256_storeu_si256((__m256i *)cursor,
+                            _mm256_add_epi8(values, _mm256_shuffle_epi8(offsets, index)));
+    }
+
+    return i;
+}
+#endif
+
+/** Internal function to measure the encoded data. */
+static ssize_t
+_base64_encoded_length(ssize_t length, int flags) {
+    if (flags & STRING_BASE64_NO_PADDING) {
+        return length / 3 * 4 + (length % 3 ? length % 3 + 1 : 0);
+    }
+    return (length + 2) / 3 * 4;
+}
+
+/** Internal function to write the encoded data to ``cursor``. */
+static void
+_base64_encode_write(const StringT *self, int flags, char *cursor) {
+    const char *alphabet = flags & STRING_BASE64_URL ? BASE64_URL : BASE64_STANDARD;
+    const uint8_t *data = (const uint8_t *)self->string;
+    ssize_t i = 0, length = self->length;
+
+#ifdef STRING_SIMD_X86
+    if (length >= 64 && STRING_CPU_HAS("avx2")) {
+        i = _base64_encode_avx2(data, length, cursor, alphabet);
+        cursor += i / 3 * 4;
+    }
+#endif
+
+    for (; i + 3 <= length; i += 3, cursor += 4) {
+        uint32_t group = (uint32_t)data[i] << 16 | data[i + 1] << 8 | data[i + 2];
+
+        cursor[0] = alphabet[group >> 18];
+        cursor[1] = alphabet[(group >> 12) & 0x3F];
+        cursor[2] = alphabet[(group >> 6) & 0x3F];
+        cursor[3] = alphabet[group & 0x3F];
+    }
+
+    if (i < length) {
+        uint32_t group = (uint32_t)data[i] << 16;
+
+        if (i + 1 < length) group |= data[i + 1] << 8;
+
+        *cursor++ = alphabet[group >> 18];
+        *cursor++ = alphabet[(group >> 12) & 0x3F];
+        if (i + 1 < length) {
+            *cursor++ = alphabet[(group >> 6) & 0x3F];
+        } else if (!(flags & STRING_BASE64_NO_PADDING)) {
+            *cursor++ = '=';
+        }
+        if (!(flags & STRING_BASE64_NO_PADDING)) {
+            *cursor = '=';
+        }
+    }
+}
+
+/**
+ * Encode the string in base64 and append the result to ``output``.
+ * See :func:`String_base64_encode`.
+ *
+ * .. note:: ``output`` is grown at most once, by the exact size of the result.
+ */
+void
+String_base64_encode_into(StringT *output, const StringT *self, int flags) {
+    ssize_t size = _base64_encoded_length(self->length, flags);
+
+    _base64_encode_write(self, flags, string_reserve_tail(output, size));
+    output->length += size;
+    output->string[output->length] = '\0';
+}
+
+/**
+ * Encode the bytes of the string in base64 and return the encoded string.
+ * ``flags`` is a combination of:
+ *
+ * - ``STRING_BASE64_URL`` to use the URL-safe alphabet, ``-`` and ``_`` instead of
+ *   ``+`` and ``/``.
+ * - ``STRING_BASE64_NO_PADDING`` to leave out the trailing ``=``.
+ *
+ * .. note:: Has time complexity of O(n). The result is allocated exactly once and,
+ *           with AVX2, 24 bytes are encoded at a time.
+ *
+ * .. code-block:: c
+ *
+ *    StringT *string = String_from("foob");
+ *    StringT *encoded = String_base64_encode(string, STRING_BASE64_DEFAULT);
+ *
+ *    assert(String_eq(encoded, "Zm9vYg=="));
+ */
+StringT *
+String_base64_encode(const StringT *self, int flags) {
+    ssize_t size = _base64_encoded_length(self->length, flags);
+    StringT *output = String_new(size + 1);
+
+    _base64_encode_write(self, flags, output->string);
+    output->length = size;
+    output->string[size] = '\0';
+
+    return output;
+}
+
+/* Base64 decoding */
+
+#ifdef STRING_SIMD_X86
+/**
+ * Internal function to decode blocks of 32 characters, stopping before one would be
+ * written past ``size`` bytes or holds a character outside of the alphabet. Returns
+ * the number of characters consumed.
+ */
+STRING_TARGET("avx2")
+static ssize_t
+_base64_decode_avx2(const char *string, ssize_t length, uint8_t *cursor, ssize_t size,
+                    const char *alphabet) {
+    const __m256i char_62 = _mm256_set1_epi8(alphabet[62]);
+    const __m256i char_63 = _mm256_set1_epi8(alphabet[63]);
+    ssize_t i = 0;
+
+    // Every block writes 32 bytes of which 24 are decoded data.
+    for (; i + 32 <= length && i / 4 * 3 + 32 <= size; i += 32, cursor += 24) {
+        __m256i chars = _mm256_loadu_si256((const __m256i *)(string + i));
+        __m256i upper = AVX2_IN_RANGE(chars, 'A', 'Z');
+        __m256i lower = AVX2_IN_RANGE(chars, 'a', 'z');
+        __m256i digit = AVX2_IN_RANGE(chars, '0', '9');
+        __m256i is_62 = _mm256_cmpeq_epi8(chars, char_62);
+        __m256i is_63 = _mm256_cmpeq_epi8(chars, char_63);
+        __m256i valid = _mm256_or_si256(
+            _mm256_or_si256(upper, lower),
+            _mm256_or_si256(digit, _mm256_or_si256(is_62, is_63)));
+        __m256i offsets, values;
+
+        if ((uint32_t)_mm256_movemask_epi8(valid) != 0xFFFFFFFF) break;
+
+        offsets = _mm256_or_si256(
+            _mm256_or_si256(_mm256_and_si256(upper, _mm256_set1_epi8(-'A')),
+                            _mm256_and_si256(lower, _mm256_set1_epi8(26 - 'a'))),
+            _mm256_and_si256(digit, _mm256_set1_epi8(52 - '0')));
+        offsets = _mm256_or_si256(
+            offsets, _mm256_and_si256(is_62, _mm256_set1_epi8(62 - alphabet[62])));
+        offsets = _mm256_or_si256(
+            offsets, _mm256_and_si256(is_63, _mm256_set1_epi8(63 - alphabet[63])));
+        values = _mm256_add_epi8(chars, offsets);
+
+        // Pack the four 6 bit values of each 32 bit word into 24 bits, big endian.
+        values = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+        values = _mm256_madd_epi16(values, _mm256_set1_epi32(0x00011000));
+        values = _mm256_shuffle_epi8(
+            values, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1,
+                                     -1, 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1,
+                                     -1, -1));
+        values = _mm256_permutevar8x32_epi32(values,
+                                             _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+        _mm256_storeu_si256((__m256i *)cursor, values);
+    }
+
+    return i;
+}
+#endif
+
+/**
+ * Internal function to measure the decoded data. Sets ``*data_length`` to the number
+ * of characters without the padding and returns the decoded size, or ``-1`` if the
+ * length or the padding is invalid for ``flags``.
+ */
+static ssize_t
+_base64_decoded_length(const StringT *self, int flags, ssize_t *data_length) {
+    ssize_t length = self->length, padding = 0;
+
+    while (padding < 2 && length > 0 && self->string[length - 1] == '=') {
+        length--;
+        padding++;
+    }
+
+    if (length % 4 == 1) return -1;
+    if (padding) {
+        // Padding, when present, completes the last group.
+        if ((length + padding) % 4) return -1;
+        if ((flags & STRING_BASE64_NO_PADDING) && !(flags & STRING_BASE64_LENIENT)) {
+            return -1;
+        }
+    } else if (length % 4 &&
+               !(flags & (STRING_BASE64_NO_PADDING | STRING_BASE64_LENIENT))) {
+        return -1;
+    }
+
+    *data_length = length;
+    return length / 4 * 3 + (length % 4 ? length % 4 - 1 : 0);
+}
+
+/** Internal function to decode ``length`` characters, ``false`` if one is invalid. */
+static bool
+_base64_decode_write(const char *string, ssize_t length, ssize_t size, int flags,
+                     uint8_t *cursor) {
+    const uint8_t *values =
+        flags & STRING_BASE64_URL ? BASE64_URL_VALUES : BASE64_STANDARD_VALUES;
+    ssize_t i = 0;
+    uint32_t group = 0;
+    int tail;
+
+#ifdef STRING_SIMD_X86
+    if (length >= 64 && STRING_CPU_HAS("avx2")) {
+        i = _base64_decode_avx2(string, length, cursor, size,
+                                flags & STRING_BASE64_URL ? BASE64_URL : BASE64_STANDARD);
+        cursor += i / 4 * 3;
+    }
+#else
+    (void)size;
+#endif
+
+    for (; i + 4 <= length; i += 4, cursor += 3) {
+        uint8_t a = BASE64_VALUE(values, string[i]);
+        uint8_t b = BASE64_VALUE(values, string[i + 1]);
+        uint8_t c = BASE64_VALUE(values, string[i + 2]);
+        uint8_t d = BASE64_VALUE(values, string[i + 3]);
+
+        if ((a | b | c | d) > 63) return false;
+
+        group = (uint32_t)a << 18 | b << 12 | c << 6 | d;
+        cursor[0] = (uint8_t)(group >> 16);
+        cursor[1] = (uint8_t)(group >> 8);
+        cursor[2] = (uint8_t)group;
+    }
+
+    // The last 2 or 3 characters hold 1 or 2 bytes.
+    tail = length - i;
+    group = 0;
+    for (int k = 0; k < tail; ++k) {
+        uint8_t value = BASE64_VALUE(values, string[i + k]);
+
+        if (value == BASE64_INVALID) return false;
+        group |= (uint32_t)value << (18 - 6 * k);
+    }
+    if (tail) {
+        cursor[0] = (uint8_t)(group >> 16);
+        if (tail == 3) cursor[1] = (uint8_t)(group >> 8);
+        // Strict decoding only accepts the canonical encoding, unused bits set to 0.
+        if (!(flags & STRING_BASE64_LENIENT) && (group & (tail == 2 ? 0xFFFF : 0xFF))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Decode the base64 string and append the result to ``output``. Returns ``false`` and
+ * leaves ``output`` unchanged if the string isn't valid base64 for ``flags``.
+ * See :func:`String_base64_decode`.
+ */
+bool
+String_base64_decode_into(StringT *output, const StringT *self, int flags) {
+    ssize_t data_length, size = _base64_decoded_length(self, flags, &data_length);
+    char *cursor;
+
+    if (size < 0) return false;
+
+    cursor = string_reserve_tail(output, size);
+    if (!_base64_decode_write(self->string, data_length, size, flags,
+                              (uint8_t *)cursor)) {
+        output->string[output->length] = '\0';
+        return false;
+    }
+    output->length += size;
+    output->string[output->length] = '\0';
+
+    return true;
+}
+
+/**
+ * Decode the base64 string and return the decoded bytes, or ``NULL`` if the string
+ * isn't valid base64. ``flags`` is a combination of:
+ *
+ * - ``STRING_BASE64_URL`` for the URL-safe alphabet.
+ * - ``STRING_BASE64_NO_PADDING`` to expect no trailing ``=``.
+ * - ``STRING_BASE64_LENIENT`` to accept the padding either way, and unused bits of
+ *   the last character which aren't ``0``.
+ *
+ * By default decoding is strict: the padding must be present and the encoding be
+ * the canonical one. Whitespace is never skipped.
+ *
+ * .. note:: Has time complexity of O(n). The result is allocated exactly once and,
+ *           with AVX2, 32 characters are decoded at a time.
+ *
+ * .. code-block:: c
+ *
+ *    StringT *string = String_from("Zm9vYg");
+ *    StringT *decoded = String_base64_decode(string, STRING_BASE64_NO_PADDING);
+ *
+ *    assert(String_eq(decoded, "foob"));
+ *    assert(String_base64_decode(string, STRING_BASE64_DEFAULT) == NULL);
+ */
+StringT *
+String_base64_decode(const StringT *self, int flags) {
+    ssize_t data_length, size = _base64_decoded_length(self, flags, &data_length);
+    StringT *output;
+
+    if (size < 0) return NULL;
+
+    output = String_new(size + 1);
+    if (!_base64_decode_write(self->string, data_length, size, flags,
+                              (uint8_t *)output->string)) {
+        String_free(output);
+        return NULL;
+    }
+    output->length = size;
+    output->string[size] = '\0';
+
+    return output;
+}
+
+/* Hexadecimal */
+
+#ifdef STRING_SIMD_X86
+/** Internal function to encode blocks of 32 bytes, returns the number consumed. */
+STRING_TARGET("avx2")
+static ssize_t
+_hex_encode_avx2(const uint8_t *data, ssize_t length, char *cursor) {
+    const __m256i digits = _mm256_setr_epi8(
+        '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f',
+        '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+    const __m256i low_nibble = _mm256_set1_epi8(0x0F);
+    ssize_t i = 0;
+
+    for (; i + 32 <= length; i += 32, cursor += 64) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i *)(data + i));
+        __m256i high = _mm256_shuffle_epi8(
+            digits, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), low_nibble));
+        __m256i low = _mm256_shuffle_epi8(digits, _mm256_and_si256(bytes, low_nibble));
+        // Interleaving works within each lane: bytes 0..7 and 16..23, then the others.
+        __m256i first = _mm256_unpacklo_epi8(high, low);
+        __m256i second = _mm256_unpackhi_epi8(high, low);
+
+        _mm256_storeu_si256((__m256i *)cursor,
+                            _mm256_permute2x128_si256(first, second, 0x20));
+        _mm256_storeu_si256((__m256i *)(cursor + 32),
+                            _mm256_permute2x128_si256(first, second, 0x31));
+    }
+
+    return i;
+}
+#endif
+
+/** Internal function to write the hexadecimal digits of the bytes to ``cursor``. */
+static void
+_hex_encode_write(const StringT *self, char *cursor) {
+    const uint8_t *data = (const uint8_t *)self->string;
+    ssize_t i = 0;
+
+#ifdef STRING_SIMD_X86
+    if (self->length >= 64 && STRING_CPU_HAS("avx2")) {
+        i = _hex_encode_avx2(data, self->length, cursor);
+        cursor += i * 2;
+    }
+#endif
+
+    for (; i < self->length; ++i, cursor += 2) {
+        cursor[0] = HEX_DIGITS[data[i] >> 4];
+        cursor[1] = HEX_DIGITS[data[i] & 0xF];
+    }
+}
+
+/**
+ * Encode the string in hexadecimal and append the result to ``output``.
+ * See :func:`String_hex_encode`.
+ *
+ * .. note:: ``output`` is grown at most once, by the exact size of the result.
+ */
+void
+String_hex_encode_into(StringT *output, const StringT *self) {
+    _hex_encode_write(self, string_reserve_tail(output, self->length * 2));
+    output->length += self->length * 2;
+    output->string[output->length] = '\0';
+}
+
+/**
+ * Encode every byte of the string as two lowercase hexadecimal digits and return the
+ * encoded string.
+ *
+ * .. note:: Has time complexity of O(n). With AVX2, 32 bytes are encoded at a time.
+ *
+ * .. code-block:: c
+ *
+ *    StringT *string = String_from("\x01\xAB");
+ *    StringT *encoded = String_hex_encode(string);
+ *
+ *    assert(String_eq(encoded, "01ab"));
+ */
+StringT *
+String_hex_encode(const StringT *self) {
+    StringT *output = String_new(self->length * 2 + 1);
+
+    _hex_encode_write(self, output->string);
+    output->length = self->length * 2;
+    output->string[output->length] = '\0';
+
+    return output;
+}
+
+#ifdef STRING_SIMD_X86
+/**
+ * Internal function to decode blocks of 32 digits, stopping before one holding a
+ * character which isn't a digit. Returns the number of digits consumed.
+ */
+STRING_TARGET("avx2")
+static ssize_t
+_hex_decode_avx2(const char *string, ssize_t length, uint8_t *cursor) {
+    ssize_t i = 0;
+
+    for (; i + 32 <= length; i += 32, cursor += 16) {
+        __m256i chars = _mm256_loadu_si256((const __m256i *)(string + i));
+        __m256i folded = _mm256_or_si256(chars, _mm256_set1_epi8(0x20));
+        __m256i digit = AVX2_IN_RANGE(chars, '0', '9');
+        __m256i letter = AVX2_IN_RANGE(folded, 'a', 'f');
+        __m256i values = _mm256_or_si256(digit, letter);
+
+        if ((uint32_t)_mm256_movemask_epi8(values) != 0xFFFFFFFF) break;
+
+        values = _mm256_or_si256(
+            _mm256_and_si256(digit, _mm256_sub_epi8(chars, _mm256_set1_epi8('0'))),
+            _mm256_and_si256(letter,
+                             _mm256_sub_epi8(folded, _mm256_set1_epi8('a' - 10))));
+        // ``high * 16 + low`` for every pair, then the 16 bit results packed to bytes.
+        values = _mm256_maddubs_epi16(values, _mm256_set1_epi16(0x0110));
+        values = _mm256_packus_epi16(values, values);
+        values = _mm256_permute4x64_epi64(values, 0xD8);
+        _mm_storeu_si128((__m128i *)cursor, _mm256_castsi256_si128(values));
+    }
+
+    return i;
+}
+#endif
+
+/** Internal function to get the value of a hexadecimal digit, ``-1`` if none. */
+static inline int
+_hex_value(char ch) {
+    if (ch >= '0' && ch <= '9') return ch - '0';
+    if ((ch | 0x20) >= 'a' && (ch | 0x20) <= 'f') return (ch | 0x20) - 'a' + 10;
+    return -1;
+}
+
+/** Internal function to decode the digits to ``cursor``, ``false`` if one is invalid. */
+static bool
+_hex_decode_write(const StringT *self, uint8_t *cursor) {
+    const char *string = self->string;
+    ssize_t i = 0;
+
+#ifdef STRING_SIMD_X86
+    if (self->length >= 64 && STRING_CPU_HAS("avx2")) {
+        i = _hex_decode_avx2(string, self->length, cursor);
+        cursor += i / 2;
+    }
+#endif
+
+    for (; i < self->length; i += 2) {
+        int high = _hex_value(string[i]), low = _hex_value(string[i + 1]);
+
+        if (high < 0 || low < 0) return false;
+        *cursor++ = (uint8_t)(high << 4 | low);
+    }
+
+    return true;
+}
+
+/**
+ * Decode the hexadecimal string and append the result to ``output``. Returns
+ * ``false`` and leaves ``output`` unchanged if the string isn't valid hexadecimal.
+ * See :func:`String_hex_decode`.
+ */
+bool
+String_hex_decode_into(StringT *output, const StringT *self) {
+    char *cursor;
+
+    if (self->length % 2) return false;
+
+    cursor = string_reserve_tail(output, self->length / 2);
+    if (!_hex_decode_write(self, (uint8_t *)cursor)) {
+        output->string[output->length] = '\0';
+        return false;
+    }
+    output->length += self->length / 2;
+    output->string[output->length] = '\0';
+
+    return true;
+}
+
+/**
+ * Decode pairs of hexadecimal digits, in either case, and return the decoded bytes,
+ * or ``NULL`` if the length is odd or a character isn't a digit.
+ *
+ * .. note:: Has time complexity of O(n). With AVX2, 32 digits are decoded at a time.
+ *
+ * .. code-block:: c
+ *
+ *    StringT *string = String_from("48692E");
+ *    StringT *decoded = String_hex_decode(string);
+ *
+ *    assert(String_eq(decoded, "Hi."));
+ */
+StringT *
+String_hex_decode(const StringT *self) {
+    StringT *output;
+
+    if (self->length % 2) return NULL;
+
+    output = String_new(self->length / 2 + 1);
+    if (!_hex_decode_write(self, (uint8_t *)output->string)) {
+        String_free(output);
+        return NULL;
+    }
+    output->length = self->length / 2;
+    output->string[output->length] = '\0';
+
+    return output;
+}
@@ -1,14 +1,15 @@
 #include "string_ext.h"
 
 #include "string_dbg.h"
+#include "string_internal.h"
+#include "string_simd.h"
 
-#include <stdarg.h> /* va_list, va_start, va_arg, va_end */
-#include <stdlib.h> /* malloc, realloc */
+#include <stdatomic.h> /* atomic_long */
+#include <stdlib.h>    /* malloc, calloc, realloc, free */
+#include <string.h>    /* memchr, memcmp, memcpy, memset, strlen */
 
 
 #define WHITESPACE_CHARS " \t\n\r"
-#define CHAR_IS_WHITESPACE(ch)                                                           \
-    ((ch) == ' ' || (ch) == '\t' || (ch) == '\n' || (ch) == '\r')
 #define CHAR_IS_DIGIT(ch) ((ch) >= '0' && (ch) <= '9')
 #define CHAR_IS_ALPHABET(ch)                                                             \
     (((ch) >= 'a' && (ch) <= 'z') || ((ch) >= 'A' && (ch) <= 'Z'))
@@ -16,16 +17,19 @@
 #define CHAR_IS_UPPERCASE(ch) (((ch) >= 'A' && (ch) <= 'Z') || !CHAR_IS_ALPHABET(ch))
 #define CHAR_IS_ALPHANUMERIC(ch) ((CHAR_IS_ALPHABET(ch)) || (CHAR_IS_DIGIT(ch)))
 
-#define CHAR_TO_LOWERCASE(ch)                                                            \
-    if (CHAR_IS_ALPHABET(ch)) (ch |= 0x20)
 #define CHAR_TO_UPPERCASE(ch)                                                            \
     if (CHAR_IS_ALPHABET(ch)) (ch &= ~0x20)
-#define CHAR_SWAP_CASE(ch)                                                               \
-    if (CHAR_IS_ALPHABET(ch)) (ch ^= 0x20)
 
 
 #define U8_MAX 256
-#define MAX_2(a, b) ((a > b) ? (a) : (b))
+
+/// Largest step, either way, of a slice copied with vector gathers.
+#define SLICE_GATHER_MAX_STEP 16
+
+/// Reference count of a buffer shared by several ``StringT`` objects.
+struct StringSharedT {
+    atomic_long references;
+};
 
 /**
  * Convert negative index to positive index. If the index is positive,
@@ -50,15 +54,9 @@ negative_index_to_positive(ssize_t index, size_t length) {
  *
  * ..note:: The string should be NULL terminated!
  */
-static size_t
+static ssize_t
 c_string_length(const char *string) {
-    size_t length = 0;
-
-    while (*string++) {
-        length++;
-    }
-
-    return length;
+    return strlen(string);
 }
 
 /* ------------------------------ StringIteratorT ------------------------------ */
@@ -132,40 +130,23 @@ StringIterator_append(StringIteratorT *self, const StringT *string) {
 
 /**
  * Helper function to construct a ``StringIndexT`` object by dynamically determining the
- * attribute values (start, stop, step).
+ * attribute values (start, stop, step) from the ``nargs`` values of ``args``.
  *
- * ..note:: This should only be used by ``StringIndex`` macro.
+ * ..note:: This should only be used by ``StringIndex`` macro, which converts every
+ *          argument to ``ssize_t`` so that indices past 2 GB aren't truncated.
  */
 StringIndexT
-StringIndex__init__(size_t nargs, ...) {
-    va_list args;
-    va_start(args, nargs);
-
-    ssize_t start, stop, step;
-
+StringIndex__init__(size_t nargs, const ssize_t *args) {
     switch (nargs) {
         case 1:
-            start = 0;
-            stop = va_arg(args, ssize_t);
-            step = 1;
-            break;
+            return StringIndex_new(0, args[0], 1);
         case 2:
-            start = va_arg(args, ssize_t);
-            stop = va_arg(args, ssize_t);
-            step = 1;
-            break;
+            return StringIndex_new(args[0], args[1], 1);
         case 3:
-            start = va_arg(args, ssize_t);
-            stop = va_arg(args, ssize_t);
-            step = va_arg(args, ssize_t);
-            break;
+            return StringIndex_new(args[0], args[1], args[2]);
         default:
             ERR("Invalid number of arguments");
     }
-
-    va_end(args);
-
-    return StringIndex_new(start, stop, step);
 }
 
 /** Create and return a new ``StringIndexT`` object, three parameters (start, stop, step)
@@ -180,21 +161,26 @@ StringIndex_new(ssize_t start, ssize_t stop, ssize_t step) {
 }
 
 /**
- * Normalize the ``StringIndexT`` object by converting negative indices to positive
- * indices when step is positive.
+ * Normalize the ``StringIndexT`` object for a string of ``length`` bytes: a negative
+ * ``start`` counts from the end, a negative ``stop`` is the end of the string in the
+ * direction of the step, and both are clamped to the string like Python slices.
  *
- * .. note::
- *    * This function doesn't check if the indices are out of range.
- *    * This function doesn't check if the step is 0.
+ * .. note:: This function doesn't check if the step is 0.
  */
 StringIndexT
 StringIndex_normalize(StringIndexT self, ssize_t length) {
-    if (self.stop < 0) {
-        return self;
+    if (self.start < 0) {
+        self.start += length;
     }
 
-    self.start = negative_index_to_positive(self.start, length);
-    self.stop = negative_index_to_positive(self.stop, length);
+    if (self.step > 0) {
+        self.start = MIN_2(MAX_2(self.start, 0), length);
+        self.stop = self.stop < 0 ? length : MIN_2(self.stop, length);
+    } else {
+        // A start still negative is before the string, leaving nothing to slice.
+        self.start = MIN_2(self.start, length - 1);
+        self.stop = self.stop < 0 ? -1 : MIN_2(self.stop, length - 1);
+    }
 
     return self;
 }
@@ -206,10 +192,16 @@ StringIndex_equal(StringIndexT self, StringIndexT other) {
            self.step == other.step;
 }
 
-/** Calculate the length of the ``StringIndexT`` object. */
+/**
+ * Calculate the length of the ``StringIndexT`` object: the number of indices from
+ * ``start`` up to ``stop`` excluded, ``step`` apart. ``0`` for an empty range.
+ */
 ssize_t
 StringIndex_len(StringIndexT self) {
-    return (self.stop - self.start) / self.step;
+    if (self.step > 0) {
+        return self.stop > self.start ? (self.stop - self.start - 1) / self.step + 1 : 0;
+    }
+    return self.start > self.stop ? (self.start - self.stop - 1) / -self.step + 1 : 0;
 }
 
 /* ------------------------------ StringT ------------------------------ */
@@ -294,15 +286,39 @@ static void
 String_re_allocate(StringT *self, ssize_t new_size) {
     ssize_t new_allocated;
 
+    String_unshare(self);
     if (new_size <= self->allocated) return;
 
-    new_allocated = (new_size + (new_size >> 3) + 6) & ~3;
+    new_allocated = GROW_CAPACITY(new_size);
 
     DBG("Re-allocating string from %ld to %ld", self->allocated, new_allocated);
     self->string = realloc(self->string, new_allocated * sizeof *self->string);
     self->allocated = new_allocated;
 }
 
+/**
+ * Make room for exactly ``size`` more bytes (and the NULL terminator) at the end of
+ * the string and return where to write them. Used by the functions appending their
+ * result to a caller supplied ``StringT``, which measure it first.
+ *
+ * .. note:: The length is not updated, the caller does it once the bytes are written.
+ */
+char *
+string_reserve_tail(StringT *self, ssize_t size) {
+    String_unshare(self);
+
+    if (self->length + size + 1 > self->allocated) {
+        self->allocated = self->length + size + 1;
+        self->string = realloc(self->string, self->allocated);
+        if (self->string == NULL) {
+            ERR("Unable to allocate memory for `char *`");
+        }
+    }
+
+    self->hash = 0;
+    return self->string + self->length;
+}
+
 /**
  * Allocate exactly the amount of memory requested for the ``StringT`` object.
  *
@@ -326,60 +342,152 @@ String_pre_allocated(char *str, ssize_t size) {
  * Compare a ``StringT`` object with a C string.
  * Returns ``true`` if the two strings are equal, ``false`` otherwise.
  *
- * .. note:: The ``char *`` must be NULL terminated.
+ * .. note:: The ``char *`` must be NULL terminated. The lengths are compared first,
+ *           so a string is never equal to one of its prefixes.
  * .. code-block:: c
  *
  *    StringT *string = String_from("Hello");
  *    assert(String_eq(string, "Hello"));
+ *    assert(!String_eq(string, "Hello, World"));
  */
 bool
 String_eq(const StringT *self, const char *other) {
-    for (ssize_t i = 0; i < self->length; ++i) {
-        if (self->string[i] != other[i]) return false;
-    }
+    return c_string_length(other) == self->length &&
+           memcmp(self->string, other, self->length) == 0;
+}
 
-    return true;
+/** Internal function to deep copy a ``StringT`` object into a NULL terminated one. */
+static StringT *
+String_clone(const StringT *self) {
+    StringT *clone = String_from_char_array_with_length(self->string, self->length);
+
+    clone->hash = self->hash;
+    return clone;
 }
 
 /**
  * Create a copy of existing ``StringT`` object.
  *
+ * .. note:: Has time complexity of O(1) when ``self`` is shared (see
+ *           :func:`String_share`), the copy then shares the buffer of ``self``.
+ *           Otherwise the bytes are copied in O(n).
+ *
  * .. code-block:: c
  *
  *    StringT *string = String_from("Hello, World!");
  *    StringT *copy = String_copy(string);
- *    assert(String_eq(string, copy));
+ *    assert(String_equals(string, copy));
  */
 StringT *
 String_copy(const StringT *self) {
-    return String_from(self->string);
+    StringT *copy;
+
+    if (!self->shared) {
+        return String_clone(self);
+    }
+
+    atomic_fetch_add_explicit(&self->shared->references, 1, memory_order_relaxed);
+    copy = malloc(sizeof *copy);
+    if (copy == NULL) {
+        ERR("Unable to allocate memory for `StringT`");
+    }
+    *copy = *self;
+
+    return copy;
 }
 
 /**
- * Push a character to the end of the ``StringT`` object.
+ * Switch the string to copy-on-write mode and return a new reference to it in O(1).
+ * Both strings share one buffer under an atomic reference count, so they can be
+ * handed to different threads, and every later :func:`String_copy` of either of them
+ * is O(1) as well. Functions of the library which modify a string in place first give
+ * it a private buffer if the buffer is shared, and transforms which leave the string
+ * unchanged (e.g. :func:`String_to_upper` of an uppercase string) return a new
+ * reference instead of a copy.
+ *
+ * .. note:: ``self`` must own its buffer. Code writing to ``self->string`` directly
+ *           must call :func:`String_unshare` first.
  *
  * .. code-block:: c
  *
- *    StringT *string = String_from("Hello, World");
- *    String_push(string, '!');
- *    assert(String_eq(string, "Hello, World!"));
+ *    StringT *string = String_from("Hello");
+ *    StringT *reference = String_share(string);
+ *    StringT *suffix = String_from(", World");
+ *
+ *    String_concatenate_inplace(reference, suffix);
+ *    assert(String_eq(string, "Hello") && String_eq(reference, "Hello, World"));
  */
-static void
-String_push(StringT *self, char ch) {
-    String_re_allocate(self, self->length + 1);
+StringT *
+String_share(StringT *self) {
+    if (!self->shared) {
+        self->shared = malloc(sizeof *self->shared);
+        if (self->shared == NULL) {
+            ERR("Unable to allocate memory for `StringSharedT`");
+        }
+        atomic_init(&self->shared->references, 1);
+    }
+
+    return String_copy(self);
+}
+
+/** Check if the buffer of the string is currently shared with other strings. */
+bool
+String_is_shared(const StringT *self) {
+    return self->shared &&
+           atomic_load_explicit(&self->shared->references, memory_order_acquire) > 1;
+}
+
+/**
+ * Give the string a buffer of its own, copying the bytes only if other strings still
+ * share them. Leaves copy-on-write mode, see :func:`String_share`.
+ */
+void
+String_unshare(StringT *self) {
+    struct StringSharedT *shared = self->shared;
+    char *string;
+
+    if (!shared) return;
 
-    self->string[self->length] = ch;
-    self->length++;
+    self->shared = NULL;
+    if (atomic_load_explicit(&shared->references, memory_order_acquire) == 1) {
+        free(shared);
+        return;
+    }
+
+    string = malloc(self->length + 1);
+    if (string == NULL) {
+        ERR("Unable to allocate memory for `char *`");
+    }
+    memcpy(string, self->string, self->length);
+    string[self->length] = '\0';
+
+    // The other references may have been released meanwhile.
+    if (atomic_fetch_sub_explicit(&shared->references, 1, memory_order_acq_rel) == 1) {
+        free(self->string);
+        free(shared);
+    }
+    self->string = string;
+    self->allocated = self->length + 1;
 }
 
 /**
  * Deep free the ``StringT`` object.
  *
  * .. note::
- *   * This function will free the base string.
+ *   * This function will free the base string, a shared base string is freed with
+ *     its last reference.
  */
 void
 String_free(StringT *self) {
+    if (self->shared) {
+        if (atomic_fetch_sub_explicit(&self->shared->references, 1,
+                                      memory_order_acq_rel) > 1) {
+            free(self);
+            return;
+        }
+        free(self->shared);
+    }
+
     free(self->string);
     free(self);
 }
@@ -403,10 +511,115 @@ String_index(const StringT *self, ssize_t index) {
     return self->string[index];
 }
 
+#ifdef STRING_SIMD_X86
+/**
+ * Internal function to copy ``length`` bytes of ``string`` backwards from ``start``,
+ * 32 at a time. Returns the number of bytes copied.
+ */
+STRING_TARGET("avx2")
+static ssize_t
+_char_array_reverse_avx2(char *output, const char *string, ssize_t start,
+                         ssize_t length) {
+    const __m256i reverse = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3,
+                                             2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6,
+                                             5, 4, 3, 2, 1, 0);
+    ssize_t i = 0;
+
+    for (; i + 32 <= length; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *)(string + start - i - 31));
+
+        // Reverse the bytes of each lane, then swap the lanes.
+        block = _mm256_shuffle_epi8(block, reverse);
+        block = _mm256_permute4x64_epi64(block, 0x4E);
+        _mm256_storeu_si256((__m256i *)(output + i), block);
+    }
+
+    return i;
+}
+
+/**
+ * Internal function to copy ``length`` bytes of ``string``, ``step`` apart from
+ * ``start``, 32 at a time with four gathers of 8 dwords whose low bytes are packed.
+ * Blocks whose dwords would be read past the end of the string are copied one byte at
+ * a time. Returns the number of bytes copied.
+ */
+STRING_TARGET("avx2")
+static ssize_t
+_char_array_gather_avx2(char *output, const char *string, ssize_t string_length,
+                        ssize_t start, ssize_t step, ssize_t length) {
+    const __m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                               _mm256_set1_epi32((int)step));
+    const __m256i stride = _mm256_set1_epi32((int)(8 * step));
+    const __m256i low_byte = _mm256_set1_epi32(0xFF);
+    // Order of the dwords after the packs, which interleave the lanes.
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    ssize_t i = 0;
+
+    for (; i + 32 <= length; i += 32) {
+        ssize_t first = start + i * step, last = first + 31 * step;
+        const int *base = (const int *)(string + first);
+        __m256i gathered[4], offset = offsets, packed;
+
+        if (MAX_2(first, last) + 3 >= string_length) {
+            for (ssize_t k = i; k < i + 32; ++k) output[k] = string[start + k * step];
+            continue;
+        }
+
+        for (int g = 0; g < 4; ++g) {
+            gathered[g] =
+                _mm256_and_si256(_mm256_i32gather_epi32(base, offset, 1), low_byte);
+            offset = _mm256_add_epi32(offset, stride);
+        }
+        packed = _mm256_packus_epi16(_mm256_packus_epi32(gathered[0], gathered[1]),
+                                     _mm256_packus_epi32(gathered[2], gathered[3]));
+        _mm256_storeu_si256((__m256i *)(output + i),
+                            _mm256_permutevar8x32_epi32(packed, order));
+    }
+
+    return i;
+}
+#endif
+
+/**
+ * Internal function to copy ``length`` bytes of the string, ``step`` apart from
+ * ``start``, into ``output``. Contiguous slices are copied with ``memcpy``; reversed
+ * ones and small strides use vector shuffles and gathers when AVX2 is available.
+ */
+static void
+_char_array_gather(char *output, const char *string, ssize_t string_length,
+                   ssize_t start, ssize_t step, ssize_t length) {
+    ssize_t i = 0;
+
+    if (step == 1) {
+        memcpy(output, string + start, length);
+        return;
+    }
+
+#ifdef STRING_SIMD_X86
+    if (length >= 64 && STRING_CPU_HAS("avx2")) {
+        if (step == -1) {
+            i = _char_array_reverse_avx2(output, string, start, length);
+        } else if (step >= -SLICE_GATHER_MAX_STEP && step <= SLICE_GATHER_MAX_STEP) {
+            i = _char_array_gather_avx2(output, string, string_length, start, step,
+                                        length);
+        }
+    }
+#else
+    (void)string_length;
+#endif
+
+    for (; i < length; ++i) {
+        output[i] = string[start + i * step];
+    }
+}
+
 /**
- * Get the slice of the ``StringT`` object.
+ * Get the slice of the ``StringT`` object. Negative indices count from the end, a
+ * negative ``stop`` slices up to the end in the direction of the step, and indices out
+ * of the string are clamped to it like Python slices.
  *
- * .. note:: If index is out of range, this function will throw an error and exit.
+ * .. note:: Indices count bytes, see :func:`String_utf8_slice` to count code points.
+ *           The slice is allocated once with its exact size.
  *
  * .. code-block:: c
  *
@@ -421,15 +634,17 @@ String_index(const StringT *self, ssize_t index) {
  */
 StringT *
 String_slice(const StringT *self, StringIndexT index) {
-    StringT *slice = String_new(0);
+    ssize_t length;
+    StringT *slice;
 
     index = StringIndex_normalize(index, self->length);
-    int slice_length = StringIndex_len(index);
+    length = StringIndex_len(index);
 
-    while (slice_length--) {
-        String_push(slice, self->string[index.start]);
-        index.start += index.step;
-    }
+    slice = String_new(length + 1);
+    _char_array_gather(slice->string, self->string, self->length, index.start, index.step,
+                       length);
+    slice->string[length] = '\0';
+    slice->length = length;
 
     return slice;
 }
@@ -449,14 +664,13 @@ String_slice(const StringT *self, StringIndexT index) {
  */
 StringT *
 String_concatenate(const StringT *self, const StringT *other) {
-    StringT *concatenated_string = String_copy(self);
+    ssize_t length = self->length + other->length;
+    StringT *concatenated_string = String_new(length + 1);
 
-    String_re_allocate(concatenated_string, self->length + other->length);
-
-    for (ssize_t i = 0; i < other->length; ++i) {
-        concatenated_string->string[i + self->length] = other->string[i];
-    }
-    concatenated_string->length += other->length;
+    memcpy(concatenated_string->string, self->string, self->length);
+    memcpy(concatenated_string->string + self->length, other->string, other->length);
+    concatenated_string->string[length] = '\0';
+    concatenated_string->length = length;
 
     return concatenated_string;
 }
@@ -481,6 +695,7 @@ String_concatenate_inplace(StringT *self, const StringT *other) {
     for (ssize_t i = 0; i < other->length; ++i) {
         self->string[self->length++] = other->string[i];
     }
+    self->hash = 0;
 }
 
 /**
@@ -500,24 +715,87 @@ String_repeat(const StringT *self, ssize_t times) {
     ssize_t new_length;
     StringT *new_string;
 
-    if (times < 0) {
-        return String_new(0);
+    if (times <= 0) {
+        return String_from("");
+    }
+    if (times == 1) {
+        return String_copy(self);
     }
 
     new_length = self->length * times;
-    new_string = String_pre_allocated(self->string, new_length);
+    new_string = String_new(new_length + 1);
 
-    for (ssize_t i = 1; i < times; ++i) {
-        String_concatenate_inplace(new_string, self);
+    // Every pass doubles the repeated part, copying from the part already written.
+    memcpy(new_string->string, self->string, self->length);
+    for (ssize_t done = self->length; done < new_length; done *= 2) {
+        memcpy(new_string->string + done, new_string->string,
+               MIN_2(done, new_length - done));
     }
     new_string->string[new_length] = '\0';
+    new_string->length = new_length;
 
     return new_string;
 }
 
+#ifdef STRING_SIMD_X86
+STRING_TARGET("avx2")
+static ssize_t
+_char_array_mismatch_avx2(const char *string, const char *other, ssize_t length) {
+    ssize_t i = 0;
+
+    for (; i + 32 <= length; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(string + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(other + i));
+        uint32_t equal = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b));
+
+        if (equal != 0xFFFFFFFF) {
+            return i + CTZ_64(~equal);
+        }
+    }
+
+    return i;
+}
+#endif
+
+/**
+ * Internal function to find the first of ``length`` bytes where the two arrays differ.
+ * Returns its index, or ``length`` if all the bytes are equal.
+ */
+static ssize_t
+_char_array_mismatch(const char *string, const char *other, ssize_t length) {
+    ssize_t i = 0;
+
+#ifdef STRING_SIMD_X86
+    if (length >= 64 && STRING_CPU_HAS("avx2")) {
+        i = _char_array_mismatch_avx2(string, other, length);
+        if (i + 32 <= length) return i;
+    }
+
+    for (; i + 16 <= length; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(string + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(other + i));
+        uint32_t equal = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(a, b));
+
+        if (equal != 0xFFFF) {
+            return i + CTZ_64(~equal);
+        }
+    }
+#endif
+
+    while (i < length && string[i] == other[i]) {
+        i++;
+    }
+
+    return i;
+}
+
 /**
  * Check if two ``StringT`` objects are equal.
  *
+ * .. note:: Strings of different lengths, or whose cached hashes (see
+ *           :func:`String_hash_cached`) differ, are told apart in O(1). Otherwise the
+ *           bytes are compared 16 or 32 at a time.
+ *
  * .. code-block:: c
  *
  *    StringT *string1 = String_from("Hello, ");
@@ -529,42 +807,240 @@ String_repeat(const StringT *self, ssize_t times) {
  */
 bool
 String_equals(const StringT *self, const StringT *other) {
-    return String_eq(self, other->string);
+    if (self->length != other->length) {
+        return false;
+    }
+    if (self->hash && other->hash && self->hash != other->hash) {
+        return false;
+    }
+
+    return self->string == other->string ||
+           _char_array_mismatch(self->string, other->string, self->length) ==
+               self->length;
 }
 
 /**
- * Internal function to construct the bad match table which holds the relative positions
- * of the letters with respect to their last occurrence in the pattern.
- * For string ``"ABCADABCAC"`` the bad match table will look like
- * ``{A: 1, C: 1, B: 3, D: 5}``.
- * These are currently stored in a ``ssize_t`` array of size ``U8_MAX``.
+ * Return the length of the longest common prefix of two ``StringT`` objects.
+ *
+ * .. note:: Has time complexity of O(n), the bytes are compared 16 or 32 at a time.
+ *
+ * .. code-block:: c
  *
- * .. todo:: Get rid of empty spaces in the arary.
+ *    StringT *string1 = String_from("interview");
+ *    StringT *string2 = String_from("internet");
+ *
+ *    assert(String_common_prefix_length(string1, string2) == 6);
  */
-static void
-_construct_bad_match_table(const StringT *self, ssize_t *match_table) {
-    for (ssize_t i = 0; i < self->length; ++i) {
-        match_table[(int)self->string[i]] = MAX_2(1, self->length - i - 1);
+ssize_t
+String_common_prefix_length(const StringT *self, const StringT *other) {
+    return _char_array_mismatch(self->string, other->string,
+                                MIN_2(self->length, other->length));
+}
+
+/**
+ * Return the index of the first byte where two ``StringT`` objects differ, or ``-1``
+ * if they are equal. When one string is a prefix of the other, the index is the
+ * length of the shorter one.
+ *
+ * .. code-block:: c
+ *
+ *    StringT *string1 = String_from("Hello, World");
+ *    StringT *string2 = String_from("Hello, world");
+ *    StringT *string3 = String_from("Hello");
+ *
+ *    assert(String_mismatch(string1, string2) == 7);
+ *    assert(String_mismatch(string1, string3) == 5);
+ *    assert(String_mismatch(string1, string1) == -1);
+ */
+ssize_t
+String_mismatch(const StringT *self, const StringT *other) {
+    ssize_t index = String_common_prefix_length(self, other);
+
+    if (index == self->length && index == other->length) {
+        return -1;
+    }
+
+    return index;
+}
+
+/**
+ * Three way comparison of two ``StringT`` objects in byte order.
+ * Returns a negative value if ``self`` sorts before ``other``, ``0`` if they are equal
+ * and a positive value otherwise. When one string is a prefix of the other the shorter
+ * one sorts first.
+ *
+ * .. code-block:: c
+ *
+ *    StringT *string1 = String_from("apple");
+ *    StringT *string2 = String_from("apples");
+ *
+ *    assert(String_compare(string1, string2) < 0);
+ *    assert(String_compare(string2, string1) > 0);
+ *    assert(String_compare(string1, string1) == 0);
+ */
+int
+String_compare(const StringT *self, const StringT *other) {
+    ssize_t index = String_common_prefix_length(self, other);
+
+    if (index < self->length && index < other->length) {
+        return (unsigned char)self->string[index] - (unsigned char)other->string[index];
     }
+
+    return (self->length > other->length) - (self->length < other->length);
 }
 
 /**
- * Internal function to compare the substring with the string from a given starting point
- * in reverse order.
+ * Internal function to compare ``length`` bytes ignoring the case of ASCII letters,
+ * 16 bytes at a time when SIMD is available.
  */
 static bool
-_reverse_string_compare_from_starting_point(const StringT *self, const StringT *sub,
-                                            size_t start) {
-    ssize_t j = sub->length - 1;
-    for (ssize_t i = start; j >= 0 && self->string[i] == sub->string[j]; --i, --j)
-        ;
-    return j < 0;
+_char_array_equals_icase(const char *string, const char *other, ssize_t length) {
+    ssize_t i = 0;
+
+#ifdef STRING_SIMD_X86
+    const __m128i before_a = _mm_set1_epi8('A' - 1), after_z = _mm_set1_epi8('Z' + 1);
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+
+    for (; i + 16 <= length; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(string + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(other + i));
+
+        // Set the case bit of uppercase letters only, then compare.
+        a = _mm_or_si128(a, _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi8(a, before_a),
+                                                        _mm_cmplt_epi8(a, after_z)),
+                                          case_bit));
+        b = _mm_or_si128(b, _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi8(b, before_a),
+                                                        _mm_cmplt_epi8(b, after_z)),
+                                          case_bit));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) != 0xFFFF) {
+            return false;
+        }
+    }
+#endif
+
+    for (; i < length; ++i) {
+        if (CHAR_FOLD_CASE(string[i]) != CHAR_FOLD_CASE(other[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Internal function to compile the pattern of a search. With ``icase``, both cases
+ * of a letter of the pattern get the same shift, so neither string is lowercased.
+ * The pattern isn't copied, it must outlive the compiled pattern.
+ */
+void
+string_search_pattern_init(StringSearchPatternT *self, const StringT *pattern,
+                           bool icase) {
+    self->pattern = pattern->string;
+    self->length = pattern->length;
+    self->icase = icase;
+
+    for (int ch = 0; ch < U8_MAX; ++ch) {
+        self->fold[ch] = icase ? CHAR_FOLD_CASE(ch) : ch;
+        self->shift[ch] = pattern->length;
+    }
+    for (ssize_t i = 0; i < pattern->length - 1; ++i) {
+        unsigned char ch = self->fold[(unsigned char)pattern->string[i]];
+
+        self->shift[ch] = pattern->length - 1 - i;
+        if (icase && ch >= 'a' && ch <= 'z') {
+            self->shift[ch ^ 0x20] = pattern->length - 1 - i;
+        }
+    }
+}
+
+/**
+ * Internal function to find the first occurrence of the compiled pattern in
+ * ``text[start:stop]``, ``-1`` if there is none. An empty pattern is never found.
+ */
+ssize_t
+string_search_next(const StringSearchPatternT *self, const char *text, ssize_t start,
+                   ssize_t stop) {
+    ssize_t length = self->length;
+    unsigned char last;
+
+    start = MAX_2(start, 0);
+    if (length == 0 || stop - start < length) return -1;
+    if (length == 1 && !self->icase) {
+        const char *found = memchr(text + start, self->pattern[0], stop - start);
+        return found == NULL ? -1 : found - text;
+    }
+
+    last = self->fold[(unsigned char)self->pattern[length - 1]];
+    for (ssize_t i = start + length - 1; i < stop;
+         i += self->shift[(unsigned char)text[i]]) {
+        const char *candidate = text + i - length + 1;
+
+        if (self->fold[(unsigned char)text[i]] == last &&
+            (self->icase ? _char_array_equals_icase(candidate, self->pattern, length - 1)
+                         : memcmp(candidate, self->pattern, length - 1) == 0)) {
+            return i - length + 1;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Internal function to find the occurrences of the compiled pattern, at most
+ * ``limit`` of them unless ``limit`` is negative. Their positions are appended to
+ * ``matches`` if not ``NULL``, else the first ``capacity`` are stored in ``offsets``.
+ * Returns the number of occurrences.
+ */
+static ssize_t
+_search_all(const StringSearchPatternT *self, const StringT *text, int flags,
+            ssize_t limit, StringMatchesT *matches, int64_t *offsets, ssize_t capacity) {
+    // Overlapping matches may start right after the start of the previous one.
+    ssize_t advance = flags & STRING_FIND_OVERLAPPING ? 1 : self->length;
+    ssize_t count = 0, position = 0;
+
+    while (count != limit && (position = string_search_next(self, text->string, position,
+                                                            text->length)) >= 0) {
+        if (matches != NULL) {
+            if (matches->length >= matches->allocated) {
+                matches->allocated = GROW_CAPACITY(matches->length + 1);
+                matches->offsets = realloc(matches->offsets,
+                                           matches->allocated * sizeof *matches->offsets);
+                if (matches->offsets == NULL) {
+                    ERR("Unable to reallocate memory for match offsets");
+                }
+            }
+            matches->offsets[matches->length++] = position;
+        } else if (count < capacity) {
+            offsets[count] = position;
+        }
+
+        count++;
+        position += advance;
+    }
+
+    return count;
+}
+
+/**
+ * Internal function to append to ``matches`` the positions of the occurrences of the
+ * pattern, at most ``limit`` of them unless ``limit`` is negative. Returns their
+ * number. Shared by the searches, splits and replacements scanning for every match.
+ */
+ssize_t
+string_find_all(const StringT *self, const StringT *pattern, int flags, ssize_t limit,
+                StringMatchesT *matches) {
+    StringSearchPatternT search;
+
+    string_search_pattern_init(&search, pattern, false);
+    return _search_all(&search, self, flags, limit, matches, NULL, 0);
 }
 
 /**
  * Check if the given substring is contained within the original string.
- * Time complexity is O(n*m) where n is the length of the string and m is the length of
- * the sub_string.
+ * An empty substring is never found.
+ *
+ * .. note:: Has time complexity of O(n) on average and O(n*m) at worst where n is the
+ *           length of the string and m is the length of the sub_string.
  *
  * .. code-block:: c
  *
@@ -590,31 +1066,76 @@ String_contains(const StringT *self, const StringT *other) {
  */
 StringIndexT
 String_contains_in_range(const StringT *self, const StringT *other, StringIndexT index) {
-    StringIndexT not_found = StringIndex(0, 0, 1);
-    ssize_t match_table[U8_MAX] = {0};
-    ssize_t shift;
-
-    _construct_bad_match_table(other, match_table);
+    StringSearchPatternT search;
+    ssize_t found;
 
     if (index.step != 1) ERR("String_contains_in_range: step must be 1");
 
-    for (ssize_t i = index.start + other->length - 1; i < index.stop;) {
-        shift = match_table[(int)self->string[i]];
+    string_search_pattern_init(&search, other, false);
+    found = string_search_next(&search, self->string, index.start,
+                         MIN_2(index.stop, self->length));
 
-        if (!shift) {
-            shift = other->length;
-        } else if (_reverse_string_compare_from_starting_point(self, other, i)) {
-            return StringIndex(i - other->length + 1, i + 1);
-        }
+    return found < 0 ? StringIndex(0, 0, 1) : StringIndex(found, found + other->length);
+}
 
-        i += shift;
-    }
+/**
+ * Find every occurrence of the pattern in one pass and return their positions, in
+ * increasing order. Occurrences don't overlap unless ``flags`` has
+ * ``STRING_FIND_OVERLAPPING``. An empty pattern is never found.
+ *
+ * .. note:: Free the result with :func:`StringMatches_free`. For a buffer of the
+ *           caller, see :func:`String_find_all_into`.
+ *
+ * .. code-block:: c
+ *
+ *    StringT *string = String_from("aaaa");
+ *    StringT *pattern = String_from("aa");
+ *    StringMatchesT *matches = String_find_all(string, pattern, STRING_FIND_DEFAULT);
+ *    StringMatchesT *overlapping =
+ *        String_find_all(string, pattern, STRING_FIND_OVERLAPPING);
+ *
+ *    assert(matches->length == 2 && matches->offsets[1] == 2);
+ *    assert(overlapping->length == 3 && overlapping->offsets[1] == 1);
+ */
+StringMatchesT *
+String_find_all(const StringT *self, const StringT *pattern, int flags) {
+    StringMatchesT *matches = calloc(1, sizeof *matches);
 
-    if (index.stop - index.start < other->length) {
-        return not_found;
+    if (matches == NULL) {
+        ERR("Unable to allocate memory for `StringMatchesT`");
     }
 
-    return not_found;
+    string_find_all(self, pattern, flags, -1, matches);
+    return matches;
+}
+
+/**
+ * Find every occurrence of the pattern like :func:`String_find_all`, storing the first
+ * ``capacity`` of their positions in ``offsets``. Returns the number of occurrences,
+ * which may be more than ``capacity``. Doesn't allocate.
+ *
+ * .. code-block:: c
+ *
+ *    StringT *string = String_from("a,b,c");
+ *    StringT *comma = String_from(",");
+ *    int64_t offsets[8];
+ *
+ *    assert(String_find_all_into(string, comma, STRING_FIND_DEFAULT, offsets, 8) == 2);
+ *    assert(offsets[0] == 1 && offsets[1] == 3);
+ */
+ssize_t
+String_find_all_into(const StringT *self, const StringT *pattern, int flags,
+                     int64_t *offsets, ssize_t capacity) {
+    StringSearchPatternT search;
+
+    string_search_pattern_init(&search, pattern, false);
+    return _search_all(&search, self, flags, -1, NULL, offsets, capacity);
+}
+
+void
+StringMatches_free(StringMatchesT *self) {
+    free(self->offsets);
+    free(self);
 }
 
 /**
@@ -669,15 +1190,17 @@ String_contains_char_in_range(const StringT *self, const char character,
 }
 
 /**
- * Check if the string contains any char from the char class and return the index of the
- * first occurrence.
+ * Find the first char of the string which is in the char class and return its index.
  * Similar to regex: ``[...]``
  *
+ * .. note:: Has time complexity of O(n + k), the class is compiled to a bitmap first.
+ *           For repeated searches with the same class see ``StringCharClassT``.
+ *
  * .. code-block:: c
  *
  *    StringT *string = String_from("Hello, World!");
  *    StringT *char_class = String_from("Wd");
- *    StringIndexT index = String_contains_char_class(string, char_class);
+ *    StringIndexT index = String_find_from_char_class(string, char_class);
  *
  *    assert(StringIndex_eq(index, StringIndex(7, 8)));
  */
@@ -688,38 +1211,39 @@ String_find_from_char_class(const StringT *self, const StringT *characters) {
 }
 
 /**
- * Check if the string contains any char from the char class in the given range and
- * return the index of the first occurrence.
+ * Find the first char of the string in the given range which is in the char class and
+ * return its index.
  * Similar to regex: ``[...]``
  *
  * .. code-block:: c
  *
  *    StringT *string = String_from("Hello, World!");
  *    StringT *char_class = String_from("Wd");
- *    StringIndexT index = String_contains_char_class_in_range(string, char_class,
- *                                                             StringIndex(0, 5));
+ *    StringIndexT index = String_find_from_char_class_in_range(string, char_class,
+ *                                                              StringIndex(0, 5));
  *
  *    assert(StringIndex_eq(index, StringIndex(0, 0, 1)));
  */
 StringIndexT
 String_find_from_char_class_in_range(const StringT *self, const StringT *characters,
                                      StringIndexT index) {
-    StringIndexT not_found = StringIndex(0, 0, 1);
-    StringIndexT slice_index;
-    ssize_t index_length = StringIndex_len(index);
+    StringCharClassT char_class;
+    ssize_t found;
 
-    for (ssize_t i = index.start; i < index.stop && index_length--; ++i) {
-        slice_index = String_contains_char(characters, self->string[i]);
-        if (!StringIndex_len(slice_index)) {
-            continue;
-        }
-        return slice_index;
-    }
-    return not_found;
+    if (index.step != 1) ERR("String_find_from_char_class_in_range: step must be 1");
+
+    string_char_class_init(&char_class, characters->string, characters->length);
+    found = string_char_class_find(&char_class, self->string, MAX_2(index.start, 0),
+                                   MIN_2(index.stop, self->length));
+
+    return found < 0 ? StringIndex(0, 0, 1) : StringIndex(found, found + 1);
 }
 
 /**
- * Replace all occurrences of the substring with the replacement string.
+ * Replace all occurrences of the substring with the replacement string, from left to
+ * right without overlaps. An empty substring is never found, the string is copied.
+ *
+ * .. note:: The string is scanned once and the result allocated once.
  *
  * .. code-block:: c
  *
@@ -733,8 +1257,28 @@ String_find_from_char_class_in_range(const StringT *self, const StringT *charact
 StringT *
 String_replace(const StringT *self, const StringT *sub_string,
                const StringT *replacement) {
-    StringIteratorT *iterator = String_split(self, sub_string);
-    return String_join(iterator, replacement);
+    StringMatchesT matches = {0};
+    ssize_t count = string_find_all(self, sub_string, STRING_FIND_DEFAULT, -1, &matches);
+    StringT *string =
+        String_new(self->length + count * (replacement->length - sub_string->length) + 1);
+    char *cursor = string->string;
+    ssize_t start = 0;
+
+    // Sized exactly from the matches, then copied piece by piece.
+    for (ssize_t i = 0; i < count; ++i) {
+        memcpy(cursor, self->string + start, matches.offsets[i] - start);
+        cursor += matches.offsets[i] - start;
+        memcpy(cursor, replacement->string, replacement->length);
+        cursor += replacement->length;
+        start = matches.offsets[i] + sub_string->length;
+    }
+    memcpy(cursor, self->string + start, self->length - start);
+    cursor += self->length - start;
+    *cursor = '\0';
+
+    string->length = cursor - string->string;
+    free(matches.offsets);
+    return string;
 }
 
 /**
@@ -753,8 +1297,7 @@ String_replace(const StringT *self, const StringT *sub_string,
 StringIteratorT *
 String_split_limit(const StringT *self, const StringT *delimiter, ssize_t limit) {
     StringIteratorT *iterator = StringIterator_new();
-    StringIndexT index;
-    StringIndexT slice_index;
+    StringMatchesT matches = {0};
     ssize_t start = 0;
 
     // Special case for `limit`
@@ -762,27 +1305,21 @@ String_split_limit(const StringT *self, const StringT *delimiter, ssize_t limit)
     if (!limit) {
         StringIterator_append(iterator, self);
         return iterator;
-    } else if (limit == -1) {
-        limit = self->length;
     } else if (limit < -1) {
         ERR("String_split_limit: limit must be greater than -1");
     }
 
-    index = String_contains(self, delimiter);
-
-    // Get the index of the delimiter and slice the string from that index
-    // then append it to the list, then set the start value to current stop value
-    // and continue unit the delimiter is not found or `limit` is exhausted
-    while (index.stop && limit--) {
-        slice_index = StringIndex(start, index.start);
-        StringIterator_append(iterator, String_slice(self, slice_index));
-        start = index.stop;
-        index =
-            String_contains_in_range(self, delimiter, StringIndex(start, self->length));
+    // Slice the string between the delimiters, found in one pass.
+    string_find_all(self, delimiter, STRING_FIND_DEFAULT, limit, &matches);
+    for (ssize_t i = 0; i < matches.length; ++i) {
+        StringIterator_append(iterator,
+                              String_slice(self, StringIndex(start, matches.offsets[i])));
+        start = matches.offsets[i] + delimiter->length;
     }
 
     StringIterator_append(iterator, String_slice(self, StringIndex(start, self->length)));
 
+    free(matches.offsets);
     return iterator;
 }
 
@@ -837,14 +1374,17 @@ String_split_lines(const StringT *self) {
  *    * - Space
  *      - Newline
  *      - Carriage return
- *      - Form feed
  *      - Tab
  *    * - ' '
  *      - '\n'
  *      - '\r'
- *      - '\f'
  *      - '\t'
  *
+ * Runs of whitespace separate the tokens, so leading and trailing whitespace never
+ * produce empty tokens. See :func:`String_split_whitespace_array` for a version
+ * which doesn't allocate a ``StringT`` per token.
+ *
+ * .. note:: Has time complexity of O(n), whitespace is classified 64 bytes at a time.
  *
  *  .. code-block:: c
  *
@@ -880,14 +1420,141 @@ String_split_lines_limit(const StringT *self, ssize_t limit) {
     return String_split_limit(self, String_from("\n"), limit);
 }
 
+#ifdef STRING_SIMD_X86
+/** Internal function to classify 16 bytes, bit ``i`` is set for whitespace byte ``i``. */
+static inline uint64_t
+_whitespace_mask_16(const char *block) {
+    __m128i bytes = _mm_loadu_si128((const __m128i *)block);
+    __m128i whitespace = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(' ')),
+                     _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\t'))),
+        _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n')),
+                     _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\r'))));
+
+    return (uint32_t)_mm_movemask_epi8(whitespace);
+}
+
+STRING_TARGET("avx2")
+static uint64_t
+_whitespace_mask_64_avx2(const char *block) {
+    uint64_t mask = 0;
+
+    for (int i = 0; i < 2; ++i) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i *)(block + 32 * i));
+        __m256i whitespace = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' ')),
+                            _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\t'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\n')),
+                            _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\r'))));
+
+        mask |= (uint64_t)(uint32_t)_mm256_movemask_epi8(whitespace) << (32 * i);
+    }
+
+    return mask;
+}
+#endif
+
+/** Internal function to classify 64 bytes, bit ``i`` is set for whitespace byte ``i``. */
+static inline uint64_t
+_whitespace_mask_64(const char *block, bool avx2) {
+    uint64_t mask = 0;
+
+#ifdef STRING_SIMD_X86
+    if (avx2) {
+        return _whitespace_mask_64_avx2(block);
+    }
+    for (int i = 0; i < 4; ++i) {
+        mask |= _whitespace_mask_16(block + 16 * i) << (16 * i);
+    }
+#else
+    (void)avx2;
+    for (int i = 0; i < 64; ++i) {
+        mask |= (uint64_t)CHAR_IS_WHITESPACE(block[i]) << i;
+    }
+#endif
+
+    return mask;
+}
+
+/**
+ * Split ``length`` bytes on runs of whitespace and pass every token to ``emit``, in
+ * order. After ``limit`` tokens (unless ``limit`` is -1), the rest of the string
+ * starting at the next token is passed as the last one. Returns the number of tokens.
+ *
+ * The string is classified 64 bytes at a time into a whitespace bitmask. A token
+ * starts at a non whitespace byte following whitespace and ends at a whitespace byte
+ * following a non whitespace one, so both boundaries are found for the whole block
+ * with two shifts, and extracted with ``CTZ_64`` and ``x & (x - 1)``.
+ */
+ssize_t
+string_split_whitespace(const char *string, ssize_t length, ssize_t limit,
+                        StringTokenFnT emit, void *context) {
+    char tail[64];
+    ssize_t start = 0, count = 0;
+    uint64_t carry = 1; // The byte before the string counts as whitespace.
+    bool in_token = false, avx2 = false;
+
+#ifdef STRING_SIMD_X86
+    avx2 = length >= 128 && STRING_CPU_HAS("avx2");
+#endif
+
+    for (ssize_t block = 0; block < length; block += 64) {
+        const char *bytes = string + block;
+        uint64_t whitespace, previous, starts, ends;
+
+        if (length - block < 64) {
+            // Pad the last block with whitespace, which ends the last token in it.
+            memset(tail, ' ', sizeof tail);
+            memcpy(tail, bytes, length - block);
+            bytes = tail;
+        }
+
+        whitespace = _whitespace_mask_64(bytes, avx2);
+        previous = (whitespace << 1) | carry;
+        starts = ~whitespace & previous;
+        ends = whitespace & ~previous;
+        carry = whitespace >> 63;
+
+        // Starts and ends alternate, so take them in turn.
+        while (in_token ? ends : starts) {
+            if (in_token) {
+                emit(string + start, block + CTZ_64(ends) - start, context);
+                count++;
+                ends &= ends - 1;
+            } else {
+                start = block + CTZ_64(starts);
+                starts &= starts - 1;
+                if (count == limit) {
+                    emit(string + start, length - start, context);
+                    return count + 1;
+                }
+            }
+            in_token = !in_token;
+        }
+    }
+
+    if (in_token) {
+        emit(string + start, length - start, context);
+        count++;
+    }
+
+    return count;
+}
+
+static void
+_append_token_to_iterator(const char *string, ssize_t length, void *context) {
+    StringIterator_append(context, String_from_char_array_with_length(string, length));
+}
+
 /**
- * Split the string based on whitespace chars for a fixed ``limit``.
- * See :func:`String_split_whitespace` for more info.
+ * Split the string based on whitespace chars for a fixed ``limit``, which is the
+ * maximum number of splits. The rest of the string, starting at its next token,
+ * becomes the last token. See :func:`String_split_whitespace` for more info.
  *
  * .. code-block:: c
  *
  *    StringT *string = String_from("foo bar\nfoobar\tbar foo");
- *    StringT *strings = String_split_whitespace_limit(string, 2);
+ *    StringT *strings = String_split_whitespace_limit(string, 1);
  *
  *    assert(StringIterator_len(strings) == 2);
  *    assert(String_eq(StringIterator_next(strings), "foo"));
@@ -896,29 +1563,13 @@ String_split_lines_limit(const StringT *self, ssize_t limit) {
 StringIteratorT *
 String_split_whitespace_limit(const StringT *self, ssize_t limit) {
     StringIteratorT *iterator = StringIterator_new();
-    ssize_t start = 0;
 
-    // Special case for ``limit``
-    // If limit is -1, then we iterate until the string is exhausted
-    if (!limit) {
-        StringIterator_append(iterator, self);
-        return iterator;
-    } else if (limit == -1) {
-        limit = self->length;
-    } else if (limit < -1) {
-        ERR("String_split_limit: limit must be greater than -1");
-    }
-
-    for (ssize_t i = 0; i < self->length && limit--; ++i) {
-        if (CHAR_IS_WHITESPACE(self->string[i])) {
-            StringIterator_append(iterator, String_slice(self, StringIndex(start, i)));
-            while (CHAR_IS_WHITESPACE(self->string[i]) && i < self->length) {
-                ++i;
-            }
-            start = i;
-        }
+    if (limit < -1) {
+        ERR("String_split_whitespace_limit: limit must be greater than -1");
     }
 
+    string_split_whitespace(self->string, self->length, limit, _append_token_to_iterator,
+                            iterator);
 
     return iterator;
 }
@@ -942,7 +1593,8 @@ String_split_in_range(const StringT *self, const StringT *delimiter, StringIndex
 }
 
 /**
- * Split the string from right to left based on a delimiter.
+ * Split the string from right to left based on a delimiter. The pieces are the ones
+ * of :func:`String_split`, last piece first.
  *
  * .. code-block:: c
  *
@@ -950,9 +1602,9 @@ String_split_in_range(const StringT *self, const StringT *delimiter, StringIndex
  *    StringT *delimiter = String_from(", ");
  *    StringIteratorT *strings = String_right_split(string, delimiter);
  *
- *    assert(StringIterator_len(strings) == 2);
- *    assert(String_eq(StringIterator_next(strings), " eggs"));
- *    assert(String_eq(StringIterator_next(strings), " spam"));
+ *    assert(StringIterator_len(strings) == 3);
+ *    assert(String_eq(StringIterator_next(strings), "eggs"));
+ *    assert(String_eq(StringIterator_next(strings), "spam"));
  *    assert(String_eq(StringIterator_next(strings), "foo bar"));
  */
 StringIteratorT *
@@ -961,7 +1613,8 @@ String_right_split(const StringT *self, const StringT *delimiter) {
 }
 
 /**
- * Split the string from right to left based on a delimiter for a fixed ``limit``.
+ * Split the string from right to left based on a delimiter for a fixed ``limit``: only
+ * the last ``limit`` delimiters split, the rest of the string is the last piece.
  *
  * .. code-block:: c
  *
@@ -970,43 +1623,37 @@ String_right_split(const StringT *self, const StringT *delimiter) {
  *    StringIteratorT *strings = String_right_split_limit(string, delimiter, 1);
  *
  *    assert(StringIterator_len(strings) == 2);
- *    assert(String_eq(StringIterator_next(strings), " eggs"));
+ *    assert(String_eq(StringIterator_next(strings), "eggs"));
  *    assert(String_eq(StringIterator_next(strings), "foo bar, spam"));
  */
 StringIteratorT *
 String_right_split_limit(const StringT *self, const StringT *delimiter, ssize_t limit) {
     StringIteratorT *iterator = StringIterator_new();
-    StringIndexT index;
-    ssize_t start = self->length;
+    StringMatchesT matches = {0};
+    ssize_t stop = self->length, first;
 
     // Special case for `limit`
     // If limit is -1, then we iterate until the string is exhausted
     if (!limit) {
         StringIterator_append(iterator, self);
         return iterator;
-    } else if (limit == -1) {
-        limit = self->length;
     } else if (limit < -1) {
-        ERR("String_split_limit: limit must be greater than -1");
+        ERR("String_right_split_limit: limit must be greater than -1");
     }
 
-    index = String_contains(self, delimiter);
-    for (ssize_t i = 0; i < self->length; ++i) {
-        if (index.stop) {
-            if (start != index.start) {
-                StringIterator_append(
-                    iterator, String_slice(self, StringIndex(index.start, start)));
+    // Slice the string between the last `limit` delimiters, found in one pass.
+    string_find_all(self, delimiter, STRING_FIND_DEFAULT, -1, &matches);
+    first = limit == -1 ? 0 : MAX_2(matches.length - limit, 0);
+    for (ssize_t i = matches.length - 1; i >= first; --i) {
+        ssize_t start = matches.offsets[i] + delimiter->length;
 
-                if (!--limit) {
-                    break;
-                }
-            }
-            start = index.start - 1;
-        }
-        index =
-            String_contains_in_range(self, delimiter, StringIndex(0, index.start - 1));
+        StringIterator_append(iterator, String_slice(self, StringIndex(start, stop)));
+        stop = matches.offsets[i];
     }
 
+    StringIterator_append(iterator, String_slice(self, StringIndex(0, stop)));
+
+    free(matches.offsets);
     return iterator;
 }
 
@@ -1053,12 +1700,14 @@ String_join(StringIteratorT *self, const StringT *delimiter) {
 static bool
 String_check_equals_in_range(const StringT *self, const StringT *other,
                              StringIndexT index) {
-    if (index.stop > self->length) {
-        ERR("String_check_equals_in_range: index out of range");
+    // A prefix or suffix longer than the string can't match, it's not an error.
+    if (other->length > self->length || index.start < 0 || index.stop > self->length) {
+        return false;
     }
 
-    if (other->length > self->length) {
-        return false;
+    if (index.step == 1) {
+        return memcmp(self->string + index.start, other->string,
+                      index.stop - index.start) == 0;
     }
 
     for (ssize_t i = index.start; i < index.stop; i += index.step) {
@@ -1102,66 +1751,114 @@ String_ends_with(const StringT *self, const StringT *suffix) {
 }
 
 /**
- * Reverse the string and return a new string.
+ * Check if two strings are equal ignoring the case of ASCII letters, without
+ * allocating lowercase copies.
+ *
+ * .. code-block:: c
  *
- * .. note:: This function has a time complexity of O(n).
+ *    StringT *string1 = String_from("Content-Type");
+ *    StringT *string2 = String_from("content-type");
+ *
+ *    assert(String_equals_icase(string1, string2));
+ */
+bool
+String_equals_icase(const StringT *self, const StringT *other) {
+    return self->length == other->length &&
+           _char_array_equals_icase(self->string, other->string, self->length);
+}
+
+/**
+ * Check if the string starts with the provided prefix ignoring the case of ASCII
+ * letters.
  *
  * .. code-block:: c
  *
- *    StringT *string = String_from("Hello, World");
- *    StringT *reversed_string = String_reverse(string);
+ *    StringT *string = String_from("HTTP/1.1 200 OK");
+ *    StringT *prefix = String_from("http/");
  *
- *    assert(String_eq(reversed_string, "dlroW ,olleH"));
+ *    assert(String_starts_with_icase(string, prefix));
  */
-StringT *
-String_reverse(const StringT *self) {
-    return String_slice(self, StringIndex(self->length - 1, -1, -1));
+bool
+String_starts_with_icase(const StringT *self, const StringT *prefix) {
+    return prefix->length <= self->length &&
+           _char_array_equals_icase(self->string, prefix->string, prefix->length);
 }
 
 /**
- * Convert the string to uppercase and return the uppercase string.
+ * Check if the string ends with the provided suffix ignoring the case of ASCII
+ * letters.
  *
- * .. note:: Has time complexity of O(n).
+ * .. code-block:: c
+ *
+ *    StringT *string = String_from("WWW.Example.COM");
+ *    StringT *suffix = String_from(".example.com");
+ *
+ *    assert(String_ends_with_icase(string, suffix));
+ */
+bool
+String_ends_with_icase(const StringT *self, const StringT *suffix) {
+    return suffix->length <= self->length &&
+           _char_array_equals_icase(self->string + self->length - suffix->length,
+                                    suffix->string, suffix->length);
+}
+
+/**
+ * Find the first occurrence of the substring ignoring the case of ASCII letters. See
+ * :func:`String_contains_icase_in_range` for more info.
  *
  * .. code-block:: c
  *
- *    StringT *string = String_from("Hello, World");
- *    StringT *upper_string = String_to_upper(string);
+ *    StringT *string = String_from("Accept-Encoding: GZIP, deflate");
+ *    StringT *sub_string = String_from("gzip");
  *
- *    assert(String_eq(upper_string, "HELLO, WORLD"));
+ *    assert(StringIndex_equal(String_contains_icase(string, sub_string),
+ *                             StringIndex(17, 21)));
  */
-StringT *
-String_to_upper(const StringT *self) {
-    StringT *new_string = String_copy(self);
+StringIndexT
+String_contains_icase(const StringT *self, const StringT *other) {
+    return String_contains_icase_in_range(self, other, StringIndex(self->length));
+}
 
-    for (ssize_t i = 0; i < new_string->length; ++i) {
-        CHAR_TO_UPPERCASE(new_string->string[i]);
-    }
+/**
+ * Find the first occurrence of the substring in the given range ignoring the case of
+ * ASCII letters. Returns ``StringIndex(0, 0, 1)`` when there is none, or when the
+ * substring is empty.
+ *
+ * .. note:: Shares the Horspool search of :func:`String_contains_in_range`, with a
+ *           case-folded bad character table: both cases of a letter of the substring
+ *           get the same shift, so neither string is copied nor lowercased.
+ */
+StringIndexT
+String_contains_icase_in_range(const StringT *self, const StringT *other,
+                               StringIndexT index) {
+    StringSearchPatternT search;
+    ssize_t found;
 
-    return new_string;
+    if (index.step != 1) ERR("String_contains_icase_in_range: step must be 1");
+
+    string_search_pattern_init(&search, other, true);
+    found = string_search_next(&search, self->string, index.start,
+                         MIN_2(index.stop, self->length));
+
+    return found < 0 ? StringIndex(0, 0, 1) : StringIndex(found, found + other->length);
 }
 
 /**
- * Convert the string to lowercase and return the lowercase string.
+ * Reverse the string and return a new string.
  *
- * .. note:: Has time complexity of O(n).
+ * .. note:: This function has a time complexity of O(n). Bytes are reversed, use
+ *           :func:`String_utf8_reverse` to keep UTF-8 sequences intact.
  *
  * .. code-block:: c
  *
  *    StringT *string = String_from("Hello, World");
- *    StringT *lower_string = String_to_lower(string);
+ *    StringT *reversed_string = String_reverse(string);
  *
- *    assert(String_eq(lower_string, "hello, world"));
+ *    assert(String_eq(reversed_string, "dlroW ,olleH"));
  */
 StringT *
-String_to_lower(const StringT *self) {
-    StringT *new_string = String_copy(self);
-
-    for (ssize_t i = 0; i < new_string->length; ++i) {
-        CHAR_TO_LOWERCASE(new_string->string[i]);
-    }
-
-    return new_string;
+String_reverse(const StringT *self) {
+    return String_slice(self, StringIndex(self->length - 1, -1, -1));
 }
 
 /**
@@ -1178,9 +1875,10 @@ String_to_lower(const StringT *self) {
  */
 StringT *
 String_to_title(const StringT *self) {
-    StringT *new_string = String_copy(self);
+    StringT *new_string = String_clone(self);
     char ch;
 
+    new_string->hash = 0;
     if (!new_string->length) {
         return new_string;
     }
@@ -1188,7 +1886,7 @@ String_to_title(const StringT *self) {
     CHAR_TO_UPPERCASE(new_string->string[0]);
 
     // Capitalizing the character that comes after a space char.
-    for (int i = 1; i < new_string->length - 1; ++i) {
+    for (ssize_t i = 1; i < new_string->length - 1; ++i) {
         ch = new_string->string[i];
         if (CHAR_IS_WHITESPACE(ch)) {
             CHAR_TO_UPPERCASE(new_string->string[i + 1]);
@@ -1213,35 +1911,15 @@ String_to_title(const StringT *self) {
  */
 StringT *
 String_to_capital(const StringT *self) {
-    StringT *new_string = String_copy(self);
+    StringT *new_string;
 
-    if (!new_string->length) {
-        return new_string;
+    if (!self->length || CHAR_IS_UPPERCASE(self->string[0])) {
+        return String_copy(self);
     }
-    CHAR_TO_UPPERCASE(new_string->string[0]);
-
-    return new_string;
-}
-
-/**
- * Swap the case of the string and return the new string.
- *
- * .. note:: Has time complexity of O(n).
- *
- * .. code-block:: c
- *
- *    StringT *string = String_from("Hello, World");
- *    StringT *swapped_string = String_swap_case(string);
- *
- *    assert(String_eq(swapped_string, "hELLO, wORLD"));
- */
-StringT *
-String_swap_case(const StringT *self) {
-    StringT *new_string = String_copy(self);
 
-    for (ssize_t i = 0; i < new_string->length; ++i) {
-        CHAR_SWAP_CASE(new_string->string[i]);
-    }
+    new_string = String_clone(self);
+    new_string->hash = 0;
+    CHAR_TO_UPPERCASE(new_string->string[0]);
 
     return new_string;
 }
@@ -1440,7 +2118,15 @@ String_is_whitespace(const StringT *self) {
  */
 StringT *
 String_trim_whitespace(const StringT *self) {
-    return String_trim_left(String_trim_right(self));
+    ssize_t start = 0, stop = self->length;
+
+    while (start < stop && CHAR_IS_WHITESPACE(self->string[start])) start++;
+    while (stop > start && CHAR_IS_WHITESPACE(self->string[stop - 1])) stop--;
+
+    if (start == 0 && stop == self->length) {
+        return String_copy(self);
+    }
+    return String_from_char_array_with_length(self->string + start, stop - start);
 }
 
 /**
@@ -1456,12 +2142,14 @@ String_trim_whitespace(const StringT *self) {
  */
 StringT *
 String_trim_left(const StringT *self) {
-    for (ssize_t i = 0; i < self->length; ++i) {
-        if (!CHAR_IS_WHITESPACE(self->string[i])) {
-            return String_slice(self, StringIndex(i, self->length));
-        }
+    ssize_t start = 0;
+
+    while (start < self->length && CHAR_IS_WHITESPACE(self->string[start])) start++;
+
+    if (start == 0) {
+        return String_copy(self);
     }
-    return String_copy(self);
+    return String_from_char_array_with_length(self->string + start, self->length - start);
 }
 
 /**
@@ -1477,12 +2165,14 @@ String_trim_left(const StringT *self) {
  */
 StringT *
 String_trim_right(const StringT *self) {
-    for (ssize_t i = self->length - 1; i >= 0; --i) {
-        if (!CHAR_IS_WHITESPACE(self->string[i])) {
-            return String_slice(self, StringIndex(i + 1));
-        }
+    ssize_t stop = self->length;
+
+    while (stop > 0 && CHAR_IS_WHITESPACE(self->string[stop - 1])) stop--;
+
+    if (stop == self->length) {
+        return String_copy(self);
     }
-    return String_copy(self);
+    return String_from_char_array_with_length(self->string, stop);
 }
 
 /**
@@ -1497,12 +2187,21 @@ String_trim_right(const StringT *self) {
  */
 StringT *
 String_pad(const StringT *self, ssize_t left_pad, ssize_t right_pad) {
-    StringT *left_padded =
-        String_concatenate(String_repeat(String_from(" "), left_pad), self);
-    StringT *right_padded =
-        String_concatenate(left_padded, String_repeat(String_from(" "), right_pad));
+    ssize_t length = left_pad + self->length + right_pad;
+    StringT *padded;
 
-    return right_padded;
+    if (left_pad == 0 && right_pad == 0) {
+        return String_copy(self);
+    }
+
+    padded = String_new(length + 1);
+    memset(padded->string, ' ', left_pad);
+    memcpy(padded->string + left_pad, self->string, self->length);
+    memset(padded->string + left_pad + self->length, ' ', right_pad);
+    padded->string[length] = '\0';
+    padded->length = length;
+
+    return padded;
 }
 
 /**
@@ -1544,12 +2243,8 @@ StringT *
 String_left_justify(const StringT *self, ssize_t width) {
     ssize_t length_to_fill = width - self->length;
 
-    if (length_to_fill < 0) {
-        return String_copy(self);
-    }
-
-    // Concatenate the string with `length_to_fill` number of whitespaces
-    return String_concatenate(self, String_repeat(String_from(" "), length_to_fill));
+    // Pad the string with `length_to_fill` number of whitespaces on the right.
+    return String_pad(self, 0, MAX_2(length_to_fill, 0));
 }
 
 /**
@@ -1567,12 +2262,8 @@ StringT *
 String_right_justify(const StringT *self, ssize_t width) {
     ssize_t length_to_fill = width - self->length;
 
-    if (length_to_fill < 0) {
-        return String_copy(self);
-    }
-
-    // Concatenate `length_to_fill` number of whitespaces with the string.
-    return String_concatenate(String_repeat(String_from(" "), length_to_fill), self);
+    // Pad the string with `length_to_fill` number of whitespaces on the left.
+    return String_pad(self, MAX_2(length_to_fill, 0), 0);
 }
 
 /**
@@ -1599,30 +2290,17 @@ String_chunks(const StringT *self, ssize_t chunk_size) {
 }
 
 /**
- * Return a new string with the characters of the string
- * repeated `n` times.
+ * Count the occurrences of the substring in the string, without overlaps. An empty
+ * substring is never found. See :func:`String_find_all` for the overlapping ones.
  *
  * .. code-block:: c
  *
- *    StringT *string = String_from("Hi");
- *    StringT *repeated = String_repeat(string, 3);
+ *    StringT *string = String_from("Hello, World");
+ *    StringT *sub_string = String_from("l");
  *
- *    assert(String_equals(repeated, String_from("HiHiHi")));
+ *    assert(String_count(string, sub_string) == 3);
  */
 ssize_t
 String_count(const StringT *self, const StringT *sub_string) {
-    ssize_t count = 0;
-    StringIndexT contains = String_contains(self, sub_string);
-
-    if (!contains.stop) {
-        return 0;
-    }
-
-    while (contains.stop) {
-        contains = String_contains_in_range(self, sub_string,
-                                            StringIndex(contains.stop, self->length));
-        count++;
-    }
-
-    return count;
+    return String_find_all_into(self, sub_string, STRING_FIND_DEFAULT, NULL, 0);
 }
@@ -0,0 +1,221 @@
+#include "string_ext.h"
+
+#include <stdint.h> /* uint64_t */
+#include <string.h> /* memcpy */
+
+
+/*
+ * Hash functions of the library, based on wyhash (final version 4) by Wang Yi which
+ * is released into the public domain. It mixes 16 bytes per 64x64 -> 128 bit
+ * multiplication and handles short keys without a loop.
+ */
+
+static const uint64_t HASH_SECRET[4] = {0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull,
+                                        0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull};
+
+/** Internal function to multiply two 64 bit values into a 128 bit (high, low) pair. */
+static inline void
+_hash_multiply(uint64_t *low, uint64_t *high) {
+#ifdef __SIZEOF_INT128__
+    __extension__ typedef unsigned __int128 uint128_t;
+    uint128_t product = (uint128_t)*low * *high;
+
+    *low = (uint64_t)product;
+    *high = (uint64_t)(product >> 64);
+#else
+    uint64_t ha = *low >> 32, hb = *high >> 32;
+    uint64_t la = (uint32_t)*low, lb = (uint32_t)*high;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32), carry = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+
+    carry += lo < t;
+    *low = lo;
+    *high = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+#endif
+}
+
+static inline uint64_t
+_hash_mix(uint64_t a, uint64_t b) {
+    _hash_multiply(&a, &b);
+    return a ^ b;
+}
+
+/**
+ * Internal function to lowercase every ASCII letter packed in a word at once (SWAR),
+ * bytes outside ``A-Z`` are left untouched.
+ */
+static inline uint64_t
+_fold_ascii_word(uint64_t word) {
+    uint64_t heptets = word & 0x7f7f7f7f7f7f7f7full;
+    uint64_t above_z = heptets + 0x2525252525252525ull;
+    uint64_t from_a = heptets + 0x3f3f3f3f3f3f3f3full;
+    uint64_t is_upper = ~word & (from_a ^ above_z) & 0x8080808080808080ull;
+
+    return word | (is_upper >> 2);
+}
+
+static inline uint64_t
+_read_8(const unsigned char *p, bool fold) {
+    uint64_t value;
+
+    memcpy(&value, p, sizeof value);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap64(value);
+#endif
+    return fold ? _fold_ascii_word(value) : value;
+}
+
+static inline uint64_t
+_read_4(const unsigned char *p, bool fold) {
+    uint32_t value;
+
+    memcpy(&value, p, sizeof value);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap32(value);
+#endif
+    return fold ? _fold_ascii_word(value) : value;
+}
+
+/** Internal function to read the 1 to 3 byte tail of a short key. */
+static inline uint64_t
+_read_3(const unsigned char *p, size_t length, bool fold) {
+    uint64_t value = ((uint64_t)p[0] << 16) | ((uint64_t)p[length >> 1] << 8) |
+                     p[length - 1];
+
+    return fold ? _fold_ascii_word(value) : value;
+}
+
+/**
+ * Internal hash kernel shared by every public variant, ``fold`` is a compile time
+ * constant at each call site so the case folding disappears from the regular hash.
+ * Never returns ``0`` so that ``0`` can mark a hash which isn't cached yet.
+ */
+static inline uint64_t
+_hash(const char *string, size_t length, uint64_t seed, bool fold) {
+    const unsigned char *p = (const unsigned char *)string;
+    uint64_t a, b;
+
+    seed ^= _hash_mix(seed ^ HASH_SECRET[0], HASH_SECRET[1]);
+
+    if (length <= 16) {
+        if (length >= 4) {
+            a = (_read_4(p, fold) << 32) | _read_4(p + ((length >> 3) << 2), fold);
+            b = (_read_4(p + length - 4, fold) << 32) |
+                _read_4(p + length - 4 - ((length >> 3) << 2), fold);
+        } else if (length > 0) {
+            a = _read_3(p, length, fold);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = length;
+
+        if (i > 48) {
+            uint64_t seed1 = seed, seed2 = seed;
+
+            do {
+                seed = _hash_mix(_read_8(p, fold) ^ HASH_SECRET[1],
+                                 _read_8(p + 8, fold) ^ seed);
+                seed1 = _hash_mix(_read_8(p + 16, fold) ^ HASH_SECRET[2],
+                                  _read_8(p + 24, fold) ^ seed1);
+                seed2 = _hash_mix(_read_8(p + 32, fold) ^ HASH_SECRET[3],
+                                  _read_8(p + 40, fold) ^ seed2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= seed1 ^ seed2;
+        }
+
+        while (i > 16) {
+            seed = _hash_mix(_read_8(p, fold) ^ HASH_SECRET[1], _read_8(p + 8, fold) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+
+        a = _read_8(p + i - 16, fold);
+        b = _read_8(p + i - 8, fold);
+    }
+
+    a ^= HASH_SECRET[1];
+    b ^= seed;
+    _hash_multiply(&a, &b);
+    a = _hash_mix(a ^ HASH_SECRET[0] ^ length, b ^ HASH_SECRET[1]);
+
+    return a | (a == 0);
+}
+
+/**
+ * Hash ``length`` bytes of a C string with the given seed.
+ * Gives the same result as :func:`String_hash_seeded` on a ``StringT`` holding the
+ * same bytes, so lookups don't need to build a ``StringT`` first.
+ */
+uint64_t
+String_hash_char_array(const char *string, ssize_t length, uint64_t seed) {
+    return _hash(string, length, seed, false);
+}
+
+/**
+ * Compute the 64 bit hash of the string with the given seed.
+ * Different seeds give independent hash functions, e.g. to defend a hash table
+ * against crafted keys.
+ *
+ * .. note:: The hash is never ``0``.
+ */
+uint64_t
+String_hash_seeded(const StringT *self, uint64_t seed) {
+    return _hash(self->string, self->length, seed, false);
+}
+
+/**
+ * Compute the 64 bit hash of the string.
+ *
+ * .. note:: Has time complexity of O(n), short strings are hashed without a loop.
+ *
+ * .. code-block:: c
+ *
+ *    StringT *string1 = String_from("Hello");
+ *    StringT *string2 = String_from("Hello");
+ *
+ *    assert(String_hash(string1) == String_hash(string2));
+ */
+uint64_t
+String_hash(const StringT *self) {
+    return _hash(self->string, self->length, 0, false);
+}
+
+/**
+ * Compute a case-insensitive 64 bit hash of the string.
+ * ASCII letters are folded to lowercase while the words are read, so no lowercased
+ * copy is allocated.
+ *
+ * .. code-block:: c
+ *
+ *    StringT *string1 = String_from("Content-Type");
+ *    StringT *string2 = String_from("content-type");
+ *
+ *    assert(String_hash_icase(string1) == String_hash_icase(string2));
+ *    assert(String_hash_icase(string2) == String_hash(string2));
+ */
+uint64_t
+String_hash_icase(const StringT *self) {
+    return _hash(self->string, self->length, 0, true);
+}
+
+/**
+ * Compute the hash of the string (same value as :func:`String_hash`) and remember it
+ * in the ``StringT``, so repeated calls cost O(1).
+ *
+ * .. note:: The cached value is reset by the functions that modify the string in
+ *           place. Code writing to ``self->string`` directly must reset
+ *           ``self->hash`` to ``0`` itself.
+ */
+uint64_t
+String_hash_cached(StringT *self) {
+    if (!self->hash) {
+        self->hash = String_hash(self);
+    }
+
+    return self->hash;
+}
@@ -0,0 +1,458 @@
+#include "string_index_text.h"
+
+#include "string_dbg.h"
+#include "string_internal.h"
+
+#include <fcntl.h>    /* open, O_RDONLY */
+#include <stdint.h>   /* int64_t, uint64_t */
+#include <stdio.h>    /* FILE, fopen, fwrite, fclose */
+#include <stdlib.h>   /* malloc, free, qsort */
+#include <string.h>   /* memcmp, memcpy, memset */
+#include <sys/mman.h> /* mmap, munmap */
+#include <sys/stat.h> /* fstat */
+#include <unistd.h>   /* close */
+
+
+/*
+ * Suffix array over a fixed text, for substring queries which would otherwise each
+ * scan the whole text.
+ *
+ * The suffix array lists the starts of the suffixes of the text in lexicographic
+ * order, so the occurrences of a pattern are one contiguous range of it, found with
+ * two binary searches in O(m log n). It is built in linear time with SA-IS (Nong,
+ * Zhang and Chan): suffixes are classified as S or L type, the leftmost S suffixes
+ * (LMS) are sorted by induction from a recursive suffix array of their names, and
+ * the order of every other suffix is induced from theirs.
+ *
+ * An index can be saved to a file holding a header, the text and the suffix array,
+ * and loaded back with ``mmap``: nothing is rebuilt nor copied, the pages are read
+ * on demand. The file uses the byte order of the machine which wrote it.
+ */
+
+#define INDEX_TEXT_MAGIC "STRIDX1"
+
+typedef struct {
+    char magic[8];
+    uint64_t length;
+} IndexTextHeaderT;
+
+struct StringIndexTextT {
+    const char *text;
+    const int64_t *suffixes;
+    ssize_t length;
+
+    /* Either the mapping of a loaded file, or the buffers of a built index. */
+    void *mapping;
+    size_t mapping_size;
+    char *text_buffer;
+    int64_t *suffixes_buffer;
+};
+
+/* SA-IS */
+
+/// Symbol ``i`` of the string being sorted: the text (shifted by one, with a ``0``
+/// sentinel at ``n - 1``) at the first level, the names of the LMS substrings below.
+#define SAIS_CHAR(i) (level0 ? _sais_byte(s, n, i) : ((const int64_t *)s)[i])
+#define SAIS_IS_LMS(i) ((i) > 0 && types[i] && !types[(i) - 1])
+
+static inline int64_t
+_sais_byte(const void *s, int64_t n, int64_t i) {
+    return i == n - 1 ? 0 : (int64_t)((const unsigned char *)s)[i] + 1;
+}
+
+/** Internal function to get the start (or end) of the bucket of every symbol. */
+static void
+_sais_buckets(const void *s, bool level0, int64_t n, int64_t k, int64_t *buckets,
+              bool end) {
+    int64_t sum = 0;
+
+    memset(buckets, 0, (k + 1) * sizeof *buckets);
+    for (int64_t i = 0; i < n; ++i) {
+        buckets[SAIS_CHAR(i)]++;
+    }
+    for (int64_t c = 0; c <= k; ++c) {
+        sum += buckets[c];
+        buckets[c] = end ? sum : sum - buckets[c];
+    }
+}
+
+/** Internal function to induce the order of the L suffixes, then of the S ones. */
+static void
+_sais_induce(const void *s, bool level0, const unsigned char *types, int64_t *sa,
+             int64_t n, int64_t k, int64_t *buckets) {
+    _sais_buckets(s, level0, n, k, buckets, false);
+    for (int64_t i = 0; i < n; ++i) {
+        int64_t j = sa[i] - 1;
+
+        if (sa[i] > 0 && !types[j]) sa[buckets[SAIS_CHAR(j)]++] = j;
+    }
+
+    _sais_buckets(s, level0, n, k, buckets, true);
+    for (int64_t i = n - 1; i >= 0; --i) {
+        int64_t j = sa[i] - 1;
+
+        if (sa[i] > 0 && types[j]) sa[--buckets[SAIS_CHAR(j)]] = j;
+    }
+}
+
+/**
+ * Internal function to build the suffix array of the ``n`` symbols of ``s``, whose
+ * last one is a unique smallest sentinel, with symbols from ``0`` to ``k``.
+ */
+static void
+_sais(const void *s, bool level0, int64_t *sa, int64_t n, int64_t k) {
+    unsigned char *types = malloc(n);
+    int64_t *buckets = malloc((k + 1) * sizeof *buckets);
+    int64_t n1 = 0, name = 0, previous = -1, *s1, *sa1;
+
+    if (types == NULL || buckets == NULL) {
+        ERR("Unable to allocate memory for the suffix array construction");
+    }
+
+    // Type of every suffix, S (1) or L (0).
+    types[n - 1] = 1;
+    if (n > 1) types[n - 2] = 0;
+    for (int64_t i = n - 3; i >= 0; --i) {
+        types[i] = SAIS_CHAR(i) < SAIS_CHAR(i + 1) ||
+                   (SAIS_CHAR(i) == SAIS_CHAR(i + 1) && types[i + 1]);
+    }
+
+    // Sort the LMS substrings by induction from their unsorted positions.
+    _sais_buckets(s, level0, n, k, buckets, true);
+    for (int64_t i = 0; i < n; ++i) sa[i] = -1;
+    for (int64_t i = 1; i < n; ++i) {
+        if (SAIS_IS_LMS(i)) sa[--buckets[SAIS_CHAR(i)]] = i;
+    }
+    _sais_induce(s, level0, types, sa, n, k, buckets);
+
+    // Name the sorted LMS substrings, equal substrings getting the same name.
+    for (int64_t i = 0; i < n; ++i) {
+        if (SAIS_IS_LMS(sa[i])) sa[n1++] = sa[i];
+    }
+    for (int64_t i = n1; i < n; ++i) sa[i] = -1;
+    for (int64_t i = 0; i < n1; ++i) {
+        int64_t position = sa[i];
+        bool differ = false;
+
+        for (int64_t d = 0; d < n; ++d) {
+            if (previous < 0 || SAIS_CHAR(position + d) != SAIS_CHAR(previous + d) ||
+                types[position + d] != types[previous + d]) {
+                differ = true;
+                break;
+            }
+            if (d > 0 && (SAIS_IS_LMS(position + d) || SAIS_IS_LMS(previous + d))) {
+                break;
+            }
+        }
+        if (differ) {
+            name++;
+            previous = position;
+        }
+        // LMS positions are at least 2 apart, halving them keeps them distinct.
+        sa[n1 + position / 2] = name - 1;
+    }
+    for (int64_t i = n - 1, j = n - 1; i >= n1; --i) {
+        if (sa[i] >= 0) sa[j--] = sa[i];
+    }
+
+    // Sort the LMS suffixes: recurse while names repeat, else the names are the order.
+    s1 = sa + n - n1;
+    sa1 = sa;
+    if (name < n1) {
+        _sais(s1, false, sa1, n1, name - 1);
+    } else {
+        for (int64_t i = 0; i < n1; ++i) sa1[s1[i]] = i;
+    }
+
+    // Put the sorted LMS suffixes at the end of their buckets and induce the others.
+    _sais_buckets(s, level0, n, k, buckets, true);
+    for (int64_t i = 1, j = 0; i < n; ++i) {
+        if (SAIS_IS_LMS(i)) s1[j++] = i;
+    }
+    for (int64_t i = 0; i < n1; ++i) sa1[i] = s1[sa1[i]];
+    for (int64_t i = n1; i < n; ++i) sa[i] = -1;
+    for (int64_t i = n1 - 1; i >= 0; --i) {
+        int64_t j = sa[i];
+
+        sa[i] = -1;
+        sa[--buckets[SAIS_CHAR(j)]] = j;
+    }
+    _sais_induce(s, level0, types, sa, n, k, buckets);
+
+    free(types);
+    free(buckets);
+}
+
+/**
+ * Build the suffix array index of the text, which is copied, to answer
+ * :func:`StringIndexText_contains`, :func:`StringIndexText_count` and
+ * :func:`StringIndexText_locate` without scanning it.
+ *
+ * .. note:: Has time complexity of O(n). The index takes 9 bytes per byte of text,
+ *           and about as much again while it is built.
+ *
+ * .. code-block:: c
+ *
+ *    StringT *corpus = String_from("abracadabra");
+ *    StringIndexTextT *index = StringIndexText_new(corpus);
+ *
+ *    assert(StringIndexText_count(index, String_from("abra")) == 2);
+ */
+StringIndexTextT *
+StringIndexText_new(const StringT *text) {
+    StringIndexTextT *self = calloc(1, sizeof *self);
+    int64_t *sa;
+
+    if (self == NULL) {
+        ERR("Unable to allocate memory for `StringIndexTextT`");
+    }
+
+    self->length = text->length;
+    self->text_buffer = malloc(text->length + 1);
+    // One more entry for the sentinel suffix, first in the order and dropped after.
+    sa = malloc((text->length + 1) * sizeof *sa);
+    if (self->text_buffer == NULL || sa == NULL) {
+        ERR("Unable to allocate memory for `StringIndexTextT` buffers");
+    }
+    memcpy(self->text_buffer, text->string, text->length);
+    self->text_buffer[text->length] = '\0';
+
+    _sais(text->string, true, sa, text->length + 1, 256);
+    memmove(sa, sa + 1, text->length * sizeof *sa);
+
+    self->text = self->text_buffer;
+    self->suffixes = self->suffixes_buffer = sa;
+    return self;
+}
+
+void
+StringIndexText_free(StringIndexTextT *self) {
+    if (self->mapping) {
+        munmap(self->mapping, self->mapping_size);
+    }
+    free(self->text_buffer);
+    free(self->suffixes_buffer);
+    free(self);
+}
+
+/* Serialisation */
+
+/** Internal function to get the offset of the suffix array in a saved index. */
+static inline size_t
+_index_text_suffixes_offset(uint64_t length) {
+    return sizeof(IndexTextHeaderT) + ((length + 7) & ~(uint64_t)7);
+}
+
+/**
+ * Save the index to the file at ``path``, to be loaded by :func:`StringIndexText_load`.
+ * Returns ``false`` if the file can't be written, with ``errno`` set.
+ */
+bool
+StringIndexText_save(const StringIndexTextT *self, const char *path) {
+    IndexTextHeaderT header = {.magic = INDEX_TEXT_MAGIC, .length = self->length};
+    size_t padding = _index_text_suffixes_offset(self->length) - sizeof header -
+                     self->length;
+    const char zeros[8] = {0};
+    FILE *file = fopen(path, "wb");
+    bool written;
+
+    if (file == NULL) return false;
+
+    written = fwrite(&header, sizeof header, 1, file) == 1 &&
+              fwrite(self->text, 1, self->length, file) == (size_t)self->length &&
+              fwrite(zeros, 1, padding, file) == padding &&
+              fwrite(self->suffixes, sizeof *self->suffixes, self->length, file) ==
+                  (size_t)self->length;
+
+    return fclose(file) == 0 && written;
+}
+
+/**
+ * Load an index saved by :func:`StringIndexText_save`. The file is mapped in memory
+ * rather than read, so loading takes constant time whatever its size. Returns
+ * ``NULL`` if the file can't be opened or isn't a saved index.
+ *
+ * .. note:: The file must not be modified while the index is in use.
+ *
+ * .. code-block:: c
+ *
+ *    StringIndexText_save(index, "corpus.idx");
+ *    StringIndexTextT *loaded = StringIndexText_load("corpus.idx");
+ */
+StringIndexTextT *
+StringIndexText_load(const char *path) {
+    StringIndexTextT *self;
+    IndexTextHeaderT header;
+    struct stat status;
+    void *mapping;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0) return NULL;
+    if (fstat(fd, &status) < 0 || (size_t)status.st_size < sizeof header) {
+        close(fd);
+        return NULL;
+    }
+
+    mapping = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) return NULL;
+
+    memcpy(&header, mapping, sizeof header);
+    if (memcmp(header.magic, INDEX_TEXT_MAGIC, sizeof header.magic) != 0 ||
+        header.length > (uint64_t)status.st_size ||
+        _index_text_suffixes_offset(header.length) + header.length * sizeof(int64_t) !=
+            (uint64_t)status.st_size) {
+        munmap(mapping, status.st_size);
+        return NULL;
+    }
+
+    self = calloc(1, sizeof *self);
+    if (self == NULL) {
+        ERR("Unable to allocate memory for `StringIndexTextT`");
+    }
+    self->mapping = mapping;
+    self->mapping_size = status.st_size;
+    self->length = header.length;
+    self->text = (const char *)mapping + sizeof header;
+    self->suffixes = (const int64_t *)((const char *)mapping +
+                                       _index_text_suffixes_offset(header.length));
+
+    return self;
+}
+
+/* Queries */
+
+/** Get a view of the indexed text, valid as long as the index. */
+StringT
+StringIndexText_text(const StringIndexTextT *self) {
+    return (StringT){.string = (char *)self->text, .length = self->length};
+}
+
+/**
+ * Internal function to compare the suffix at ``position`` with the pattern, only up
+ * to the length of the pattern: ``0`` when the suffix starts with it.
+ */
+static inline int
+_index_text_compare(const StringIndexTextT *self, int64_t position,
+                    const StringT *pattern) {
+    ssize_t available = self->length - position;
+    int order = memcmp(self->text + position, pattern->string,
+                       MIN_2(available, pattern->length));
+
+    if (order == 0 && available < pattern->length) return -1;
+    return order;
+}
+
+/**
+ * Internal function to find the range ``[*first, *last)`` of the suffix array of the
+ * suffixes starting with the pattern.
+ */
+static void
+_index_text_range(const StringIndexTextT *self, const StringT *pattern, ssize_t *first,
+                  ssize_t *last) {
+    ssize_t low = 0, high = self->length;
+
+    // Lower bound: first suffix not smaller than the pattern.
+    while (low < high) {
+        ssize_t middle = low + (high - low) / 2;
+
+        if (_index_text_compare(self, self->suffixes[middle], pattern) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    *first = low;
+
+    // Upper bound: first suffix greater than the pattern, from the lower bound.
+    high = self->length;
+    while (low < high) {
+        ssize_t middle = low + (high - low) / 2;
+
+        if (_index_text_compare(self, self->suffixes[middle], pattern) <= 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    *last = low;
+}
+
+/**
+ * Check if the indexed text contains the pattern. An empty pattern is never found.
+ *
+ * .. note:: Has time complexity of O(m log n).
+ */
+bool
+StringIndexText_contains(const StringIndexTextT *self, const StringT *pattern) {
+    return StringIndexText_count(self, pattern) > 0;
+}
+
+/**
+ * Count the occurrences of the pattern in the indexed text, overlapping ones
+ * included (unlike :func:`String_count`). An empty pattern is never found.
+ *
+ * .. note:: Has time complexity of O(m log n), whatever the number of occurrences.
+ *
+ * .. code-block:: c
+ *
+ *    StringIndexTextT *index = StringIndexText_new(String_from("aaaa"));
+ *
+ *    assert(StringIndexText_count(index, String_from("aa")) == 3);
+ */
+ssize_t
+StringIndexText_count(const StringIndexTextT *self, const StringT *pattern) {
+    ssize_t first, last;
+
+    if (pattern->length == 0) return 0;
+
+    _index_text_range(self, pattern, &first, &last);
+    return last - first;
+}
+
+static int
+_index_text_compare_positions(const void *a, const void *b) {
+    ssize_t left = *(const ssize_t *)a, right = *(const ssize_t *)b;
+
+    return (left > right) - (left < right);
+}
+
+/**
+ * Find the occurrences of the pattern in the indexed text. The first ``capacity`` of
+ * their positions, in increasing order, are stored in ``positions``. Returns the
+ * number of occurrences, which may be more than ``capacity``.
+ *
+ * .. note:: Has time complexity of O(m log n + k log k) for k occurrences.
+ *
+ * .. code-block:: c
+ *
+ *    StringIndexTextT *index = StringIndexText_new(String_from("abracadabra"));
+ *    ssize_t positions[4];
+ *
+ *    assert(StringIndexText_locate(index, String_from("a"), positions, 4) == 5);
+ *    assert(positions[0] == 0 && positions[3] == 7);
+ */
+ssize_t
+StringIndexText_locate(const StringIndexTextT *self, const StringT *pattern,
+                       ssize_t *positions, ssize_t capacity) {
+    ssize_t first, last, count, *sorted;
+
+    if (pattern->length == 0) return 0;
+
+    _index_text_range(self, pattern, &first, &last);
+    count = last - first;
+    if (capacity <= 0 || count == 0) return count;
+
+    sorted = malloc(count * sizeof *sorted);
+    if (sorted == NULL) {
+        ERR("Unable to allocate memory for the positions");
+    }
+    for (ssize_t i = 0; i < count; ++i) {
+        sorted[i] = self->suffixes[first + i];
+    }
+    qsort(sorted, count, sizeof *sorted, _index_text_compare_positions);
+    memcpy(positions, sorted, MIN_2(count, capacity) * sizeof *positions);
+    free(sorted);
+
+    return count;
+}
@@ -0,0 +1,259 @@
+#include "string_intern.h"
+
+#include "string_dbg.h"
+#include "string_internal.h"
+#include "string_map.h"
+#include "string_simd.h"
+
+#include <pthread.h>   /* pthread_rwlock_t */
+#include <stdatomic.h> /* atomic_long, atomic_uint */
+#include <stddef.h>    /* offsetof */
+#include <stdlib.h>    /* malloc, calloc, free */
+
+
+/*
+ * The pool is split into ``INTERN_SHARDS`` shards chosen by the top bits of the hash,
+ * each guarded by its own read-write lock, so threads interning different strings
+ * rarely wait on each other and the common "already interned" case only takes a read
+ * lock.
+ *
+ * An id packs the shard in its low ``INTERN_SHARD_BITS`` bits and the position within
+ * the shard above them. Every shard resolves positions through a table of segments
+ * which double in size and never move, so :func:`StringInternPool_get` needs no lock.
+ */
+
+#define INTERN_SHARD_BITS 4
+#define INTERN_SHARDS (1 << INTERN_SHARD_BITS)
+#define INTERN_FIRST_SEGMENT_BITS 6
+#define INTERN_SEGMENTS (32 - INTERN_SHARD_BITS - INTERN_FIRST_SEGMENT_BITS)
+#define INTERN_MAX_PER_SHARD \
+    ((1u << (32 - INTERN_SHARD_BITS)) - (1u << INTERN_FIRST_SEGMENT_BITS))
+
+/// Canonical copy of a string, ``string.string`` points at the key bytes of the map.
+typedef struct {
+    StringT string;
+    uint32_t id;
+} InternedT;
+
+typedef struct {
+    pthread_rwlock_t lock;
+    StringMapT *strings;
+    StringArenaT headers;
+
+    InternedT **segments[INTERN_SEGMENTS];
+    atomic_uint length; // Published after the slot is written, read by the lock-free get.
+} InternShardT;
+
+struct StringInternPoolT {
+    InternShardT shards[INTERN_SHARDS];
+    atomic_long length;
+};
+
+/**
+ * Internal function to locate the position ``index`` of a shard: segment ``k`` holds
+ * ``2 ** (k + INTERN_FIRST_SEGMENT_BITS)`` positions.
+ */
+static inline InternedT **
+_shard_slot(const InternShardT *shard, uint32_t index, bool allocate) {
+    uint32_t biased = index + (1u << INTERN_FIRST_SEGMENT_BITS);
+    int segment = 63 - CLZ_64(biased) - INTERN_FIRST_SEGMENT_BITS;
+    uint32_t offset = biased - (1u << (segment + INTERN_FIRST_SEGMENT_BITS));
+    InternedT ***segments = (InternedT ***)shard->segments;
+
+    if (allocate && segments[segment] == NULL) {
+        size_t count = (size_t)1 << (segment + INTERN_FIRST_SEGMENT_BITS);
+
+        segments[segment] = malloc(count * sizeof **segments);
+        if (segments[segment] == NULL) {
+            ERR("Unable to allocate memory for interned string ids");
+        }
+    }
+
+    return &segments[segment][offset];
+}
+
+/**
+ * Create and return a new, empty ``StringInternPoolT``.
+ *
+ * .. code-block:: c
+ *
+ *    StringInternPoolT *pool = StringInternPool_new();
+ *    uint32_t id1, id2;
+ *    const StringT *a = StringInternPool_intern(pool, String_from("foo"), &id1);
+ *    const StringT *b = StringInternPool_intern(pool, String_from("foo"), &id2);
+ *
+ *    assert(a == b && id1 == id2);
+ */
+StringInternPoolT *
+StringInternPool_new(void) {
+    StringInternPoolT *self = calloc(1, sizeof *self);
+
+    if (self == NULL) {
+        ERR("Unable to allocate memory for `StringInternPoolT`");
+    }
+
+    for (int i = 0; i < INTERN_SHARDS; ++i) {
+        if (pthread_rwlock_init(&self->shards[i].lock, NULL)) {
+            ERR("Unable to initialize `StringInternPoolT` lock");
+        }
+        self->shards[i].strings = StringMap_new(0);
+    }
+    atomic_init(&self->length, 0);
+
+    return self;
+}
+
+/** Internal function to pick the shard of a hash, independent of the map's bits. */
+static inline InternShardT *
+_pool_shard(StringInternPoolT *self, uint64_t hash) {
+    return &self->shards[hash >> (64 - INTERN_SHARD_BITS)];
+}
+
+/** Internal function returning the canonical string of a map entry and its id. */
+static inline const StringT *
+_entry_result(const StringMapEntryT *entry, uint32_t *id) {
+    InternedT *interned = entry->value.pointer;
+
+    if (id) *id = interned->id;
+    return &interned->string;
+}
+
+/**
+ * Intern ``length`` bytes of ``string``. See :func:`StringInternPool_intern` for more
+ * info.
+ */
+const StringT *
+StringInternPool_intern_char_array(StringInternPoolT *self, const char *string,
+                                   ssize_t length, uint32_t *id) {
+    uint64_t hash = String_hash_char_array(string, length, 0);
+    InternShardT *shard = _pool_shard(self, hash);
+    const StringT *result = NULL;
+    StringMapEntryT *entry;
+    InternedT *interned;
+    bool inserted;
+
+    // Entries move when the map grows, so they are only read under the lock.
+    pthread_rwlock_rdlock(&shard->lock);
+    entry = StringMap_find_char_array(shard->strings, string, length);
+    if (entry) {
+        result = _entry_result(entry, id);
+    }
+    pthread_rwlock_unlock(&shard->lock);
+
+    if (result) {
+        return result;
+    }
+
+    pthread_rwlock_wrlock(&shard->lock);
+    // Another thread may have inserted the string between the two locks.
+    entry = StringMap_entry_char_array(shard->strings, string, length, &inserted);
+
+    if (inserted) {
+        uint32_t index = atomic_load_explicit(&shard->length, memory_order_relaxed);
+
+        if (index >= INTERN_MAX_PER_SHARD) {
+            ERR("StringInternPool_intern: too many strings in the pool");
+        }
+
+        interned = string_arena_allocate(&shard->headers, sizeof *interned);
+        *interned = (InternedT){
+            .string = {.string = (char *)entry->key, .length = length, .hash = hash},
+            .id = (index << INTERN_SHARD_BITS) | (uint32_t)(shard - self->shards)};
+        *_shard_slot(shard, index, true) = interned;
+        atomic_store_explicit(&shard->length, index + 1, memory_order_release);
+        entry->value.pointer = interned;
+        atomic_fetch_add(&self->length, 1);
+    }
+
+    result = _entry_result(entry, id);
+    pthread_rwlock_unlock(&shard->lock);
+
+    return result;
+}
+
+/**
+ * Intern a string: return the pool's canonical copy of it, storing a copy first if the
+ * pool doesn't hold the string yet. ``id`` (may be ``NULL``) receives a stable id of
+ * the string. Safe to call from many threads at once.
+ *
+ * Equal strings always give the same canonical pointer and id, so comparing interned
+ * strings is a pointer or integer comparison.
+ *
+ * .. note:: The canonical ``StringT`` is owned by the pool, it must not be freed or
+ *           modified and stays valid until :func:`StringInternPool_free`. Its hash is
+ *           already cached.
+ */
+const StringT *
+StringInternPool_intern(StringInternPoolT *self, const StringT *string, uint32_t *id) {
+    return StringInternPool_intern_char_array(self, string->string, string->length, id);
+}
+
+/**
+ * Get the canonical copy of a string without interning it, ``NULL`` when the string is
+ * not in the pool.
+ */
+const StringT *
+StringInternPool_find(StringInternPoolT *self, const StringT *string, uint32_t *id) {
+    uint64_t hash = string->hash ? string->hash : String_hash(string);
+    InternShardT *shard = _pool_shard(self, hash);
+    const StringT *result = NULL;
+    StringMapEntryT *entry;
+
+    pthread_rwlock_rdlock(&shard->lock);
+    entry = StringMap_find(shard->strings, string);
+    if (entry) {
+        result = _entry_result(entry, id);
+    }
+    pthread_rwlock_unlock(&shard->lock);
+
+    return result;
+}
+
+/**
+ * Get the canonical string of an id returned by the pool in O(1), without locking.
+ *
+ * .. note:: If id was not returned by this pool, this function will throw an error
+ *           and exit.
+ */
+const StringT *
+StringInternPool_get(const StringInternPoolT *self, uint32_t id) {
+    const InternShardT *shard = &self->shards[id & (INTERN_SHARDS - 1)];
+
+    uint32_t length = atomic_load_explicit(&shard->length, memory_order_acquire);
+
+    if ((id >> INTERN_SHARD_BITS) >= length) {
+        ERR("StringInternPool_get: unknown id");
+    }
+
+    return &(*_shard_slot(shard, id >> INTERN_SHARD_BITS, false))->string;
+}
+
+/** Get the id of a canonical string returned by a pool, in O(1). */
+uint32_t
+StringInternPool_id(const StringT *canonical) {
+    return ((const InternedT *)((const char *)canonical - offsetof(InternedT, string)))
+        ->id;
+}
+
+/** Get the number of distinct strings in the pool. */
+ssize_t
+StringInternPool_len(const StringInternPoolT *self) {
+    return atomic_load(&self->length);
+}
+
+/** De-allocate the pool, invalidating every canonical string it returned. */
+void
+StringInternPool_free(StringInternPoolT *self) {
+    for (int i = 0; i < INTERN_SHARDS; ++i) {
+        InternShardT *shard = &self->shards[i];
+
+        pthread_rwlock_destroy(&shard->lock);
+        StringMap_free(shard->strings);
+        string_arena_free(&shard->headers);
+        for (int j = 0; j < INTERN_SEGMENTS; ++j) {
+            free(shard->segments[j]);
+        }
+    }
+
+    free(self);
+}
@@ -0,0 +1,122 @@
+#ifndef STRING_INTERNAL_H
+#define STRING_INTERNAL_H
+
+/* Helpers shared between the translation units of the library, not installed. */
+
+#include "string_char_class.h"
+#include "string_ext.h"
+
+#include <stdint.h> /* uint8_t, uint64_t */
+#include <stdlib.h> /* ssize_t */
+
+#define MAX_2(a, b) ((a > b) ? (a) : (b))
+#define MIN_2(a, b) ((a < b) ? (a) : (b))
+
+/// Whitespace characters trimmed and split on by the library.
+#define CHAR_IS_WHITESPACE(ch)                                                           \
+    ((ch) == ' ' || (ch) == '\t' || (ch) == '\n' || (ch) == '\r')
+
+/// Lowercase an ASCII letter, used for ASCII case-insensitive comparisons.
+#define CHAR_FOLD_CASE(ch) (((ch) >= 'A' && (ch) <= 'Z') ? (ch) | 0x20 : (ch))
+
+/// Capacity to grow a buffer to so that it can hold at least ``new_size`` items.
+#define GROW_CAPACITY(new_size) (((new_size) + ((new_size) >> 3) + 6) & ~3)
+
+char *string_reserve_tail(StringT *self, ssize_t size);
+ssize_t string_find_all(const StringT *self, const StringT *pattern, int flags,
+                        ssize_t limit, StringMatchesT *matches);
+
+/// Case mappings of :func:`string_case_map`.
+typedef enum {
+    CASE_UPPER,
+    CASE_LOWER,
+    CASE_FOLD,
+    CASE_SWAP,
+} CaseModeT;
+
+ssize_t string_case_map(const char *string, ssize_t length, CaseModeT mode, char *output);
+
+/// Predicate of a ``StringTestT``, see :func:`string_test_predicate`.
+typedef bool (*StringPredicateFnT)(const StringT *self);
+
+StringPredicateFnT string_test_predicate(StringTestT test);
+
+/// Pattern compiled for a Horspool search, see :func:`string_search_next`.
+typedef struct {
+    const char *pattern;
+    ssize_t length;
+    bool icase; // ASCII letters match either case.
+    // Byte of the text as compared with the pattern: folded to lowercase if `icase`.
+    unsigned char fold[256];
+    // Shift for the byte of the text aligned with the end of the pattern: the distance
+    // from its last occurrence in the pattern (not counting the end) to the end.
+    ssize_t shift[256];
+} StringSearchPatternT;
+
+void string_search_pattern_init(StringSearchPatternT *self, const StringT *pattern,
+                                bool icase);
+ssize_t string_search_next(const StringSearchPatternT *self, const char *text,
+                           ssize_t start, ssize_t stop);
+
+/// Receives the tokens of :func:`string_split_whitespace`.
+typedef void (*StringTokenFnT)(const char *string, ssize_t length, void *context);
+
+ssize_t string_split_whitespace(const char *string, ssize_t length, ssize_t limit,
+                                StringTokenFnT emit, void *context);
+
+/// Work item of :func:`string_parallel_for`, processes items ``[begin, end)``.
+typedef void (*StringParallelFnT)(ssize_t begin, ssize_t end, void *context);
+
+int string_parallel_default_threads(void);
+void string_parallel_for(ssize_t count, int threads, ssize_t grain,
+                         StringParallelFnT function, void *context);
+
+/// Set of bytes, see ``src/string_char_class.c``.
+struct StringCharClassT {
+    uint64_t bitmap[4];
+
+    /* Vectorised membership test: bit ``h`` of ``low[l]`` is set if ``h << 4 | l`` is
+     * a member, ``high`` holds the same for the high nibbles 8 to 15. Sets of at most
+     * ``CHAR_CLASS_SMALL`` bytes compare against ``bytes`` instead. */
+    uint8_t low[16];
+    uint8_t high[16];
+    uint8_t bytes[16];
+    int bytes_length;
+    bool avx2;
+};
+
+#define CHAR_CLASS_SMALL 4
+#define CHAR_CLASS_HAS(self, ch)                                                         \
+    ((self)->bitmap[(unsigned char)(ch) >> 6] >> ((unsigned char)(ch) & 63) & 1)
+
+void string_char_class_init(StringCharClassT *self, const char *characters,
+                            ssize_t length);
+ssize_t string_char_class_find(const StringCharClassT *self, const char *string,
+                               ssize_t start, ssize_t stop);
+
+/// Pattern compiled for the bit-parallel edit distance, see ``src/string_distance.c``.
+typedef struct {
+    ssize_t length;
+    ssize_t words;
+    uint64_t last_bit; /* Bit of the last byte of the pattern in its last word. */
+    uint64_t *masks;   /* ``masks[ch * words + w]``, the positions of ``ch``. */
+    uint64_t single[256];
+} StringEditPatternT;
+
+void string_edit_pattern_init(StringEditPatternT *self, const char *pattern,
+                              ssize_t length);
+void string_edit_pattern_free(StringEditPatternT *self);
+ssize_t string_edit_distance(const StringEditPatternT *self, const char *text,
+                             ssize_t length, ssize_t max_distance);
+
+/// Bump allocator whose allocations never move, released all at once.
+typedef struct StringArenaBlockT StringArenaBlockT;
+typedef struct {
+    StringArenaBlockT *head;
+} StringArenaT;
+
+void *string_arena_allocate(StringArenaT *self, size_t size);
+size_t string_arena_memory(const StringArenaT *self);
+void string_arena_free(StringArenaT *self);
+
+#endif /* STRING_INTERNAL_H */
@@ -0,0 +1,303 @@
+#include "string_ext.h"
+
+#include "string_dbg.h"
+#include "string_internal.h"
+#include "string_simd.h"
+
+#include <stdint.h> /* uint32_t */
+#include <string.h> /* memchr, memcpy */
+
+
+/*
+ * Escaping and unescaping of JSON string contents (RFC 8259).
+ *
+ * Bytes which must be escaped (``"``, ``\`` and the control characters) are found 16
+ * at a time, the clean runs in between are copied with ``memcpy``. Escaping measures
+ * the result before writing it, so the output is grown exactly once.
+ */
+
+static const char JSON_HEX[] = "0123456789abcdef";
+
+/// Short escape of each control character, ``0`` for those written as ``\u00XX``.
+static const char JSON_SHORT_ESCAPES[0x20] = {
+    ['\b'] = 'b', ['\f'] = 'f', ['\n'] = 'n', ['\r'] = 'r', ['\t'] = 't'};
+
+#define JSON_NEEDS_ESCAPE(ch) ((unsigned char)(ch) < 0x20 || (ch) == '"' || (ch) == '\\')
+
+/** Internal function to find the next byte from ``index`` which must be escaped. */
+static inline ssize_t
+_json_next_special(const char *string, ssize_t index, ssize_t length) {
+#ifdef STRING_SIMD_X86
+    for (; index + 16 <= length; index += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)(string + index));
+        __m128i special = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('"')),
+                         _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\\'))),
+            // Unsigned ``bytes <= 0x1F``.
+            _mm_cmpeq_epi8(_mm_min_epu8(bytes, _mm_set1_epi8(0x1F)), bytes));
+        int mask = _mm_movemask_epi8(special);
+
+        if (mask) {
+            return index + CTZ_64(mask);
+        }
+    }
+#endif
+
+    while (index < length && !JSON_NEEDS_ESCAPE(string[index])) {
+        index++;
+    }
+
+    return index;
+}
+
+/** Internal function to measure the escaped string. */
+static ssize_t
+_json_escaped_length(const StringT *self) {
+    ssize_t size = self->length;
+
+    // Every special byte takes 2 bytes, or 6 as ``\u00XX``.
+    for (ssize_t index = _json_next_special(self->string, 0, self->length);
+         index < self->length;
+         index = _json_next_special(self->string, index + 1, self->length)) {
+        unsigned char ch = self->string[index];
+
+        size += ch < 0x20 && !JSON_SHORT_ESCAPES[ch] ? 5 : 1;
+    }
+
+    return size;
+}
+
+/** Internal function to write the escaped string to ``cursor``. */
+static void
+_json_escape_write(const StringT *self, char *cursor) {
+    const char *string = self->string;
+
+    for (ssize_t index = 0, run; index < self->length; index = run + 1) {
+        unsigned char ch;
+
+        run = _json_next_special(string, index, self->length);
+        memcpy(cursor, string + index, run - index);
+        cursor += run - index;
+        if (run == self->length) break;
+
+        ch = string[run];
+        *cursor++ = '\\';
+        if (ch >= 0x20) {
+            *cursor++ = ch;
+        } else if (JSON_SHORT_ESCAPES[ch]) {
+            *cursor++ = JSON_SHORT_ESCAPES[ch];
+        } else {
+            memcpy(cursor, "u00", 3);
+            cursor[3] = JSON_HEX[ch >> 4];
+            cursor[4] = JSON_HEX[ch & 0xF];
+            cursor += 5;
+        }
+    }
+}
+
+/**
+ * Escape the string as the contents of a JSON string and append the result to
+ * ``output``. The enclosing quotes are not written. See :func:`String_json_escape`.
+ *
+ * .. note:: ``output`` is grown at most once, by the exact size of the result.
+ */
+void
+String_json_escape_into(StringT *output, const StringT *self) {
+    ssize_t size = _json_escaped_length(self);
+
+    _json_escape_write(self, string_reserve_tail(output, size));
+    output->length += size;
+    output->string[output->length] = '\0';
+}
+
+/**
+ * Escape the string as the contents of a JSON string and return the escaped string,
+ * without the enclosing quotes. ``"`` and ``\`` are escaped with a backslash, control
+ * characters with their short escape (e.g. ``\n``) or as ``\u00XX``. Other bytes,
+ * including UTF-8 sequences, are kept as they are.
+ *
+ * .. note:: Has time complexity of O(n). The bytes to escape are found 16 at a time
+ *           and the result is allocated exactly once.
+ *
+ * .. code-block:: c
+ *
+ *    StringT *string = String_from("say \"hi\"\n");
+ *    StringT *escaped = String_json_escape(string);
+ *
+ *    assert(String_eq(escaped, "say \\\"hi\\\"\\n"));
+ */
+StringT *
+String_json_escape(const StringT *self) {
+    ssize_t size = _json_escaped_length(self);
+    StringT *output = String_new(size + 1);
+
+    _json_escape_write(self, output->string);
+    output->length = size;
+    output->string[size] = '\0';
+
+    return output;
+}
+
+/** Internal function to read the 4 hexadecimal digits of a ``\u`` escape. */
+static bool
+_json_read_hex(const char *string, uint32_t *value) {
+    *value = 0;
+
+    for (int i = 0; i < 4; ++i) {
+        char ch = string[i];
+        uint32_t digit;
+
+        if (ch >= '0' && ch <= '9') {
+            digit = ch - '0';
+        } else if ((ch | 0x20) >= 'a' && (ch | 0x20) <= 'f') {
+            digit = (ch | 0x20) - 'a' + 10;
+        } else {
+            return false;
+        }
+        *value = *value << 4 | digit;
+    }
+
+    return true;
+}
+
+/**
+ * Internal function to decode the escape sequence at ``string[index]`` (just after
+ * the backslash) into ``cursor``. Returns the number of bytes consumed, or ``0`` if
+ * it isn't a valid escape. ``*written`` receives the number of bytes written.
+ */
+static ssize_t
+_json_unescape_one(const char *string, ssize_t index, ssize_t length, char *cursor,
+                   int *written) {
+    uint32_t code_point, low;
+
+    if (index >= length) return 0;
+
+    *written = 1;
+    switch (string[index]) {
+    case '"':
+    case '\\':
+    case '/':
+        *cursor = string[index];
+        return 1;
+    case 'b':
+        *cursor = '\b';
+        return 1;
+    case 'f':
+        *cursor = '\f';
+        return 1;
+    case 'n':
+        *cursor = '\n';
+        return 1;
+    case 'r':
+        *cursor = '\r';
+        return 1;
+    case 't':
+        *cursor = '\t';
+        return 1;
+    case 'u':
+        break;
+    default:
+        return 0;
+    }
+
+    if (index + 5 > length || !_json_read_hex(string + index + 1, &code_point)) {
+        return 0;
+    }
+    if (code_point >= 0xDC00 && code_point <= 0xDFFF) {
+        return 0; // Low surrogate without its high surrogate.
+    }
+    if (code_point >= 0xD800 && code_point <= 0xDBFF) {
+        if (index + 11 > length || string[index + 5] != '\\' ||
+            string[index + 6] != 'u' || !_json_read_hex(string + index + 7, &low) ||
+            low < 0xDC00 || low > 0xDFFF) {
+            return 0;
+        }
+        code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+    }
+
+    if (code_point < 0x80) {
+        cursor[0] = (char)code_point;
+    } else if (code_point < 0x800) {
+        cursor[0] = (char)(0xC0 | (code_point >> 6));
+        cursor[1] = (char)(0x80 | (code_point & 0x3F));
+        *written = 2;
+    } else if (code_point < 0x10000) {
+        cursor[0] = (char)(0xE0 | (code_point >> 12));
+        cursor[1] = (char)(0x80 | ((code_point >> 6) & 0x3F));
+        cursor[2] = (char)(0x80 | (code_point & 0x3F));
+        *written = 3;
+    } else {
+        cursor[0] = (char)(0xF0 | (code_point >> 18));
+        cursor[1] = (char)(0x80 | ((code_point >> 12) & 0x3F));
+        cursor[2] = (char)(0x80 | ((code_point >> 6) & 0x3F));
+        cursor[3] = (char)(0x80 | (code_point & 0x3F));
+        *written = 4;
+    }
+
+    return code_point >= 0x10000 ? 11 : 5;
+}
+
+/**
+ * Resolve the escapes of the contents of a JSON string and append the result to
+ * ``output``. Returns ``false`` and leaves ``output`` unchanged if the string holds an
+ * invalid escape. See :func:`String_json_unescape`.
+ */
+bool
+String_json_unescape_into(StringT *output, const StringT *self) {
+    const char *string = self->string, *backslash;
+    ssize_t index = 0;
+    char *start = string_reserve_tail(output, self->length), *cursor = start;
+
+    // Escapes are never shorter than what they decode to, the input length is enough.
+    while ((backslash = memchr(string + index, '\\', self->length - index)) != NULL) {
+        ssize_t run = backslash - (string + index), consumed;
+        int written;
+
+        memcpy(cursor, string + index, run);
+        cursor += run;
+        index += run + 1;
+
+        consumed = _json_unescape_one(string, index, self->length, cursor, &written);
+        if (!consumed) {
+            output->string[output->length] = '\0';
+            return false;
+        }
+        cursor += written;
+        index += consumed;
+    }
+
+    memcpy(cursor, string + index, self->length - index);
+    cursor += self->length - index;
+
+    output->length += cursor - start;
+    output->string[output->length] = '\0';
+    return true;
+}
+
+/**
+ * Resolve the escapes of the contents of a JSON string and return the unescaped
+ * string, or ``NULL`` if it holds an invalid escape. ``\uXXXX`` escapes are decoded to
+ * UTF-8, surrogate pairs included; a lone surrogate is invalid.
+ *
+ * .. note:: Has time complexity of O(n). Runs without escapes are copied with
+ *           ``memcpy`` and the result is allocated exactly once.
+ *
+ * .. code-block:: c
+ *
+ *    StringT *string = String_from("caf\\u00e9 \\ud83d\\ude00");
+ *    StringT *unescaped = String_json_unescape(string);
+ *
+ *    assert(String_eq(unescaped, "café 😀"));
+ */
+StringT *
+String_json_unescape(const StringT *self) {
+    StringT *output = String_new(self->length + 1);
+
+    output->string[0] = '\0';
+    if (!String_json_unescape_into(output, self)) {
+        String_free(output);
+        return NULL;
+    }
+
+    return output;
+}
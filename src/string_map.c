@@ -0,0 +1,473 @@
+#include "string_map.h"
+
+#include "string_dbg.h"
+#include "string_internal.h"
+#include "string_simd.h"
+
+#include <stdlib.h> /* aligned_alloc, free */
+#include <string.h> /* memcmp, memcpy, memset */
+
+
+/*
+ * ``StringMapT`` is a Swiss table: slots are split into groups of ``MAP_GROUP``, and
+ * every slot has a control byte holding either ``CONTROL_EMPTY``, ``CONTROL_DELETED``
+ * or the low 7 bits of the hash of its key. A lookup compares the control bytes of a
+ * whole group against the hash with one SIMD compare and only touches the entries
+ * whose control byte matched, then moves to the next group (triangular probing) until
+ * it finds a group with an empty slot.
+ *
+ * Key bytes are copied into an arena so entries stay 32 bytes. The bytes of removed
+ * keys are only reclaimed by compacting the arena: live keys are copied into a new
+ * arena by the re-hash which purges the deleted slots, or once removed keys take more
+ * room than the live ones. Keys of a map without removals never move.
+ */
+
+#define MAP_GROUP 16
+#define MAP_MIN_CAPACITY 16
+#define CONTROL_EMPTY ((signed char)-128)
+#define CONTROL_DELETED ((signed char)-2)
+
+/// Maximum number of used (live or deleted) slots before the map grows, 7/8 full.
+#define MAP_MAX_LOAD(capacity) ((capacity) - (capacity) / 8)
+/// Bytes of removed keys always tolerated in the arena before it is compacted.
+#define MAP_MIN_DEAD_KEY_BYTES (64 * 1024)
+
+#define HASH_TAG(hash) ((signed char)((hash) & 0x7f))
+#define HASH_GROUP(hash) ((hash) >> 7)
+
+struct StringMapT {
+    signed char *control;
+    StringMapEntryT *entries;
+
+    ssize_t capacity;
+    ssize_t length;
+    ssize_t tombstones;
+
+    StringArenaT keys;
+    ssize_t key_bytes;      // Bytes of the live keys in `keys`.
+    ssize_t dead_key_bytes; // Bytes of the removed keys still in `keys`.
+};
+
+/** Internal function returning a bit mask of the slots of a group holding ``tag``. */
+static inline unsigned
+_group_match(const signed char *control, signed char tag) {
+#ifdef STRING_SIMD_X86
+    __m128i group = _mm_load_si128((const __m128i *)control);
+
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(tag)));
+#else
+    unsigned mask = 0;
+
+    for (int i = 0; i < MAP_GROUP; ++i) {
+        mask |= (unsigned)(control[i] == tag) << i;
+    }
+    return mask;
+#endif
+}
+
+/**
+ * Internal function returning a bit mask of the slots of a group which are free,
+ * empty and deleted control bytes are the only negative ones.
+ */
+static inline unsigned
+_group_match_free(const signed char *control) {
+#ifdef STRING_SIMD_X86
+    return _mm_movemask_epi8(_mm_load_si128((const __m128i *)control));
+#else
+    unsigned mask = 0;
+
+    for (int i = 0; i < MAP_GROUP; ++i) {
+        mask |= (unsigned)(control[i] < 0) << i;
+    }
+    return mask;
+#endif
+}
+
+/** Internal function to allocate the slot arrays of a map with ``capacity`` slots. */
+static void
+_map_allocate(StringMapT *self, ssize_t capacity) {
+    self->control = aligned_alloc(MAP_GROUP, capacity);
+    self->entries = malloc(capacity * sizeof *self->entries);
+
+    if (self->control == NULL || self->entries == NULL) {
+        ERR("Unable to allocate memory for `StringMapT` slots");
+    }
+
+    memset(self->control, CONTROL_EMPTY, capacity);
+    self->capacity = capacity;
+    self->tombstones = 0;
+}
+
+/**
+ * Internal function to find the first free slot on the probe sequence of ``hash``.
+ * The map must have at least one free slot.
+ */
+static ssize_t
+_map_find_free(const StringMapT *self, uint64_t hash) {
+    ssize_t group_mask = self->capacity / MAP_GROUP - 1;
+    ssize_t group = HASH_GROUP(hash) & group_mask;
+
+    for (ssize_t step = 1;; group = (group + step++) & group_mask) {
+        unsigned free_slots = _group_match_free(self->control + group * MAP_GROUP);
+
+        if (free_slots) {
+            return group * MAP_GROUP + CTZ_64(free_slots);
+        }
+    }
+}
+
+/** Internal function to copy the key of an entry into ``arena``. */
+static inline void
+_map_copy_key(StringArenaT *arena, StringMapEntryT *entry) {
+    char *key = string_arena_allocate(arena, entry->length + 1);
+
+    memcpy(key, entry->key, entry->length + 1);
+    entry->key = key;
+}
+
+/**
+ * Internal function to move every live entry into slot arrays of a new capacity.
+ * The keys are compacted on the way when some were removed.
+ */
+static void
+_map_rehash(StringMapT *self, ssize_t capacity) {
+    signed char *old_control = self->control;
+    StringMapEntryT *old_entries = self->entries;
+    ssize_t old_capacity = self->capacity;
+    StringArenaT keys = {NULL};
+    bool compact = self->dead_key_bytes > 0;
+
+    DBG("Re-hashing `StringMapT` from %ld to %ld slots", old_capacity, capacity);
+    _map_allocate(self, capacity);
+
+    for (ssize_t i = 0; i < old_capacity; ++i) {
+        ssize_t slot;
+
+        if (old_control[i] < 0) continue;
+
+        slot = _map_find_free(self, old_entries[i].hash);
+        self->control[slot] = old_control[i];
+        self->entries[slot] = old_entries[i];
+        if (compact) _map_copy_key(&keys, &self->entries[slot]);
+    }
+
+    if (compact) {
+        string_arena_free(&self->keys);
+        self->keys = keys;
+        self->dead_key_bytes = 0;
+    }
+    free(old_control);
+    free(old_entries);
+}
+
+/**
+ * Internal function to copy the live keys into a new arena, releasing the bytes of
+ * the removed keys. Used when keys are removed without leaving deleted slots, which
+ * never trigger the re-hash.
+ */
+static void
+_map_compact_keys(StringMapT *self) {
+    StringArenaT keys = {NULL};
+
+    DBG("Compacting `StringMapT` keys, %ld bytes removed", self->dead_key_bytes);
+    for (ssize_t i = 0; i < self->capacity; ++i) {
+        if (self->control[i] >= 0) _map_copy_key(&keys, &self->entries[i]);
+    }
+
+    string_arena_free(&self->keys);
+    self->keys = keys;
+    self->dead_key_bytes = 0;
+}
+
+/**
+ * Internal lookup, returns the slot holding the key or ``-1``.
+ * Only entries whose 7 bit tag matches are compared, and the full hash and the length
+ * are checked before the bytes.
+ */
+static ssize_t
+_map_lookup(const StringMapT *self, const char *key, ssize_t length, uint64_t hash) {
+    ssize_t group_mask = self->capacity / MAP_GROUP - 1;
+    ssize_t group = HASH_GROUP(hash) & group_mask;
+    signed char tag = HASH_TAG(hash);
+
+    for (ssize_t step = 1;; group = (group + step++) & group_mask) {
+        const signed char *control = self->control + group * MAP_GROUP;
+
+        for (unsigned match = _group_match(control, tag); match; match &= match - 1) {
+            ssize_t slot = group * MAP_GROUP + CTZ_64(match);
+            const StringMapEntryT *entry = &self->entries[slot];
+
+            if (entry->hash == hash && entry->length == length &&
+                !memcmp(entry->key, key, length)) {
+                return slot;
+            }
+        }
+
+        if (_group_match(control, CONTROL_EMPTY) || step > group_mask + 1) {
+            return -1;
+        }
+    }
+}
+
+/** Internal function to get the hash of a key, reusing a hash cached in the key. */
+static inline uint64_t
+_key_hash(const StringT *key) {
+    return key->hash ? key->hash : String_hash(key);
+}
+
+/**
+ * Create and return a new ``StringMapT`` able to hold ``capacity`` keys before it has
+ * to grow.
+ *
+ * .. code-block:: c
+ *
+ *    StringMapT *map = StringMap_new(0);
+ *    StringMap_set(map, String_from("foo"), value);
+ *
+ *    assert(StringMap_get(map, String_from("foo")) == value);
+ */
+StringMapT *
+StringMap_new(ssize_t capacity) {
+    StringMapT *self = malloc(sizeof *self);
+    ssize_t slots = MAP_MIN_CAPACITY;
+
+    if (self == NULL) {
+        ERR("Unable to allocate memory for `StringMapT`");
+    }
+
+    while (MAP_MAX_LOAD(slots) < capacity) {
+        slots <<= 1;
+    }
+
+    *self = (StringMapT){.length = 0, .keys = {NULL}};
+    _map_allocate(self, slots);
+    return self;
+}
+
+/** Get the number of keys stored in the map. */
+ssize_t
+StringMap_len(const StringMapT *self) {
+    return self->length;
+}
+
+/**
+ * Find the entry of ``length`` bytes of ``key``, without building a ``StringT``.
+ * Returns ``NULL`` when the key is not present.
+ */
+StringMapEntryT *
+StringMap_find_char_array(const StringMapT *self, const char *key, ssize_t length) {
+    ssize_t slot = _map_lookup(self, key, length, String_hash_char_array(key, length, 0));
+
+    return slot < 0 ? NULL : &self->entries[slot];
+}
+
+/**
+ * Find the entry of ``key``, ``NULL`` when the key is not present.
+ *
+ * .. note:: A hash cached by :func:`String_hash_cached` is reused.
+ */
+StringMapEntryT *
+StringMap_find(const StringMapT *self, const StringT *key) {
+    ssize_t slot = _map_lookup(self, key->string, key->length, _key_hash(key));
+
+    return slot < 0 ? NULL : &self->entries[slot];
+}
+
+/** Internal find-or-insert shared by the ``StringT`` and ``char *`` entry points. */
+static StringMapEntryT *
+_map_entry(StringMapT *self, const char *key, ssize_t length, uint64_t hash,
+           bool *inserted) {
+    ssize_t slot = _map_lookup(self, key, length, hash);
+    char *key_copy;
+
+    if (inserted) *inserted = slot < 0;
+    if (slot >= 0) return &self->entries[slot];
+
+    if (self->length + self->tombstones >= MAP_MAX_LOAD(self->capacity)) {
+        // Only grow when live keys fill half the map, otherwise purging the deleted
+        // slots frees enough room.
+        bool grow = self->length >= MAP_MAX_LOAD(self->capacity) / 2;
+        _map_rehash(self, grow ? self->capacity << 1 : self->capacity);
+    } else if (self->dead_key_bytes > MAX_2(self->key_bytes, MAP_MIN_DEAD_KEY_BYTES)) {
+        _map_compact_keys(self);
+    }
+
+    key_copy = string_arena_allocate(&self->keys, length + 1);
+    memcpy(key_copy, key, length);
+    key_copy[length] = '\0';
+    self->key_bytes += length + 1;
+
+    slot = _map_find_free(self, hash);
+    if (self->control[slot] == CONTROL_DELETED) {
+        self->tombstones--;
+    }
+    self->control[slot] = HASH_TAG(hash);
+    self->entries[slot] = (StringMapEntryT){
+        .key = key_copy, .length = length, .hash = hash, .value = {NULL}};
+    self->length++;
+
+    return &self->entries[slot];
+}
+
+/**
+ * Find the entry of ``length`` bytes of ``key``, inserting it with a zeroed value when
+ * it is missing. ``inserted`` (may be ``NULL``) tells which case happened.
+ *
+ * .. note:: The returned pointer is invalidated by the next insertion.
+ */
+StringMapEntryT *
+StringMap_entry_char_array(StringMapT *self, const char *key, ssize_t length,
+                           bool *inserted) {
+    return _map_entry(self, key, length, String_hash_char_array(key, length, 0),
+                      inserted);
+}
+
+/**
+ * Find the entry of ``key``, inserting it with a zeroed value when it is missing.
+ * See :func:`StringMap_entry_char_array` for more info.
+ */
+StringMapEntryT *
+StringMap_entry(StringMapT *self, const StringT *key, bool *inserted) {
+    return _map_entry(self, key->string, key->length, _key_hash(key), inserted);
+}
+
+/**
+ * Iterate over the entries of the map in no particular order. ``cursor`` must start
+ * at ``0``, ``NULL`` is returned once every entry has been visited.
+ *
+ * .. code-block:: c
+ *
+ *    ssize_t cursor = 0;
+ *    StringMapEntryT *entry;
+ *
+ *    while ((entry = StringMap_next(map, &cursor))) {
+ *        printf("%s: %ld\n", entry->key, entry->value.integer);
+ *    }
+ */
+StringMapEntryT *
+StringMap_next(const StringMapT *self, ssize_t *cursor) {
+    for (; *cursor < self->capacity; ++*cursor) {
+        if (self->control[*cursor] >= 0) {
+            return &self->entries[(*cursor)++];
+        }
+    }
+
+    return NULL;
+}
+
+/** Map ``key`` to a pointer, replacing the previous value if any. */
+void
+StringMap_set(StringMapT *self, const StringT *key, void *value) {
+    StringMap_entry(self, key, NULL)->value.pointer = value;
+}
+
+/** Get the pointer ``key`` maps to, ``NULL`` when the key is not present. */
+void *
+StringMap_get(const StringMapT *self, const StringT *key) {
+    StringMapEntryT *entry = StringMap_find(self, key);
+
+    return entry ? entry->value.pointer : NULL;
+}
+
+/** Map ``key`` to an integer, replacing the previous value if any. */
+void
+StringMap_set_int(StringMapT *self, const StringT *key, int64_t value) {
+    StringMap_entry(self, key, NULL)->value.integer = value;
+}
+
+/** Get the integer ``key`` maps to, ``missing`` when the key is not present. */
+int64_t
+StringMap_get_int(const StringMapT *self, const StringT *key, int64_t missing) {
+    StringMapEntryT *entry = StringMap_find(self, key);
+
+    return entry ? entry->value.integer : missing;
+}
+
+/**
+ * Add ``delta`` to the integer stored for ``length`` bytes of ``key`` and return the
+ * new value. Missing keys start at ``0``, which makes token counting a single call.
+ *
+ * .. code-block:: c
+ *
+ *    StringMapT *counts = StringMap_new(0);
+ *    StringMap_increment_char_array(counts, "foo", 3, 1);
+ *
+ *    assert(StringMap_increment_char_array(counts, "foo", 3, 1) == 2);
+ */
+int64_t
+StringMap_increment_char_array(StringMapT *self, const char *key, ssize_t length,
+                               int64_t delta) {
+    return StringMap_entry_char_array(self, key, length, NULL)->value.integer += delta;
+}
+
+/** Add ``delta`` to the integer stored for ``key`` and return the new value. */
+int64_t
+StringMap_increment(StringMapT *self, const StringT *key, int64_t delta) {
+    return StringMap_entry(self, key, NULL)->value.integer += delta;
+}
+
+/** Internal function to free a slot, see :func:`StringMap_remove_char_array`. */
+static bool
+_map_remove_slot(StringMapT *self, ssize_t slot) {
+    ssize_t group;
+
+    if (slot < 0) return false;
+
+    group = slot / MAP_GROUP * MAP_GROUP;
+
+    // A probe only continues past a group without empty slots. If this group still has
+    // one, no probe depends on the slot being occupied and it can become empty again.
+    if (_group_match(self->control + group, CONTROL_EMPTY)) {
+        self->control[slot] = CONTROL_EMPTY;
+    } else {
+        self->control[slot] = CONTROL_DELETED;
+        self->tombstones++;
+    }
+    self->key_bytes -= self->entries[slot].length + 1;
+    self->dead_key_bytes += self->entries[slot].length + 1;
+    self->length--;
+
+    return true;
+}
+
+/**
+ * Remove ``length`` bytes of ``key`` from the map, returns whether it was present.
+ *
+ * .. note:: The bytes of the key are reclaimed by a later insertion, which may move
+ *           the other keys when it compacts them.
+ */
+bool
+StringMap_remove_char_array(StringMapT *self, const char *key, ssize_t length) {
+    return _map_remove_slot(
+        self, _map_lookup(self, key, length, String_hash_char_array(key, length, 0)));
+}
+
+/** Remove ``key`` from the map, returns whether it was present. */
+bool
+StringMap_remove(StringMapT *self, const StringT *key) {
+    return _map_remove_slot(self, _map_lookup(self, key->string, key->length,
+                                              _key_hash(key)));
+}
+
+/**
+ * Get the number of bytes allocated by the map for its slots and the copies of its
+ * keys, removed keys not yet reclaimed included.
+ */
+ssize_t
+StringMap_memory(const StringMapT *self) {
+    return self->capacity * (ssize_t)(1 + sizeof *self->entries) +
+           (ssize_t)string_arena_memory(&self->keys);
+}
+
+/**
+ * De-allocate the map and the copies of its keys.
+ *
+ * .. note:: Values are not freed, pointers stored in the map belong to the caller.
+ */
+void
+StringMap_free(StringMapT *self) {
+    string_arena_free(&self->keys);
+    free(self->control);
+    free(self->entries);
+    free(self);
+}
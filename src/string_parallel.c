@@ -0,0 +1,87 @@
+#include "string_dbg.h"
+#include "string_internal.h"
+
+#include <pthread.h>   /* pthread_create, pthread_join */
+#include <stdatomic.h> /* atomic_fetch_add */
+#include <stdlib.h>    /* malloc, free */
+#include <unistd.h>    /* sysconf */
+
+
+typedef struct {
+    StringParallelFnT function;
+    void *context;
+
+    ssize_t count;
+    ssize_t grain;
+    atomic_long next;
+} ParallelJobT;
+
+/**
+ * Internal worker loop, repeatedly claims the next ``grain`` sized range of the job
+ * until every item has been handed out.
+ */
+static void *
+_parallel_worker(void *argument) {
+    ParallelJobT *job = argument;
+    ssize_t begin;
+
+    while ((begin = atomic_fetch_add(&job->next, job->grain)) < job->count) {
+        job->function(begin, MIN_2(begin + job->grain, job->count), job->context);
+    }
+
+    return NULL;
+}
+
+/** Number of threads to use when the caller asks for "as many as possible". */
+int
+string_parallel_default_threads(void) {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return online > 0 ? (int)online : 1;
+}
+
+/**
+ * Call ``function`` over ``[0, count)`` split into ranges of at most ``grain`` items,
+ * spread over ``threads`` threads. Ranges are claimed dynamically so uneven work is
+ * balanced. A ``threads`` value <= 0 uses one thread per online CPU.
+ *
+ * .. note:: The calling thread takes part in the work, so ``threads == 1`` never
+ *           spawns a thread.
+ */
+void
+string_parallel_for(ssize_t count, int threads, ssize_t grain, StringParallelFnT function,
+                    void *context) {
+    ParallelJobT job = {
+        .function = function, .context = context, .count = count, .grain = grain};
+    pthread_t *workers;
+    int spawned = 0;
+
+    if (grain < 1) job.grain = 1;
+    if (threads <= 0) threads = string_parallel_default_threads();
+    threads = MIN_2(threads, (count + job.grain - 1) / job.grain);
+    atomic_init(&job.next, 0);
+
+    if (threads <= 1) {
+        if (count > 0) function(0, count, context);
+        return;
+    }
+
+    workers = malloc((threads - 1) * sizeof *workers);
+    if (workers == NULL) {
+        ERR("Unable to allocate memory for worker threads");
+    }
+
+    for (; spawned < threads - 1; ++spawned) {
+        if (pthread_create(&workers[spawned], NULL, _parallel_worker, &job)) {
+            DBG("Unable to spawn worker %d, continuing with fewer threads", spawned);
+            break;
+        }
+    }
+
+    _parallel_worker(&job);
+
+    for (int i = 0; i < spawned; ++i) {
+        pthread_join(workers[i], NULL);
+    }
+    free(workers);
+}
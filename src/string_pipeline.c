@@ -0,0 +1,409 @@
+#include "string_pipeline.h"
+
+#include "string_dbg.h"
+#include "string_internal.h"
+
+#include <stdlib.h> /* malloc, realloc, free */
+#include <string.h> /* memcpy */
+
+
+/*
+ * A pipeline cuts its input into pieces with its split stage, passes every piece
+ * through the per-piece stages in the order they were added and appends the pieces
+ * which survive to the output, separated by the join delimiter.
+ *
+ * Pieces are views: splitting and trimming only move pointers, and stages which
+ * rewrite bytes (case mapping, replace) write into one of two scratch buffers which
+ * are reused for every piece. A run thus allocates the output and the scratch
+ * buffers only, whatever the number of pieces, and never materialises the
+ * intermediate ``StringT`` or ``StringIteratorT`` objects of the equivalent chain of
+ * calls. The delimiter and the replaced strings are compiled for the Horspool search
+ * of the library once, when their stage is added.
+ */
+
+typedef enum {
+    SPLIT_NONE,
+    SPLIT_DELIMITER,
+    SPLIT_WHITESPACE,
+} SplitKindT;
+
+typedef enum {
+    STAGE_TRANSFORM,
+    STAGE_REPLACE,
+    STAGE_FILTER,
+    STAGE_DROP_EMPTY,
+} StageKindT;
+
+typedef struct {
+    StageKindT kind;
+
+    StringTransformT transform;
+    StringPredicateFnT predicate;
+    bool keep;
+    StringT *old;
+    StringT *new;
+    StringSearchPatternT search; // Compiled `old`.
+} StageT;
+
+struct StringPipelineT {
+    SplitKindT split;
+    StringT *delimiter;
+    StringSearchPatternT delimiter_search;
+    StringT *join;
+
+    StageT *stages;
+    ssize_t length;
+    ssize_t allocated;
+};
+
+/// Piece of the input, or of a scratch buffer once a stage rewrote it.
+typedef struct {
+    const char *string;
+    ssize_t length;
+} PieceT;
+
+typedef struct {
+    char *bytes;
+    ssize_t allocated;
+} ScratchT;
+
+/// State of a run, receives the pieces of the split stage.
+typedef struct {
+    const StringPipelineT *pipeline;
+    StringT *output;
+    ScratchT scratch[2];
+    bool first;
+} RunT;
+
+/**
+ * Create an empty pipeline. Without a split stage the whole input is one piece and
+ * without a join stage the pieces are concatenated.
+ *
+ * .. code-block:: c
+ *
+ *    StringPipelineT *pipeline = StringPipeline_new();
+ *    StringPipeline_split(pipeline, String_from(","));
+ *    StringPipeline_transform(pipeline, STRING_TRANSFORM_TRIM_WHITESPACE);
+ *    StringPipeline_drop_empty(pipeline);
+ *    StringPipeline_join(pipeline, String_from(";"));
+ *
+ *    assert(String_eq(StringPipeline_run(pipeline, String_from(" a, ,b ")), "a;b"));
+ */
+StringPipelineT *
+StringPipeline_new(void) {
+    StringPipelineT *self = malloc(sizeof *self);
+
+    if (self == NULL) {
+        ERR("Unable to allocate memory for `StringPipelineT`");
+    }
+
+    *self = (StringPipelineT){.split = SPLIT_NONE};
+    return self;
+}
+
+/** Internal function to append a per-piece stage to the pipeline. */
+static void
+_pipeline_add(StringPipelineT *self, StageT stage) {
+    if (self->length == self->allocated) {
+        self->allocated = GROW_CAPACITY(self->length + 1);
+        self->stages = realloc(self->stages, self->allocated * sizeof *self->stages);
+        if (self->stages == NULL) {
+            ERR("Unable to allocate memory for pipeline stages");
+        }
+    }
+
+    self->stages[self->length++] = stage;
+}
+
+/** Internal function to set the split stage, which must come first. */
+static void
+_pipeline_set_split(StringPipelineT *self, SplitKindT split, const StringT *delimiter) {
+    if (self->split != SPLIT_NONE || self->length) {
+        ERR("StringPipeline_split: the pipeline must start with its only split stage");
+    }
+    if (delimiter && !delimiter->length) {
+        ERR("StringPipeline_split: the delimiter must not be empty");
+    }
+
+    self->split = split;
+    self->delimiter = NULL;
+    if (delimiter) {
+        self->delimiter = String_copy(delimiter);
+        string_search_pattern_init(&self->delimiter_search, self->delimiter, false);
+    }
+}
+
+/**
+ * Split the input by the delimiter, see :func:`String_split`. The split stage must be
+ * the first stage of the pipeline.
+ */
+void
+StringPipeline_split(StringPipelineT *self, const StringT *delimiter) {
+    _pipeline_set_split(self, SPLIT_DELIMITER, delimiter);
+}
+
+/** Split the input into lines, see :func:`String_split_lines`. */
+void
+StringPipeline_split_lines(StringPipelineT *self) {
+    StringT *newline = String_from("\n");
+
+    _pipeline_set_split(self, SPLIT_DELIMITER, newline);
+    String_free(newline);
+}
+
+/**
+ * Split the input on runs of whitespace. Unlike splitting by a delimiter, leading
+ * and trailing whitespace never produce empty pieces.
+ */
+void
+StringPipeline_split_whitespace(StringPipelineT *self) {
+    _pipeline_set_split(self, SPLIT_WHITESPACE, NULL);
+}
+
+/**
+ * Transform every piece, see :func:`StringArray_transform` for the transformations.
+ * Trimming only narrows the view of the piece and never copies it.
+ */
+void
+StringPipeline_transform(StringPipelineT *self, StringTransformT transform) {
+    _pipeline_add(self, (StageT){.kind = STAGE_TRANSFORM, .transform = transform});
+}
+
+/** Replace every occurrence of ``old`` by ``new`` in every piece. */
+void
+StringPipeline_replace(StringPipelineT *self, const StringT *old, const StringT *new) {
+    StageT stage = {.kind = STAGE_REPLACE, .old = NULL, .new = NULL};
+
+    if (!old->length) {
+        ERR("StringPipeline_replace: the replaced string must not be empty");
+    }
+
+    stage.old = String_copy(old);
+    stage.new = String_copy(new);
+    string_search_pattern_init(&stage.search, stage.old, false);
+    _pipeline_add(self, stage);
+}
+
+/**
+ * Keep the pieces for which the test (see :func:`StringArray_test`) gives ``keep``
+ * and drop the others.
+ */
+void
+StringPipeline_filter(StringPipelineT *self, StringTestT test, bool keep) {
+    _pipeline_add(self, (StageT){.kind = STAGE_FILTER,
+                                 .predicate = string_test_predicate(test),
+                                 .keep = keep});
+}
+
+/** Drop the empty pieces. */
+void
+StringPipeline_drop_empty(StringPipelineT *self) {
+    _pipeline_add(self, (StageT){.kind = STAGE_DROP_EMPTY});
+}
+
+/** Separate the pieces of the output by the delimiter. */
+void
+StringPipeline_join(StringPipelineT *self, const StringT *delimiter) {
+    if (self->join) {
+        String_free(self->join);
+    }
+
+    self->join = String_copy(delimiter);
+}
+
+static char *
+_scratch_reserve(ScratchT *scratch, ssize_t size) {
+    // Always allocate, even empty pieces must point to a buffer.
+    if (!scratch->bytes || size > scratch->allocated) {
+        scratch->allocated = GROW_CAPACITY(size);
+        scratch->bytes = realloc(scratch->bytes, scratch->allocated);
+        if (scratch->bytes == NULL) {
+            ERR("Unable to allocate memory for pipeline scratch buffer");
+        }
+    }
+
+    return scratch->bytes;
+}
+
+static void
+_output_append(StringT *output, const char *string, ssize_t length) {
+    if (output->length + length + 1 > output->allocated) {
+        output->allocated = GROW_CAPACITY(output->length + length + 1);
+        output->string = realloc(output->string, output->allocated);
+        if (output->string == NULL) {
+            ERR("Unable to allocate memory for `char *`");
+        }
+    }
+
+    memcpy(output->string + output->length, string, length);
+    output->length += length;
+}
+
+/** Internal function to write the piece with every ``old`` replaced into ``output``. */
+static ssize_t
+_stage_replace(const StageT *stage, PieceT piece, ScratchT *output) {
+    ssize_t growth = MAX_2(stage->new->length - stage->old->length, 0);
+    ssize_t size = piece.length + piece.length / stage->old->length * growth;
+    char *cursor = _scratch_reserve(output, size);
+    ssize_t start = 0, found;
+
+    while ((found = string_search_next(&stage->search, piece.string, start,
+                                       piece.length)) >= 0) {
+        memcpy(cursor, piece.string + start, found - start);
+        memcpy(cursor + found - start, stage->new->string, stage->new->length);
+        cursor += found - start + stage->new->length;
+        start = found + stage->old->length;
+    }
+    memcpy(cursor, piece.string + start, piece.length - start);
+
+    return cursor + piece.length - start - output->bytes;
+}
+
+/**
+ * Internal function to pass a piece through every stage. Returns ``false`` if a
+ * filter dropped it, otherwise ``piece`` holds the result.
+ */
+static bool
+_pipeline_piece(const StringPipelineT *self, PieceT *piece, ScratchT scratch[2]) {
+    int current = 1;
+
+    for (ssize_t i = 0; i < self->length; ++i) {
+        const StageT *stage = &self->stages[i];
+        ScratchT *next = &scratch[!current];
+        StringT view = {.string = (char *)piece->string, .length = piece->length};
+        const char *start = piece->string, *stop = piece->string + piece->length;
+        CaseModeT mode;
+
+        switch (stage->kind) {
+        case STAGE_FILTER:
+            if (stage->predicate(&view) != stage->keep) return false;
+            continue;
+        case STAGE_DROP_EMPTY:
+            if (!piece->length) return false;
+            continue;
+        case STAGE_REPLACE:
+            piece->length = _stage_replace(stage, *piece, next);
+            piece->string = next->bytes;
+            current = !current;
+            continue;
+        case STAGE_TRANSFORM:
+            break;
+        }
+
+        switch (stage->transform) {
+        case STRING_TRANSFORM_TRIM_WHITESPACE:
+        case STRING_TRANSFORM_TRIM_LEFT:
+        case STRING_TRANSFORM_TRIM_RIGHT:
+            if (stage->transform != STRING_TRANSFORM_TRIM_RIGHT) {
+                while (start < stop && CHAR_IS_WHITESPACE(*start)) start++;
+            }
+            if (stage->transform != STRING_TRANSFORM_TRIM_LEFT) {
+                while (stop > start && CHAR_IS_WHITESPACE(stop[-1])) stop--;
+            }
+            *piece = (PieceT){start, stop - start};
+            continue;
+        case STRING_TRANSFORM_LOWER:
+            mode = CASE_LOWER;
+            break;
+        case STRING_TRANSFORM_UPPER:
+            mode = CASE_UPPER;
+            break;
+        case STRING_TRANSFORM_CASE_FOLD:
+            mode = CASE_FOLD;
+            break;
+        default:
+            ERR("StringPipeline_run: unknown transform %d", stage->transform);
+        }
+
+        _scratch_reserve(next, string_case_map(piece->string, piece->length, mode, NULL));
+        piece->length = string_case_map(piece->string, piece->length, mode, next->bytes);
+        piece->string = next->bytes;
+        current = !current;
+    }
+
+    return true;
+}
+
+/** Internal function to pass a piece of the split through the stages to the output. */
+static void
+_pipeline_emit(const char *string, ssize_t length, void *context) {
+    RunT *run = context;
+    PieceT piece = {string, length};
+
+    if (!_pipeline_piece(run->pipeline, &piece, run->scratch)) {
+        return;
+    }
+    if (!run->first && run->pipeline->join) {
+        _output_append(run->output, run->pipeline->join->string,
+                       run->pipeline->join->length);
+    }
+    _output_append(run->output, piece.string, piece.length);
+    run->first = false;
+}
+
+/**
+ * Run the pipeline over the input and return the joined output. Every piece flows
+ * through all the stages before the next one is cut, in a single pass over the input.
+ *
+ * .. note:: Has time complexity of O(n) for the split, trim, case mapping and filter
+ *           stages. The pipeline isn't modified, so it can be run concurrently.
+ *
+ * .. code-block:: c
+ *
+ *    StringPipelineT *pipeline = StringPipeline_new();
+ *    StringPipeline_split_lines(pipeline);
+ *    StringPipeline_transform(pipeline, STRING_TRANSFORM_TRIM_WHITESPACE);
+ *    StringPipeline_drop_empty(pipeline);
+ *    StringPipeline_transform(pipeline, STRING_TRANSFORM_LOWER);
+ *    StringPipeline_join(pipeline, String_from("|"));
+ *
+ *    StringT *output = StringPipeline_run(pipeline, String_from(" ERROR x\n\n Warn \n"));
+ *    assert(String_eq(output, "error x|warn"));
+ */
+StringT *
+StringPipeline_run(const StringPipelineT *self, const StringT *input) {
+    RunT run = {.pipeline = self,
+                .output = String_new(input->length + 1),
+                .scratch = {{NULL, 0}, {NULL, 0}},
+                .first = true};
+    ssize_t start = 0, found;
+
+    switch (self->split) {
+    case SPLIT_NONE:
+        _pipeline_emit(input->string, input->length, &run);
+        break;
+    case SPLIT_DELIMITER:
+        while ((found = string_search_next(&self->delimiter_search, input->string, start,
+                                           input->length)) >= 0) {
+            _pipeline_emit(input->string + start, found - start, &run);
+            start = found + self->delimiter->length;
+        }
+        _pipeline_emit(input->string + start, input->length - start, &run);
+        break;
+    case SPLIT_WHITESPACE:
+        string_split_whitespace(input->string, input->length, -1, _pipeline_emit, &run);
+        break;
+    }
+
+    run.output->string[run.output->length] = '\0';
+    free(run.scratch[0].bytes);
+    free(run.scratch[1].bytes);
+
+    return run.output;
+}
+
+/** De-allocate the pipeline along with its copies of the stage arguments. */
+void
+StringPipeline_free(StringPipelineT *self) {
+    for (ssize_t i = 0; i < self->length; ++i) {
+        if (self->stages[i].kind == STAGE_REPLACE) {
+            String_free(self->stages[i].old);
+            String_free(self->stages[i].new);
+        }
+    }
+
+    if (self->delimiter) String_free(self->delimiter);
+    if (self->join) String_free(self->join);
+    free(self->stages);
+    free(self);
+}
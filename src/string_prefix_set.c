@@ -0,0 +1,297 @@
+#include "string_prefix_set.h"
+
+#include "string_dbg.h"
+#include "string_internal.h"
+
+#include <stdlib.h> /* malloc, free, qsort */
+#include <string.h> /* memcmp, memcpy */
+
+
+/*
+ * Set of prefixes matched against keys, for routing a key to the longest of many
+ * prefixes without testing them one by one.
+ *
+ * The prefixes form a radix tree: a trie whose chains of single children are merged
+ * into one node labelled with the bytes of the chain. It is built from the sorted
+ * prefixes breadth first, so the children of every node are contiguous in one array
+ * of nodes and ordered by the first byte of their label, which is kept in a parallel
+ * array searched by bisection. Every label is stored in one buffer of bytes.
+ *
+ * A query walks down the tree along the key, comparing one label per node, and
+ * collects the prefixes ending on the way: a single pass over the key whatever the
+ * number of prefixes. The tree is never modified after :func:`StringPrefixSet_new`,
+ * so one set can be queried from any number of threads at once.
+ */
+
+typedef struct {
+    ssize_t label;          // Offset of the label in `labels`.
+    ssize_t label_length;
+    ssize_t id;             // Position of the prefix ending here in the source, or -1.
+    ssize_t children;       // Index of the first child.
+    ssize_t children_length;
+} PrefixNodeT;
+
+struct StringPrefixSetT {
+    PrefixNodeT *nodes;
+    unsigned char *first_bytes; // First byte of the label of every node.
+    char *labels;
+    ssize_t length;
+};
+
+/// Prefix of the source with its position, sorted to build the tree.
+typedef struct {
+    const StringT *string;
+    ssize_t id;
+} PrefixEntryT;
+
+/// Range of the sorted prefixes below a node still to be built, at ``depth`` bytes.
+typedef struct {
+    ssize_t first;
+    ssize_t last;
+    ssize_t depth;
+} PrefixRangeT;
+
+static int
+_prefix_entry_compare(const void *a, const void *b) {
+    const PrefixEntryT *left = a, *right = b;
+    int order = memcmp(left->string->string, right->string->string,
+                       MIN_2(left->string->length, right->string->length));
+
+    if (order != 0) return order;
+    if (left->string->length != right->string->length) {
+        return left->string->length < right->string->length ? -1 : 1;
+    }
+    // Duplicates keep the first position.
+    return (left->id > right->id) - (left->id < right->id);
+}
+
+/** Internal function to get the length of the common prefix of two strings. */
+static inline ssize_t
+_common_prefix(const StringT *a, const StringT *b, ssize_t from) {
+    ssize_t length = MIN_2(a->length, b->length);
+
+    while (from < length && a->string[from] == b->string[from]) from++;
+    return from;
+}
+
+/**
+ * Build the set of the strings of the iterator. The prefixes found by the queries
+ * are identified by their position in the iterator; of equal strings, the first one.
+ * The strings are copied, the iterator can be freed afterwards.
+ *
+ * .. note:: Has time complexity of O(n log n) comparisons for n strings. The position
+ *           of the iterator is neither used nor modified.
+ *
+ * .. code-block:: c
+ *
+ *    StringIteratorT *routes = StringIterator_new();
+ *    StringIterator_append(routes, String_from("/api/"));
+ *    StringIterator_append(routes, String_from("/api/users/"));
+ *
+ *    StringPrefixSetT *set = StringPrefixSet_new(routes);
+ */
+StringPrefixSetT *
+StringPrefixSet_new(const StringIteratorT *prefixes) {
+    StringPrefixSetT *self = malloc(sizeof *self);
+    PrefixEntryT *entries = malloc(MAX_2(prefixes->length, 1) * sizeof *entries);
+    // A radix tree of n strings has at most 2n nodes, with the root.
+    ssize_t capacity = 2 * prefixes->length + 1, nodes_length = 1, labels_length = 0;
+    PrefixRangeT *ranges = malloc(capacity * sizeof *ranges);
+    ssize_t labels_size = 0;
+
+    if (self == NULL || entries == NULL || ranges == NULL) {
+        ERR("Unable to allocate memory for `StringPrefixSetT`");
+    }
+
+    for (ssize_t i = 0; i < prefixes->length; ++i) {
+        entries[i] = (PrefixEntryT){.string = prefixes->strings[i], .id = i};
+        labels_size += prefixes->strings[i]->length;
+    }
+    qsort(entries, prefixes->length, sizeof *entries, _prefix_entry_compare);
+
+    self->nodes = malloc(capacity * sizeof *self->nodes);
+    self->first_bytes = malloc(capacity);
+    self->labels = malloc(MAX_2(labels_size, 1));
+    if (self->nodes == NULL || self->first_bytes == NULL || self->labels == NULL) {
+        ERR("Unable to allocate memory for `StringPrefixSetT` nodes");
+    }
+
+    self->nodes[0] = (PrefixNodeT){.id = -1};
+    self->first_bytes[0] = 0;
+    ranges[0] = (PrefixRangeT){.first = 0, .last = prefixes->length, .depth = 0};
+
+    for (ssize_t n = 0; n < nodes_length; ++n) {
+        PrefixNodeT *node = &self->nodes[n];
+        ssize_t first = ranges[n].first, last = ranges[n].last, depth = ranges[n].depth;
+
+        // The string ending at this node sorts first, its duplicates right after.
+        if (first < last && entries[first].string->length == depth) {
+            node->id = entries[first].id;
+            while (first < last && entries[first].string->length == depth) first++;
+        }
+
+        node->children = nodes_length;
+        while (first < last) {
+            const StringT *string = entries[first].string;
+            unsigned char byte = string->string[depth];
+            ssize_t end = first + 1, child_depth;
+
+            while (end < last &&
+                   (unsigned char)entries[end].string->string[depth] == byte) {
+                end++;
+            }
+            // Sorted, so the first and last strings of the group share the least.
+            child_depth = _common_prefix(string, entries[end - 1].string, depth + 1);
+
+            memcpy(self->labels + labels_length, string->string + depth,
+                   child_depth - depth);
+            self->nodes[nodes_length] = (PrefixNodeT){
+                .label = labels_length, .label_length = child_depth - depth, .id = -1};
+            self->first_bytes[nodes_length] = byte;
+            ranges[nodes_length] =
+                (PrefixRangeT){.first = first, .last = end, .depth = child_depth};
+            labels_length += child_depth - depth;
+            nodes_length++;
+            first = end;
+        }
+        node->children_length = nodes_length - node->children;
+    }
+
+    self->length = prefixes->length;
+    free(entries);
+    free(ranges);
+    return self;
+}
+
+void
+StringPrefixSet_free(StringPrefixSetT *self) {
+    free(self->nodes);
+    free(self->first_bytes);
+    free(self->labels);
+    free(self);
+}
+
+/** Get the number of strings the set was built from, duplicates included. */
+ssize_t
+StringPrefixSet_length(const StringPrefixSetT *self) {
+    return self->length;
+}
+
+/** Internal function to find the child of the node whose label starts with ``byte``. */
+static inline const PrefixNodeT *
+_prefix_child(const StringPrefixSetT *self, const PrefixNodeT *node, unsigned char byte) {
+    ssize_t low = node->children, high = node->children + node->children_length;
+
+    while (low < high) {
+        ssize_t middle = low + (high - low) / 2;
+
+        if (self->first_bytes[middle] < byte) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    if (low < node->children + node->children_length && self->first_bytes[low] == byte) {
+        return &self->nodes[low];
+    }
+    return NULL;
+}
+
+/**
+ * Internal function to move from the node at ``*depth`` bytes of the key to its child
+ * along the key, if the whole label of the child matches. Returns ``NULL`` otherwise.
+ */
+static inline const PrefixNodeT *
+_prefix_step(const StringPrefixSetT *self, const PrefixNodeT *node, const StringT *key,
+             ssize_t *depth) {
+    const PrefixNodeT *child;
+
+    if (*depth == key->length) return NULL;
+
+    child = _prefix_child(self, node, key->string[*depth]);
+    if (child == NULL || child->label_length > key->length - *depth ||
+        memcmp(self->labels + child->label, key->string + *depth, child->label_length)) {
+        return NULL;
+    }
+
+    *depth += child->label_length;
+    return child;
+}
+
+/**
+ * Check if the string is one of the strings of the set, as a whole.
+ *
+ * .. note:: Has time complexity of O(m) for a string of m bytes.
+ */
+bool
+StringPrefixSet_contains(const StringPrefixSetT *self, const StringT *string) {
+    const PrefixNodeT *node = self->nodes, *child;
+    ssize_t depth = 0;
+
+    while ((child = _prefix_step(self, node, string, &depth)) != NULL) node = child;
+    return depth == string->length && node->id >= 0;
+}
+
+/**
+ * Find the longest string of the set which is a prefix of the key. Returns its
+ * position in the iterator the set was built from, with its length in ``length``
+ * unless ``NULL``, or ``-1`` if no string of the set is a prefix of the key.
+ *
+ * .. note:: Has time complexity of O(m) for a key of m bytes.
+ *
+ * .. code-block:: c
+ *
+ *    // With the set of "/api/" and "/api/users/".
+ *    StringT *path = String_from("/api/users/42");
+ *    ssize_t length;
+ *
+ *    assert(StringPrefixSet_longest_match(set, path, &length) == 1 && length == 11);
+ */
+ssize_t
+StringPrefixSet_longest_match(const StringPrefixSetT *self, const StringT *key,
+                              ssize_t *length) {
+    const PrefixNodeT *node = self->nodes;
+    ssize_t depth = 0, id = -1, found = 0;
+
+    do {
+        if (node->id >= 0) {
+            id = node->id;
+            found = depth;
+        }
+    } while ((node = _prefix_step(self, node, key, &depth)) != NULL);
+
+    if (length != NULL) *length = id >= 0 ? found : 0;
+    return id;
+}
+
+/**
+ * Find every string of the set which is a prefix of the key. The first ``capacity``
+ * of their positions in the iterator the set was built from, shortest prefix first,
+ * are stored in ``ids``. Returns the number of prefixes of the key in the set.
+ *
+ * .. note:: Has time complexity of O(m) for a key of m bytes.
+ *
+ * .. code-block:: c
+ *
+ *    // With the set of "/api/" and "/api/users/".
+ *    StringT *path = String_from("/api/users/42");
+ *    ssize_t ids[2];
+ *
+ *    assert(StringPrefixSet_all_matches(set, path, ids, 2) == 2 && ids[0] == 0);
+ */
+ssize_t
+StringPrefixSet_all_matches(const StringPrefixSetT *self, const StringT *key,
+                            ssize_t *ids, ssize_t capacity) {
+    const PrefixNodeT *node = self->nodes;
+    ssize_t depth = 0, count = 0;
+
+    do {
+        if (node->id >= 0) {
+            if (count < capacity) ids[count] = node->id;
+            count++;
+        }
+    } while ((node = _prefix_step(self, node, key, &depth)) != NULL);
+
+    return count;
+}
@@ -0,0 +1,595 @@
+#include "string_rope.h"
+
+#include "string_dbg.h"
+#include "string_internal.h"
+
+#include <stdatomic.h> /* atomic_long */
+#include <stdlib.h>    /* malloc, free */
+#include <string.h>    /* memcpy, memchr */
+
+
+/*
+ * A rope is a concatenation tree: leaves hold up to ``ROPE_LEAF_MAX`` bytes and
+ * internal nodes only know the total length of their children. The tree is kept
+ * AVL balanced, so its height is O(log n).
+ *
+ * Nodes are immutable once built and reference counted, so ropes produced by
+ * :func:`StringRope_slice` or :func:`StringRope_concatenate` share every node they
+ * don't modify and each edit only allocates the O(log n) nodes along its path.
+ * Every edit is expressed with two primitives, ``_rope_split`` and ``_rope_join``.
+ *
+ * Internal functions below consume the references to the nodes passed to them and
+ * return a new reference.
+ */
+
+#define ROPE_LEAF_MAX 1024
+
+struct StringRopeNodeT {
+    atomic_long references;
+    ssize_t length;
+    int height;
+
+    StringRopeNodeT *left;
+    StringRopeNodeT *right;
+    char bytes[]; // Only allocated for leaves.
+};
+
+struct StringRopeT {
+    StringRopeNodeT *root;
+};
+
+#define NODE_IS_LEAF(node) ((node)->height == 0)
+#define NODE_LENGTH(node) ((node) ? (node)->length : 0)
+
+static inline StringRopeNodeT *
+_node_retain(StringRopeNodeT *node) {
+    if (node) {
+        atomic_fetch_add_explicit(&node->references, 1, memory_order_relaxed);
+    }
+    return node;
+}
+
+static void
+_node_release(StringRopeNodeT *node) {
+    if (!node ||
+        atomic_fetch_sub_explicit(&node->references, 1, memory_order_acq_rel) > 1) {
+        return;
+    }
+
+    if (!NODE_IS_LEAF(node)) {
+        _node_release(node->left);
+        _node_release(node->right);
+    }
+    free(node);
+}
+
+static StringRopeNodeT *
+_node_leaf(const char *string, ssize_t length) {
+    StringRopeNodeT *node = malloc(sizeof *node + length);
+
+    if (node == NULL) {
+        ERR("Unable to allocate memory for `StringRopeNodeT`");
+    }
+
+    *node = (StringRopeNodeT){.length = length};
+    atomic_init(&node->references, 1);
+    memcpy(node->bytes, string, length);
+
+    return node;
+}
+
+static StringRopeNodeT *
+_node_concat(StringRopeNodeT *left, StringRopeNodeT *right) {
+    StringRopeNodeT *node = malloc(sizeof *node);
+
+    if (node == NULL) {
+        ERR("Unable to allocate memory for `StringRopeNodeT`");
+    }
+
+    *node = (StringRopeNodeT){.length = left->length + right->length,
+                              .height = MAX_2(left->height, right->height) + 1,
+                              .left = left,
+                              .right = right};
+    atomic_init(&node->references, 1);
+
+    return node;
+}
+
+/** Internal function to take the children of an internal node, releasing the node. */
+static inline void
+_node_split_children(StringRopeNodeT *node, StringRopeNodeT **left,
+                     StringRopeNodeT **right) {
+    *left = _node_retain(node->left);
+    *right = _node_retain(node->right);
+    _node_release(node);
+}
+
+/** Internal function to copy the bytes of a sub-tree to ``buffer``. */
+static void
+_node_copy_bytes(const StringRopeNodeT *node, char *buffer) {
+    while (!NODE_IS_LEAF(node)) {
+        _node_copy_bytes(node->left, buffer);
+        buffer += node->left->length;
+        node = node->right;
+    }
+    memcpy(buffer, node->bytes, node->length);
+}
+
+/** Internal function to build a balanced tree of ``leaves`` leaves from bytes. */
+static StringRopeNodeT *
+_rope_build_leaves(const char *string, ssize_t length, ssize_t leaves) {
+    ssize_t left_leaves = leaves / 2, left_length;
+
+    if (leaves == 1) {
+        return _node_leaf(string, length);
+    }
+
+    left_length = length * left_leaves / leaves;
+    return _node_concat(_rope_build_leaves(string, left_length, left_leaves),
+                        _rope_build_leaves(string + left_length, length - left_length,
+                                           leaves - left_leaves));
+}
+
+static StringRopeNodeT *
+_rope_build(const char *string, ssize_t length) {
+    ssize_t leaves = (length + ROPE_LEAF_MAX - 1) / ROPE_LEAF_MAX;
+
+    return length > 0 ? _rope_build_leaves(string, length, leaves) : NULL;
+}
+
+/**
+ * Internal function to make a node of two trees whose heights differ by at most 2,
+ * rotating once or twice to restore the AVL balance.
+ */
+static StringRopeNodeT *
+_rope_balance(StringRopeNodeT *left, StringRopeNodeT *right) {
+    StringRopeNodeT *a, *b, *c, *d;
+
+    if (right->height > left->height + 1) {
+        _node_split_children(right, &a, &b);
+        if (a->height <= b->height) {
+            return _node_concat(_node_concat(left, a), b);
+        }
+        _node_split_children(a, &c, &d);
+        return _node_concat(_node_concat(left, c), _node_concat(d, b));
+    }
+
+    if (left->height > right->height + 1) {
+        _node_split_children(left, &a, &b);
+        if (b->height <= a->height) {
+            return _node_concat(a, _node_concat(b, right));
+        }
+        _node_split_children(b, &c, &d);
+        return _node_concat(_node_concat(a, c), _node_concat(d, right));
+    }
+
+    return _node_concat(left, right);
+}
+
+/**
+ * Internal function to concatenate two trees in O(|height(left) - height(right)|).
+ * Small results are merged into a single leaf, so that many small edits don't leave
+ * the rope with tiny leaves.
+ */
+static StringRopeNodeT *
+_rope_join(StringRopeNodeT *left, StringRopeNodeT *right) {
+    StringRopeNodeT *a, *b, *merged;
+
+    if (!left) return right;
+    if (!right) return left;
+
+    if (left->length + right->length <= ROPE_LEAF_MAX) {
+        merged = malloc(sizeof *merged + left->length + right->length);
+        if (merged == NULL) {
+            ERR("Unable to allocate memory for `StringRopeNodeT`");
+        }
+
+        *merged = (StringRopeNodeT){.length = left->length + right->length};
+        atomic_init(&merged->references, 1);
+        _node_copy_bytes(left, merged->bytes);
+        _node_copy_bytes(right, merged->bytes + left->length);
+        _node_release(left);
+        _node_release(right);
+
+        return merged;
+    }
+
+    if (left->height > right->height + 1) {
+        _node_split_children(left, &a, &b);
+        return _rope_balance(a, _rope_join(b, right));
+    }
+    if (right->height > left->height + 1) {
+        _node_split_children(right, &a, &b);
+        return _rope_balance(_rope_join(left, a), b);
+    }
+
+    return _node_concat(left, right);
+}
+
+/** Internal function to split a tree into the bytes before and after ``index``. */
+static void
+_rope_split(StringRopeNodeT *node, ssize_t index, StringRopeNodeT **left,
+            StringRopeNodeT **right) {
+    StringRopeNodeT *a, *b, *part;
+
+    if (!node || index <= 0 || index >= node->length) {
+        *left = (node && index > 0) ? node : NULL;
+        *right = (node && index <= 0) ? node : NULL;
+        return;
+    }
+
+    if (NODE_IS_LEAF(node)) {
+        *left = _node_leaf(node->bytes, index);
+        *right = _node_leaf(node->bytes + index, node->length - index);
+        _node_release(node);
+        return;
+    }
+
+    _node_split_children(node, &a, &b);
+    if (index < a->length) {
+        _rope_split(a, index, left, &part);
+        *right = _rope_join(part, b);
+    } else {
+        _rope_split(b, index - a->length, &part, right);
+        *left = _rope_join(a, part);
+    }
+}
+
+/* ------------------------------ StringRopeT ------------------------------ */
+
+static StringRopeT *
+_rope_new(StringRopeNodeT *root) {
+    StringRopeT *self = malloc(sizeof *self);
+
+    if (self == NULL) {
+        ERR("Unable to allocate memory for `StringRopeT`");
+    }
+
+    self->root = root;
+    return self;
+}
+
+/** Create and return a new, empty ``StringRopeT`` object. */
+StringRopeT *
+StringRope_new(void) {
+    return _rope_new(NULL);
+}
+
+/**
+ * Create and return a new ``StringRopeT`` object holding a copy of ``length`` bytes of
+ * ``string``.
+ */
+StringRopeT *
+StringRope_from_char_array(const char *string, ssize_t length) {
+    return _rope_new(_rope_build(string, length));
+}
+
+/**
+ * Create and return a new ``StringRopeT`` object holding a copy of the string.
+ * Unlike ``StringT``, a rope edits large texts in O(log n): inserting, deleting,
+ * slicing or concatenating never copies the whole text.
+ *
+ * .. code-block:: c
+ *
+ *    StringT *string = String_from("Hello World");
+ *    StringT *comma = String_from(",");
+ *    StringRopeT *rope = StringRope_from(string);
+ *
+ *    StringRope_insert(rope, 5, comma);
+ *    StringRope_delete(rope, 0, 7);
+ *    assert(String_eq(StringRope_flatten(rope), "World"));
+ */
+StringRopeT *
+StringRope_from(const StringT *string) {
+    return StringRope_from_char_array(string->string, string->length);
+}
+
+/** Get the number of bytes in the rope. */
+ssize_t
+StringRope_len(const StringRopeT *self) {
+    return NODE_LENGTH(self->root);
+}
+
+/**
+ * Get the byte at the given index in O(log n). Negative indices are supported.
+ *
+ * .. note:: If index is out of range, this function will throw an error and exit.
+ */
+char
+StringRope_index(const StringRopeT *self, ssize_t index) {
+    const StringRopeNodeT *node = self->root;
+
+    if (index < 0) {
+        index += NODE_LENGTH(node);
+    }
+    if (index < 0 || index >= NODE_LENGTH(node)) {
+        ERR("Index out of range");
+    }
+
+    while (!NODE_IS_LEAF(node)) {
+        if (index < node->left->length) {
+            node = node->left;
+        } else {
+            index -= node->left->length;
+            node = node->right;
+        }
+    }
+
+    return node->bytes[index];
+}
+
+/** Internal function to check that ``[start, stop)`` is a range of the rope. */
+static inline void
+_rope_check_range(const StringRopeT *self, ssize_t start, ssize_t stop,
+                  const char *function) {
+    if (start < 0 || start > stop || stop > NODE_LENGTH(self->root)) {
+        ERR("%s: range out of bounds", function);
+    }
+}
+
+/**
+ * Replace the bytes in ``[start, stop)`` with ``length`` bytes of ``string``, in
+ * O(log n + length).
+ */
+static void
+_rope_replace(StringRopeT *self, ssize_t start, ssize_t stop, const char *string,
+              ssize_t length) {
+    StringRopeNodeT *before, *middle, *after;
+
+    _rope_split(self->root, stop, &middle, &after);
+    _rope_split(middle, start, &before, &middle);
+    _node_release(middle);
+
+    self->root = _rope_join(_rope_join(before, _rope_build(string, length)), after);
+}
+
+/**
+ * Insert ``length`` bytes of ``string`` before ``index``. See :func:`StringRope_insert`
+ * for more info.
+ */
+void
+StringRope_insert_char_array(StringRopeT *self, ssize_t index, const char *string,
+                             ssize_t length) {
+    _rope_check_range(self, index, index, __func__);
+    _rope_replace(self, index, index, string, length);
+}
+
+/**
+ * Insert a copy of the string before ``index`` in O(log n + m), where m is the length
+ * of the inserted string.
+ *
+ * .. note:: If index is out of range, this function will throw an error and exit.
+ */
+void
+StringRope_insert(StringRopeT *self, ssize_t index, const StringT *string) {
+    StringRope_insert_char_array(self, index, string->string, string->length);
+}
+
+/** Append a copy of the string to the end of the rope. */
+void
+StringRope_append(StringRopeT *self, const StringT *string) {
+    StringRope_insert(self, StringRope_len(self), string);
+}
+
+/**
+ * Delete the bytes in ``[start, stop)`` in O(log n).
+ *
+ * .. note:: If the range is out of bounds, this function will throw an error and exit.
+ */
+void
+StringRope_delete(StringRopeT *self, ssize_t start, ssize_t stop) {
+    _rope_check_range(self, start, stop, __func__);
+    _rope_replace(self, start, stop, NULL, 0);
+}
+
+/**
+ * Replace the bytes in ``[start, stop)`` with a copy of ``replacement`` in
+ * O(log n + m), where m is the length of the replacement.
+ *
+ * .. note:: If the range is out of bounds, this function will throw an error and exit.
+ */
+void
+StringRope_replace_range(StringRopeT *self, ssize_t start, ssize_t stop,
+                         const StringT *replacement) {
+    _rope_check_range(self, start, stop, __func__);
+    _rope_replace(self, start, stop, replacement->string, replacement->length);
+}
+
+/**
+ * Create and return a new rope holding the bytes in ``[start, stop)``, in O(log n).
+ * The new rope shares the unmodified parts of ``self``.
+ *
+ * .. note:: If the range is out of bounds, this function will throw an error and exit.
+ */
+StringRopeT *
+StringRope_slice(const StringRopeT *self, ssize_t start, ssize_t stop) {
+    StringRopeNodeT *before, *middle, *after;
+
+    _rope_check_range(self, start, stop, __func__);
+    _rope_split(_node_retain(self->root), stop, &middle, &after);
+    _rope_split(middle, start, &before, &middle);
+    _node_release(before);
+    _node_release(after);
+
+    return _rope_new(middle);
+}
+
+/**
+ * Concatenate two ropes and return the result as a new rope, in O(log n).
+ * Both ropes are left unchanged and share their nodes with the result.
+ */
+StringRopeT *
+StringRope_concatenate(const StringRopeT *self, const StringRopeT *other) {
+    return _rope_new(_rope_join(_node_retain(self->root), _node_retain(other->root)));
+}
+
+/** Append the bytes of ``other`` to ``self`` in O(log n). ``other`` is unchanged. */
+void
+StringRope_concatenate_inplace(StringRopeT *self, const StringRopeT *other) {
+    self->root = _rope_join(self->root, _node_retain(other->root));
+}
+
+/**
+ * Start iterating over the chunks of the rope from the byte ``start``, use
+ * :func:`StringRope_next_chunk` to get the chunks.
+ */
+void
+StringRope_iterator(const StringRopeT *self, ssize_t start,
+                    StringRopeIteratorT *iterator) {
+    const StringRopeNodeT *node = self->root;
+
+    iterator->depth = 0;
+    iterator->offset = 0;
+    if (start < 0 || start >= NODE_LENGTH(node)) {
+        return;
+    }
+
+    while (!NODE_IS_LEAF(node)) {
+        if (start < node->left->length) {
+            iterator->stack[iterator->depth++] = node->right;
+            node = node->left;
+        } else {
+            start -= node->left->length;
+            node = node->right;
+        }
+    }
+    iterator->stack[iterator->depth++] = node;
+    iterator->offset = start;
+}
+
+/**
+ * Get the next chunk of the rope as a view into the rope in ``chunk``, returns
+ * ``false`` once every chunk was returned.
+ *
+ * .. note:: ``chunk`` must not be freed or modified, it stays valid while the rope
+ *           (or a rope sharing the chunk) isn't freed.
+ *
+ * .. code-block:: c
+ *
+ *    StringRopeIteratorT iterator;
+ *    StringT chunk;
+ *
+ *    StringRope_iterator(rope, 0, &iterator);
+ *    while (StringRope_next_chunk(&iterator, &chunk)) {
+ *        fwrite(chunk.string, 1, chunk.length, stdout);
+ *    }
+ */
+bool
+StringRope_next_chunk(StringRopeIteratorT *iterator, StringT *chunk) {
+    const StringRopeNodeT *node;
+
+    if (iterator->depth == 0) {
+        return false;
+    }
+
+    node = iterator->stack[--iterator->depth];
+    while (!NODE_IS_LEAF(node)) {
+        iterator->stack[iterator->depth++] = node->right;
+        node = node->left;
+    }
+
+    *chunk = (StringT){.string = (char *)node->bytes + iterator->offset,
+                       .length = node->length - iterator->offset};
+    iterator->offset = 0;
+
+    return true;
+}
+
+/**
+ * Find the first occurrence of ``sub_string`` starting at byte ``start`` or later.
+ * Returns ``StringIndex(0, 0, 1)`` when there is none (or ``sub_string`` is empty),
+ * like :func:`String_contains`.
+ *
+ * .. note:: Implementation is based on the `Knuth Morris Pratt algorithm`_, which
+ *           reads every byte once, so matches spanning several chunks are found
+ *           without flattening the rope. Time complexity is O(n + m).
+ * .. _Knuth Morris Pratt algorithm::
+ * https://en.wikipedia.org/wiki/Knuth–Morris–Pratt_algorithm
+ */
+StringIndexT
+StringRope_contains_from(const StringRopeT *self, const StringT *sub_string,
+                         ssize_t start) {
+    StringIndexT result = StringIndex(0, 0, 1);
+    const char *pattern = sub_string->string;
+    ssize_t length = sub_string->length, matched = 0, position = MAX_2(start, 0);
+    StringRopeIteratorT iterator;
+    ssize_t *failure;
+    StringT chunk;
+
+    if (length == 0 || length > StringRope_len(self) - position) {
+        return result;
+    }
+
+    failure = malloc(length * sizeof *failure);
+    if (failure == NULL) {
+        ERR("Unable to allocate memory for `ssize_t *`");
+    }
+
+    // failure[i] is the length of the longest proper border of pattern[0..i].
+    failure[0] = 0;
+    for (ssize_t i = 1, k = 0; i < length; ++i) {
+        while (k > 0 && pattern[i] != pattern[k]) k = failure[k - 1];
+        if (pattern[i] == pattern[k]) k++;
+        failure[i] = k;
+    }
+
+    StringRope_iterator(self, position, &iterator);
+    while (StringRope_next_chunk(&iterator, &chunk)) {
+        const char *bytes = chunk.string, *end = chunk.string + chunk.length;
+
+        while (bytes < end) {
+            if (matched == 0) {
+                // Nothing matched yet, skip to the next candidate first byte.
+                const char *next = memchr(bytes, pattern[0], end - bytes);
+
+                if (!next) break;
+                bytes = next;
+            }
+
+            while (matched > 0 && *bytes != pattern[matched]) {
+                matched = failure[matched - 1];
+            }
+            if (*bytes == pattern[matched]) matched++;
+            bytes++;
+
+            if (matched == length) {
+                position += bytes - chunk.string;
+                result = StringIndex(position - length, position);
+                free(failure);
+                return result;
+            }
+        }
+        position += chunk.length;
+    }
+
+    free(failure);
+    return result;
+}
+
+/** Find the first occurrence of ``sub_string``, see :func:`StringRope_contains_from`. */
+StringIndexT
+StringRope_contains(const StringRopeT *self, const StringT *sub_string) {
+    return StringRope_contains_from(self, sub_string, 0);
+}
+
+/** Copy the rope into a new NULL terminated ``StringT`` in O(n). */
+StringT *
+StringRope_flatten(const StringRopeT *self) {
+    ssize_t length = StringRope_len(self);
+    StringT *string = String_new(length + 1);
+
+    if (self->root) {
+        _node_copy_bytes(self->root, string->string);
+    }
+    string->string[length] = '\0';
+    string->length = length;
+
+    return string;
+}
+
+/** De-allocate the rope, nodes shared with other ropes are kept alive. */
+void
+StringRope_free(StringRopeT *self) {
+    _node_release(self->root);
+    free(self);
+}
@@ -0,0 +1,52 @@
+#ifndef STRING_SIMD_H
+#define STRING_SIMD_H
+
+/*
+ * Selection of the vectorised kernels, not installed.
+ *
+ * On x86-64 with GCC or Clang, ``STRING_SIMD_X86`` is defined. SSE2 is part of the
+ * x86-64 baseline and can be used directly. Wider instruction sets are compiled per
+ * function with ``STRING_TARGET`` and chosen at run time with ``STRING_CPU_HAS``, so
+ * the library runs on any x86-64 CPU without special build flags.
+ *
+ * Define ``STRING_NO_SIMD`` to build the portable scalar code only.
+ */
+
+#if !defined(STRING_NO_SIMD) && defined(__x86_64__) && \
+    (defined(__GNUC__) || defined(__clang__))
+#define STRING_SIMD_X86 1
+
+#include <immintrin.h>
+
+#define STRING_TARGET(features) __attribute__((target(features)))
+#define STRING_CPU_HAS(feature) __builtin_cpu_supports(feature)
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define CTZ_64(x) __builtin_ctzll(x)
+#define CLZ_64(x) __builtin_clzll(x)
+#define POPCOUNT_64(x) __builtin_popcountll(x)
+#else
+static inline int
+CTZ_64(unsigned long long x) {
+    int n = 0;
+    while (!(x & 1)) x >>= 1, n++;
+    return n;
+}
+
+static inline int
+CLZ_64(unsigned long long x) {
+    int n = 0;
+    while (!(x & (1ull << 63))) x <<= 1, n++;
+    return n;
+}
+
+static inline int
+POPCOUNT_64(unsigned long long x) {
+    int n = 0;
+    for (; x; x &= x - 1) n++;
+    return n;
+}
+#endif
+
+#endif /* STRING_SIMD_H */
@@ -0,0 +1,307 @@
+#include "string_ext.h"
+
+#include "string_dbg.h"
+#include "string_internal.h"
+
+#include <stdlib.h> /* malloc, realloc, free */
+#include <string.h> /* memcmp, memcpy */
+
+
+/// Buckets of a radix pass: one for strings that ended plus one per byte value.
+#define SORT_BUCKETS 257
+/// Ranges smaller than this are finished with insertion sort.
+#define SORT_INSERTION_THRESHOLD 24
+
+
+typedef const StringT *StringRefT;
+
+typedef struct {
+    ssize_t start;
+    ssize_t length;
+    ssize_t depth;
+} SortRangeT;
+
+typedef struct {
+    SortRangeT *ranges;
+    ssize_t length;
+    ssize_t allocated;
+} SortStackT;
+
+typedef struct {
+    StringRefT *strings;
+    StringRefT *auxiliary;
+    ssize_t *bucket_starts;
+    int flags;
+} SortJobT;
+
+/**
+ * Internal function to get the key of a string at the given depth, ``-1`` once the
+ * string is exhausted so that shorter strings sort first.
+ */
+static inline int
+_key_at(StringRefT string, ssize_t depth, bool fold) {
+    int ch;
+
+    if (depth >= string->length) return -1;
+
+    ch = (unsigned char)string->string[depth];
+    return fold ? CHAR_FOLD_CASE(ch) : ch;
+}
+
+/** Internal function to compare two strings, skipping the first ``depth`` bytes. */
+static int
+_compare_from(StringRefT self, StringRefT other, ssize_t depth, bool fold) {
+    ssize_t length = MIN_2(self->length, other->length);
+    int difference;
+
+    if (!fold) {
+        difference = memcmp(self->string + depth, other->string + depth,
+                            MAX_2(length - depth, 0));
+        if (difference) return difference;
+    } else {
+        for (ssize_t i = depth; i < length; ++i) {
+            difference = _key_at(self, i, true) - _key_at(other, i, true);
+            if (difference) return difference;
+        }
+    }
+
+    return (self->length > other->length) - (self->length < other->length);
+}
+
+/** Internal stable insertion sort used to finish small ranges. */
+static void
+_insertion_sort(StringRefT *strings, ssize_t length, ssize_t depth, bool fold) {
+    for (ssize_t i = 1; i < length; ++i) {
+        StringRefT current = strings[i];
+        ssize_t j = i;
+
+        for (; j > 0 && _compare_from(strings[j - 1], current, depth, fold) > 0; --j) {
+            strings[j] = strings[j - 1];
+        }
+        strings[j] = current;
+    }
+}
+
+static void
+_stack_push(SortStackT *self, ssize_t start, ssize_t length, ssize_t depth) {
+    if (length < 2) return;
+
+    if (self->length >= self->allocated) {
+        self->allocated = GROW_CAPACITY(self->allocated + 1);
+        self->ranges = realloc(self->ranges, self->allocated * sizeof *self->ranges);
+        if (self->ranges == NULL) {
+            ERR("Unable to reallocate memory for the sort stack");
+        }
+    }
+
+    self->ranges[self->length++] =
+        (SortRangeT){.start = start, .length = length, .depth = depth};
+}
+
+static inline void
+_swap(StringRefT *strings, ssize_t i, ssize_t j) {
+    StringRefT temporary = strings[i];
+    strings[i] = strings[j];
+    strings[j] = temporary;
+}
+
+/** Internal function to pick the median key of the first, middle and last string. */
+static int
+_median_key(StringRefT *strings, ssize_t length, ssize_t depth, bool fold) {
+    int a = _key_at(strings[0], depth, fold);
+    int b = _key_at(strings[length / 2], depth, fold);
+    int c = _key_at(strings[length - 1], depth, fold);
+
+    if (a < b) return b < c ? b : (a < c ? c : a);
+    return a < c ? a : (b < c ? c : b);
+}
+
+/**
+ * Internal implementation of multikey quicksort (Bentley & Sedgewick).
+ * Each pass does a three way partition on the byte at ``depth`` and only the equal
+ * partition advances to the next byte, so common prefixes are scanned once.
+ *
+ * .. note:: Uses an explicit stack so long common prefixes can't overflow the call
+ *           stack.
+ */
+static void
+_multikey_quicksort(StringRefT *strings, ssize_t length, ssize_t depth, bool fold) {
+    SortStackT stack = {0};
+
+    _stack_push(&stack, 0, length, depth);
+
+    while (stack.length) {
+        SortRangeT range = stack.ranges[--stack.length];
+        StringRefT *base = strings + range.start;
+        ssize_t n = range.length, d = range.depth;
+        ssize_t lt, gt, i;
+        int pivot;
+
+        if (n < SORT_INSERTION_THRESHOLD) {
+            _insertion_sort(base, n, d, fold);
+            continue;
+        }
+
+        pivot = _median_key(base, n, d, fold);
+        for (lt = 0, i = 0, gt = n - 1; i <= gt;) {
+            int key = _key_at(base[i], d, fold);
+
+            if (key < pivot) {
+                _swap(base, lt++, i++);
+            } else if (key > pivot) {
+                _swap(base, i, gt--);
+            } else {
+                i++;
+            }
+        }
+
+        _stack_push(&stack, range.start, lt, d);
+        _stack_push(&stack, range.start + gt + 1, n - gt - 1, d);
+        if (pivot != -1) {
+            _stack_push(&stack, range.start + lt, gt + 1 - lt, d + 1);
+        }
+    }
+
+    free(stack.ranges);
+}
+
+/**
+ * Internal function to distribute a range into buckets by the byte at ``depth``
+ * (counting sort). The distribution is stable and ``bucket_starts`` receives the start
+ * of every bucket, with one extra entry for the end of the range.
+ */
+static void
+_distribute(StringRefT *strings, StringRefT *auxiliary, ssize_t length, ssize_t depth,
+            bool fold, ssize_t *bucket_starts) {
+    ssize_t counts[SORT_BUCKETS + 1] = {0};
+
+    for (ssize_t i = 0; i < length; ++i) {
+        counts[_key_at(strings[i], depth, fold) + 2]++;
+    }
+    for (int b = 1; b <= SORT_BUCKETS; ++b) {
+        counts[b] += counts[b - 1];
+    }
+    memcpy(bucket_starts, counts, (SORT_BUCKETS + 1) * sizeof *counts);
+
+    for (ssize_t i = 0; i < length; ++i) {
+        auxiliary[counts[_key_at(strings[i], depth, fold) + 1]++] = strings[i];
+    }
+    memcpy(strings, auxiliary, length * sizeof *strings);
+}
+
+/**
+ * Internal implementation of a stable most significant digit radix sort.
+ * ``auxiliary`` must have room for ``length`` strings.
+ */
+static void
+_msd_radix_sort(StringRefT *strings, StringRefT *auxiliary, ssize_t length,
+                ssize_t depth, bool fold) {
+    ssize_t bucket_starts[SORT_BUCKETS + 1];
+    SortStackT stack = {0};
+
+    _stack_push(&stack, 0, length, depth);
+
+    while (stack.length) {
+        SortRangeT range = stack.ranges[--stack.length];
+
+        if (range.length < SORT_INSERTION_THRESHOLD) {
+            _insertion_sort(strings + range.start, range.length, range.depth, fold);
+            continue;
+        }
+
+        _distribute(strings + range.start, auxiliary + range.start, range.length,
+                    range.depth, fold, bucket_starts);
+
+        // Bucket 0 holds the strings which ended at this depth, they are all equal.
+        for (int b = 1; b < SORT_BUCKETS; ++b) {
+            _stack_push(&stack, range.start + bucket_starts[b],
+                        bucket_starts[b + 1] - bucket_starts[b], range.depth + 1);
+        }
+    }
+
+    free(stack.ranges);
+}
+
+/** Internal function to sort a range with the algorithm selected by ``flags``. */
+static void
+_sort_range(StringRefT *strings, StringRefT *auxiliary, ssize_t length, ssize_t depth,
+            int flags) {
+    bool fold = flags & STRING_SORT_IGNORE_CASE;
+
+    if (flags & STRING_SORT_STABLE) {
+        _msd_radix_sort(strings, auxiliary, length, depth, fold);
+    } else {
+        _multikey_quicksort(strings, length, depth, fold);
+    }
+}
+
+/** Internal worker of the parallel mode, sorts the first level buckets it is handed. */
+static void
+_sort_buckets(ssize_t begin, ssize_t end, void *context) {
+    SortJobT *job = context;
+
+    // Bucket 0 only holds empty strings, which are already in place.
+    for (ssize_t b = begin + 1; b <= end; ++b) {
+        ssize_t start = job->bucket_starts[b];
+
+        _sort_range(job->strings + start, job->auxiliary + start,
+                    job->bucket_starts[b + 1] - start, 1, job->flags);
+    }
+}
+
+/**
+ * Sort the strings of the iterator in place, in ascending byte order with shorter
+ * strings first on ties (same order as :func:`String_compare`).
+ *
+ * ``flags`` is a combination of ``StringSortFlagsT`` values:
+ *
+ * * ``STRING_SORT_STABLE`` keeps equal strings in their original order and uses MSD
+ *   radix sort instead of multikey quicksort.
+ * * ``STRING_SORT_IGNORE_CASE`` compares ASCII letters case-insensitively.
+ * * ``STRING_SORT_PARALLEL`` distributes the strings by their first byte and sorts
+ *   the buckets on all online CPUs.
+ *
+ * .. note:: The position of the iterator is reset to the first string.
+ *
+ * .. code-block:: c
+ *
+ *    StringIteratorT *iterator = String_split(String_from("b,C,a"), String_from(","));
+ *    StringIterator_sort(iterator, STRING_SORT_IGNORE_CASE);
+ *
+ *    assert(String_eq(StringIterator_next(iterator), "a"));
+ *    assert(String_eq(StringIterator_next(iterator), "b"));
+ *    assert(String_eq(StringIterator_next(iterator), "C"));
+ */
+void
+StringIterator_sort(StringIteratorT *self, int flags) {
+    StringRefT *auxiliary = NULL;
+    ssize_t bucket_starts[SORT_BUCKETS + 1];
+    SortJobT job;
+
+    self->index = 0;
+    if (self->length < 2) return;
+
+    if (flags & (STRING_SORT_STABLE | STRING_SORT_PARALLEL)) {
+        auxiliary = malloc(self->length * sizeof *auxiliary);
+        if (auxiliary == NULL) {
+            ERR("Unable to allocate memory for sorting");
+        }
+    }
+
+    if (!(flags & STRING_SORT_PARALLEL) || self->length < SORT_INSERTION_THRESHOLD) {
+        _sort_range(self->strings, auxiliary, self->length, 0, flags);
+        free(auxiliary);
+        return;
+    }
+
+    _distribute(self->strings, auxiliary, self->length, 0,
+                flags & STRING_SORT_IGNORE_CASE, bucket_starts);
+
+    job = (SortJobT){.strings = self->strings,
+                     .auxiliary = auxiliary,
+                     .bucket_starts = bucket_starts,
+                     .flags = flags};
+    string_parallel_for(SORT_BUCKETS - 1, 0, 1, _sort_buckets, &job);
+
+    free(auxiliary);
+}
@@ -5,7 +5,7 @@
 int
 string_t_equals(StringT *str1, StringT *str2) {
     if (str1->length != str2->length) return 0;
-    for (int i = 0; i < str1->length; i++)
+    for (ssize_t i = 0; i < str1->length; i++)
         if (str1->string[i] != str2->string[i]) return 0;
 
     return 1;
@@ -0,0 +1,312 @@
+#include "string_translate.h"
+
+#include "string_dbg.h"
+#include "string_internal.h"
+#include "string_simd.h"
+
+#include <stdint.h> /* uint8_t, uint16_t, uint32_t */
+#include <stdlib.h> /* malloc, free */
+
+
+/*
+ * Byte translation: every byte is replaced through a 256 entry map, or deleted.
+ *
+ * The map is compiled once into ``StringTranslateT`` and reused by every call. Besides
+ * the scalar map, it holds the map split into 16 rows by high nibble, so that a row is
+ * a ``pshufb`` lookup by low nibble, and the set of deleted bytes as two 16 byte
+ * tables of bits by low nibble, the bit of the high nibble picked by a third lookup.
+ * With AVX2, 32 bytes are translated at a time: only the rows which differ from the
+ * identity are looked up and blended in, so narrow maps (``/`` to ``_``, the ASCII
+ * letters) cost one or two shuffles per block. Blocks without deletions are stored
+ * whole; the others are compacted with a branchless loop over the mask of kept bytes.
+ *
+ * With deletions the result is measured first, by counting the deleted bytes with the
+ * same lookups, so the output is always allocated once at its exact size.
+ */
+
+struct StringTranslateT {
+    uint8_t map[256];
+    bool deleted[256];
+    bool has_deletions;
+
+    /* Vectorised lookups, see above. Bit ``h`` of ``rows_mask`` marks row ``h`` as
+     * differing from the identity. */
+    uint8_t rows[16][16];
+    uint16_t rows_mask;
+    uint8_t deleted_low[16];  /* Bit ``h`` set if ``h << 4 | index`` is deleted. */
+    uint8_t deleted_high[16]; /* The same for the high nibbles 8 to 15. */
+    bool avx2;
+};
+
+/**
+ * Compile a translation table from a map of the 256 byte values and a set of bytes
+ * to delete, both arrays of 256 entries indexed by ``unsigned char``. A ``NULL`` map
+ * keeps every byte as it is and a ``NULL`` set deletes none.
+ *
+ * .. code-block:: c
+ *
+ *    unsigned char map[256];
+ *    bool deleted[256] = {0};
+ *
+ *    for (int ch = 0; ch < 256; ++ch) map[ch] = ch == '/' ? '_' : ch;
+ *    for (int ch = 0; ch < 0x20; ++ch) deleted[ch] = true;
+ *    StringTranslateT *table = StringTranslate_new(map, deleted);
+ */
+StringTranslateT *
+StringTranslate_new(const unsigned char *map, const bool *deleted) {
+    StringTranslateT *self = malloc(sizeof *self);
+
+    if (self == NULL) {
+        ERR("Unable to allocate memory for `StringTranslateT`");
+    }
+
+    self->has_deletions = false;
+    self->rows_mask = 0;
+    for (int index = 0; index < 16; ++index) {
+        self->deleted_low[index] = self->deleted_high[index] = 0;
+    }
+
+    for (int ch = 0; ch < 256; ++ch) {
+        self->map[ch] = map ? map[ch] : (uint8_t)ch;
+        self->deleted[ch] = deleted && deleted[ch];
+        self->rows[ch >> 4][ch & 0xF] = self->map[ch];
+
+        if (self->map[ch] != ch) {
+            self->rows_mask |= 1 << (ch >> 4);
+        }
+        if (self->deleted[ch]) {
+            self->has_deletions = true;
+            if (ch < 0x80) {
+                self->deleted_low[ch & 0xF] |= 1 << (ch >> 4);
+            } else {
+                self->deleted_high[ch & 0xF] |= 1 << ((ch >> 4) - 8);
+            }
+        }
+    }
+
+#ifdef STRING_SIMD_X86
+    self->avx2 = STRING_CPU_HAS("avx2");
+#else
+    self->avx2 = false;
+#endif
+
+    return self;
+}
+
+/**
+ * Compile a translation table the way Python's ``str.maketrans`` does: the i-th byte
+ * of ``from`` becomes the i-th byte of ``to``, and the bytes of ``deleted`` are
+ * removed. Any of them may be ``NULL``, ``from`` and ``to`` must have the same length.
+ * Deletion wins over a mapping of the same byte.
+ *
+ * .. code-block:: c
+ *
+ *    StringT *from = String_from("/\\"), *to = String_from("__");
+ *    StringT *deleted = String_from("\r\n\t");
+ *    StringTranslateT *table = StringTranslate_from(from, to, deleted);
+ */
+StringTranslateT *
+StringTranslate_from(const StringT *from, const StringT *to, const StringT *deleted) {
+    unsigned char map[256];
+    bool deleted_set[256] = {0};
+
+    if ((from ? from->length : 0) != (to ? to->length : 0)) {
+        ERR("StringTranslate_from: `from` and `to` must have the same length");
+    }
+
+    for (int ch = 0; ch < 256; ++ch) {
+        map[ch] = (unsigned char)ch;
+    }
+    for (ssize_t i = 0; from && i < from->length; ++i) {
+        map[(unsigned char)from->string[i]] = (unsigned char)to->string[i];
+    }
+    for (ssize_t i = 0; deleted && i < deleted->length; ++i) {
+        deleted_set[(unsigned char)deleted->string[i]] = true;
+    }
+
+    return StringTranslate_new(map, deleted_set);
+}
+
+void
+StringTranslate_free(StringTranslateT *self) {
+    free(self);
+}
+
+#ifdef STRING_SIMD_X86
+/** Internal function to translate 32 bytes with the rows of ``rows_mask``. */
+STRING_TARGET("avx2")
+static inline __m256i
+_translate_block_avx2(const StringTranslateT *self, __m256i bytes, __m256i low,
+                      __m256i high) {
+    for (uint32_t rows = self->rows_mask; rows; rows &= rows - 1) {
+        int row = CTZ_64(rows);
+        __m256i table = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128((const __m128i *)self->rows[row]));
+        __m256i in_row = _mm256_cmpeq_epi8(high, _mm256_set1_epi8((char)row));
+
+        bytes = _mm256_blendv_epi8(bytes, _mm256_shuffle_epi8(table, low), in_row);
+    }
+
+    return bytes;
+}
+
+/** Internal function to get the mask of the deleted bytes among 32. */
+STRING_TARGET("avx2")
+static inline uint32_t
+_translate_deleted_avx2(const StringTranslateT *self, __m256i bytes, __m256i low,
+                        __m256i high) {
+    const __m256i bits =
+        _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128, 1, 2,
+                         4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    __m256i deleted_low = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128((const __m128i *)self->deleted_low));
+    __m256i deleted_high = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128((const __m128i *)self->deleted_high));
+    // Bits of the column of each byte, from the table of its half of the byte values.
+    __m256i column = _mm256_blendv_epi8(_mm256_shuffle_epi8(deleted_low, low),
+                                        _mm256_shuffle_epi8(deleted_high, low), bytes);
+    __m256i bit = _mm256_shuffle_epi8(bits, high);
+
+    return (uint32_t)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(_mm256_and_si256(column, bit), bit));
+}
+
+/** Internal function to count the deleted bytes of blocks of 32, returns the end. */
+STRING_TARGET("avx2")
+static ssize_t
+_translate_count_avx2(const StringTranslateT *self, const char *string, ssize_t length,
+                      ssize_t *count) {
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    ssize_t i = 0;
+
+    for (; i + 32 <= length; i += 32) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i *)(string + i));
+        __m256i low = _mm256_and_si256(bytes, nibble);
+        __m256i high = _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble);
+
+        *count += POPCOUNT_64(_translate_deleted_avx2(self, bytes, low, high));
+    }
+
+    return i;
+}
+
+/** Internal function to translate blocks of 32 bytes, returns the end. */
+STRING_TARGET("avx2")
+static ssize_t
+_translate_write_avx2(const StringTranslateT *self, const char *string, ssize_t length,
+                      char **cursor) {
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    char *output = *cursor;
+    ssize_t i = 0;
+
+    for (; i + 32 <= length; i += 32) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i *)(string + i));
+        __m256i low = _mm256_and_si256(bytes, nibble);
+        __m256i high = _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble);
+        __m256i mapped = _translate_block_avx2(self, bytes, low, high);
+        uint32_t deleted =
+            self->has_deletions ? _translate_deleted_avx2(self, bytes, low, high) : 0;
+        char block[32];
+
+        if (!deleted) {
+            _mm256_storeu_si256((__m256i *)output, mapped);
+            output += 32;
+            continue;
+        }
+
+        _mm256_storeu_si256((__m256i *)block, mapped);
+        for (uint32_t kept = ~deleted; kept; kept &= kept - 1) {
+            *output++ = block[CTZ_64(kept)];
+        }
+    }
+
+    *cursor = output;
+    return i;
+}
+#endif
+
+/** Internal function to measure the translated string. */
+static ssize_t
+_translate_length(const StringTranslateT *self, const StringT *string) {
+    ssize_t i = 0, deleted = 0;
+
+    if (!self->has_deletions) return string->length;
+
+#ifdef STRING_SIMD_X86
+    if (self->avx2) {
+        i = _translate_count_avx2(self, string->string, string->length, &deleted);
+    }
+#endif
+
+    for (; i < string->length; ++i) {
+        deleted += self->deleted[(unsigned char)string->string[i]];
+    }
+
+    return string->length - deleted;
+}
+
+/** Internal function to write the translated string to ``cursor``. */
+static void
+_translate_write(const StringTranslateT *self, const StringT *string, char *cursor) {
+    ssize_t i = 0;
+
+#ifdef STRING_SIMD_X86
+    if (self->avx2) {
+        i = _translate_write_avx2(self, string->string, string->length, &cursor);
+    }
+#endif
+
+    // Branchless: a deleted byte is written and then overwritten by the next one.
+    for (; i < string->length; ++i) {
+        unsigned char ch = string->string[i];
+
+        *cursor = (char)self->map[ch];
+        cursor += !self->deleted[ch];
+    }
+}
+
+/**
+ * Translate the string and append the result to ``output``.
+ * See :func:`String_translate`.
+ *
+ * .. note:: ``output`` is grown at most once, by the exact size of the result.
+ */
+void
+String_translate_into(StringT *output, const StringT *self,
+                      const StringTranslateT *table) {
+    ssize_t size = _translate_length(table, self);
+
+    _translate_write(table, self, string_reserve_tail(output, size));
+    output->length += size;
+    output->string[output->length] = '\0';
+}
+
+/**
+ * Replace every byte of the string through the translation table, removing its
+ * deleted bytes, and return the translated string.
+ *
+ * .. note:: Has time complexity of O(n). With AVX2, 32 bytes are translated at a time
+ *           and the cost grows with the number of rows of 16 byte values the table
+ *           changes. The result is allocated exactly once.
+ *
+ * .. code-block:: c
+ *
+ *    StringT *from = String_from("/"), *to = String_from("_");
+ *    StringT *deleted = String_from("\n");
+ *    StringTranslateT *table = StringTranslate_from(from, to, deleted);
+ *    StringT *string = String_from("a/b/c\n");
+ *    StringT *translated = String_translate(string, table);
+ *
+ *    assert(String_eq(translated, "a_b_c"));
+ */
+StringT *
+String_translate(const StringT *self, const StringTranslateT *table) {
+    ssize_t size = _translate_length(table, self);
+    StringT *output = String_new(size + 1);
+
+    _translate_write(table, self, output->string);
+    output->length = size;
+    output->string[size] = '\0';
+
+    return output;
+}
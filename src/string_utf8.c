@@ -0,0 +1,401 @@
+#include "string_ext.h"
+
+#include "string_dbg.h"
+#include "string_internal.h"
+#include "string_simd.h"
+
+#include <string.h> /* memcpy */
+
+
+/*
+ * UTF-8 aware functions. Everything else in the library works on bytes, these
+ * functions work on code points.
+ *
+ * Validation follows "Validating UTF-8 In Less Than One Instruction Per Byte" by John
+ * Keiser and Daniel Lemire (the "lookup" algorithm of simdjson): every error in a
+ * pair of consecutive bytes is classified by three 16 entry table lookups on the high
+ * and low nibble of the first byte and the high nibble of the second byte, so that
+ * 32 bytes are checked with a handful of shuffles and no branches.
+ */
+
+/// Continuation bytes are 0b10xxxxxx, i.e. -128 to -65 as signed chars.
+#define UTF8_IS_CONTINUATION(ch) ((signed char)(ch) < -64)
+
+/**
+ * Internal scalar validator, used when the CPU has no AVX2. Follows table 3-7 of the
+ * Unicode standard and skips 8 ASCII bytes at once.
+ */
+static bool
+_utf8_validate_scalar(const unsigned char *string, ssize_t length) {
+    ssize_t i = 0;
+
+    while (i < length) {
+        unsigned char ch = string[i], low = 0x80, high = 0xBF;
+        int continuations;
+        uint64_t word;
+
+        if (i + 8 <= length) {
+            memcpy(&word, string + i, sizeof word);
+            if (!(word & 0x8080808080808080ull)) {
+                i += 8;
+                continue;
+            }
+        }
+
+        if (ch < 0x80) {
+            i++;
+            continue;
+        } else if (ch < 0xC2) {
+            return false;
+        } else if (ch < 0xE0) {
+            continuations = 1;
+        } else if (ch < 0xF0) {
+            continuations = 2;
+            if (ch == 0xE0) low = 0xA0;
+            if (ch == 0xED) high = 0x9F;
+        } else if (ch < 0xF5) {
+            continuations = 3;
+            if (ch == 0xF0) low = 0x90;
+            if (ch == 0xF4) high = 0x8F;
+        } else {
+            return false;
+        }
+
+        if (i + continuations >= length) {
+            return false;
+        }
+        // Only the first continuation byte has a narrower range.
+        if (string[i + 1] < low || string[i + 1] > high) {
+            return false;
+        }
+        for (int j = 2; j <= continuations; ++j) {
+            if (!UTF8_IS_CONTINUATION(string[i + j])) return false;
+        }
+        i += continuations + 1;
+    }
+
+    return true;
+}
+
+#ifdef STRING_SIMD_X86
+
+// Error classes of a pair of bytes, see the paper for the derivation of the tables.
+#define UTF8_TOO_SHORT (1 << 0)
+#define UTF8_TOO_LONG (1 << 1)
+#define UTF8_OVERLONG_3 (1 << 2)
+#define UTF8_TOO_LARGE (1 << 3)
+#define UTF8_SURROGATE (1 << 4)
+#define UTF8_OVERLONG_2 (1 << 5)
+#define UTF8_TOO_LARGE_1000 (1 << 6)
+#define UTF8_OVERLONG_4 (1 << 6)
+#define UTF8_TWO_CONTS (1 << 7)
+#define UTF8_CARRY (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+
+#define UTF8_TABLE(...) _mm256_setr_epi8(__VA_ARGS__, __VA_ARGS__)
+#define B(x) ((char)(x))
+
+typedef struct {
+    __m256i error;
+    __m256i previous;
+    __m256i previous_incomplete;
+} Utf8StateT;
+
+/** Internal function to check 32 bytes, ``state`` carries the bytes before them. */
+STRING_TARGET("avx2")
+static inline void
+_utf8_check_block_avx2(Utf8StateT *state, __m256i input) {
+    const __m256i byte_1_high = UTF8_TABLE(
+        // 0_______ ________ <ASCII in byte 1>
+        B(UTF8_TOO_LONG), B(UTF8_TOO_LONG), B(UTF8_TOO_LONG), B(UTF8_TOO_LONG),
+        B(UTF8_TOO_LONG), B(UTF8_TOO_LONG), B(UTF8_TOO_LONG), B(UTF8_TOO_LONG),
+        // 10______ ________ <continuation in byte 1>
+        B(UTF8_TWO_CONTS), B(UTF8_TWO_CONTS), B(UTF8_TWO_CONTS), B(UTF8_TWO_CONTS),
+        // 1100____ ________ <two byte lead in byte 1>
+        B(UTF8_TOO_SHORT | UTF8_OVERLONG_2),
+        // 1101____ ________ <two byte lead in byte 1>
+        B(UTF8_TOO_SHORT),
+        // 1110____ ________ <three byte lead in byte 1>
+        B(UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE),
+        // 1111____ ________ <four+ byte lead in byte 1>
+        B(UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4));
+    const __m256i byte_1_low = UTF8_TABLE(
+        // ____0000 ________
+        B(UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4),
+        // ____0001 ________
+        B(UTF8_CARRY | UTF8_OVERLONG_2),
+        // ____001_ ________
+        B(UTF8_CARRY), B(UTF8_CARRY),
+        // ____0100 ________
+        B(UTF8_CARRY | UTF8_TOO_LARGE),
+        // ____0101 ________ up to ____1100 ________
+        B(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+        B(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+        B(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+        B(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+        B(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+        B(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+        B(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+        B(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+        // ____1101 ________
+        B(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE),
+        // ____111_ ________
+        B(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+        B(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000));
+    const __m256i byte_2_high = UTF8_TABLE(
+        // ________ 0_______ <ASCII in byte 2>
+        B(UTF8_TOO_SHORT), B(UTF8_TOO_SHORT), B(UTF8_TOO_SHORT), B(UTF8_TOO_SHORT),
+        B(UTF8_TOO_SHORT), B(UTF8_TOO_SHORT), B(UTF8_TOO_SHORT), B(UTF8_TOO_SHORT),
+        // ________ 1000____
+        B(UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 |
+          UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4),
+        // ________ 1001____
+        B(UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 |
+          UTF8_TOO_LARGE),
+        // ________ 101_____
+        B(UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE |
+          UTF8_TOO_LARGE),
+        B(UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE |
+          UTF8_TOO_LARGE),
+        // ________ 11______
+        B(UTF8_TOO_SHORT), B(UTF8_TOO_SHORT), B(UTF8_TOO_SHORT), B(UTF8_TOO_SHORT));
+    // Any lead byte in the last three positions still waits for continuation bytes.
+    const __m256i incomplete_max =
+        _mm256_setr_epi8(B(255), B(255), B(255), B(255), B(255), B(255), B(255), B(255),
+                         B(255), B(255), B(255), B(255), B(255), B(255), B(255), B(255),
+                         B(255), B(255), B(255), B(255), B(255), B(255), B(255), B(255),
+                         B(255), B(255), B(255), B(255), B(255), B(0xF0 - 1),
+                         B(0xE0 - 1), B(0xC0 - 1));
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    __m256i shifted, previous_1, previous_2, previous_3, high_1, high_2;
+    __m256i special, must_be_23;
+
+    if (!_mm256_movemask_epi8(input)) {
+        state->error = _mm256_or_si256(state->error, state->previous_incomplete);
+        state->previous_incomplete = _mm256_setzero_si256();
+        state->previous = input;
+        return;
+    }
+
+    // Vectors of the bytes 1, 2 and 3 positions before each byte.
+    shifted = _mm256_permute2x128_si256(state->previous, input, 0x21);
+    previous_1 = _mm256_alignr_epi8(input, shifted, 15);
+    previous_2 = _mm256_alignr_epi8(input, shifted, 14);
+    previous_3 = _mm256_alignr_epi8(input, shifted, 13);
+
+    high_1 = _mm256_and_si256(_mm256_srli_epi16(previous_1, 4), nibble);
+    high_2 = _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble);
+    special = _mm256_and_si256(
+        _mm256_and_si256(_mm256_shuffle_epi8(byte_1_high, high_1),
+                         _mm256_shuffle_epi8(byte_1_low,
+                                             _mm256_and_si256(previous_1, nibble))),
+        _mm256_shuffle_epi8(byte_2_high, high_2));
+
+    // Two continuation bytes in a row are only valid after a 3 or 4 byte lead.
+    must_be_23 = _mm256_or_si256(_mm256_subs_epu8(previous_2, _mm256_set1_epi8(0x60)),
+                                 _mm256_subs_epu8(previous_3, _mm256_set1_epi8(0x70)));
+    must_be_23 = _mm256_and_si256(must_be_23, _mm256_set1_epi8(B(0x80)));
+
+    state->error = _mm256_or_si256(state->error, _mm256_xor_si256(must_be_23, special));
+    state->previous_incomplete = _mm256_subs_epu8(input, incomplete_max);
+    state->previous = input;
+}
+
+STRING_TARGET("avx2")
+static bool
+_utf8_validate_avx2(const unsigned char *string, ssize_t length) {
+    Utf8StateT state = {_mm256_setzero_si256(), _mm256_setzero_si256(),
+                        _mm256_setzero_si256()};
+    unsigned char tail[32] = {0};
+    ssize_t i = 0;
+
+    for (; i + 32 <= length; i += 32) {
+        _utf8_check_block_avx2(&state,
+                               _mm256_loadu_si256((const __m256i *)(string + i)));
+    }
+    if (i < length) {
+        // Zero padding reads as ASCII, so it can't hide nor cause an error.
+        memcpy(tail, string + i, length - i);
+        _utf8_check_block_avx2(&state, _mm256_loadu_si256((const __m256i *)tail));
+    }
+    state.error = _mm256_or_si256(state.error, state.previous_incomplete);
+
+    return _mm256_testz_si256(state.error, state.error);
+}
+
+#undef B
+#undef UTF8_TABLE
+#endif /* STRING_SIMD_X86 */
+
+/**
+ * Check if ``length`` bytes of ``string`` are valid UTF-8. See
+ * :func:`String_utf8_validate` for more info.
+ */
+bool
+String_utf8_validate_char_array(const char *string, ssize_t length) {
+#ifdef STRING_SIMD_X86
+    if (STRING_CPU_HAS("avx2")) {
+        return _utf8_validate_avx2((const unsigned char *)string, length);
+    }
+#endif
+    return _utf8_validate_scalar((const unsigned char *)string, length);
+}
+
+/**
+ * Check if the string is valid UTF-8: no overlong encodings, surrogates, code points
+ * above U+10FFFF, nor truncated or stray continuation bytes.
+ *
+ * .. note:: Has time complexity of O(n), 32 bytes are checked at once on CPUs with
+ *           AVX2.
+ *
+ * .. code-block:: c
+ *
+ *    StringT *valid = String_from("Grüße");
+ *    StringT *invalid = String_from("\xC3\x28");
+ *
+ *    assert(String_utf8_validate(valid));
+ *    assert(!String_utf8_validate(invalid));
+ */
+bool
+String_utf8_validate(const StringT *self) {
+    return String_utf8_validate_char_array(self->string, self->length);
+}
+
+/**
+ * Count the code points of the string, i.e. the bytes which are not continuation
+ * bytes.
+ *
+ * .. note:: The string is expected to be valid UTF-8, see
+ *           :func:`String_utf8_validate`. Has time complexity of O(n), 16 bytes are
+ *           counted at once.
+ *
+ * .. code-block:: c
+ *
+ *    StringT *string = String_from("Grüße");
+ *
+ *    assert(string->length == 7 && String_utf8_length(string) == 5);
+ */
+ssize_t
+String_utf8_length(const StringT *self) {
+    const char *string = self->string;
+    ssize_t count = 0, i = 0;
+
+#ifdef STRING_SIMD_X86
+    const __m128i last_continuation = _mm_set1_epi8(-65);
+
+    for (; i + 16 <= self->length; i += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)(string + i));
+        count += POPCOUNT_64(_mm_movemask_epi8(_mm_cmpgt_epi8(bytes, last_continuation)));
+    }
+#endif
+
+    for (; i < self->length; ++i) {
+        count += !UTF8_IS_CONTINUATION(string[i]);
+    }
+
+    return count;
+}
+
+/** Internal function to skip ``count`` code points starting at the byte ``from``. */
+static inline ssize_t
+_utf8_skip(const StringT *self, ssize_t from, ssize_t count) {
+    for (; count > 0 && from < self->length; --count) {
+        do {
+            from++;
+        } while (from < self->length && UTF8_IS_CONTINUATION(self->string[from]));
+    }
+
+    return from;
+}
+
+/**
+ * Get the slice of the string, with ``index`` counted in code points instead of bytes.
+ * The index is normalized like in :func:`String_slice` (see
+ * :func:`StringIndex_normalize`), so both give the same slice of an ASCII string.
+ *
+ * .. note:: The string is expected to be valid UTF-8. Has time complexity of O(n).
+ *
+ * .. code-block:: c
+ *
+ *    StringT *string = String_from("Grüße, Welt");
+ *    StringT *slice = String_utf8_slice(string, StringIndex(2, 5));
+ *
+ *    assert(String_eq(slice, "üße"));
+ */
+StringT *
+String_utf8_slice(const StringT *self, StringIndexT index) {
+    ssize_t count = String_utf8_length(self), length;
+    ssize_t *offsets, slice_length = 0, from, to;
+    StringT *slice;
+
+    if (index.step == 0) ERR("String_utf8_slice: step cannot be 0");
+
+    index = StringIndex_normalize(index, count);
+    length = StringIndex_len(index);
+
+    if (index.step == 1) {
+        from = _utf8_skip(self, 0, index.start);
+        to = _utf8_skip(self, from, length);
+
+        slice = String_new(to - from + 1);
+        memcpy(slice->string, self->string + from, to - from);
+        slice->string[to - from] = '\0';
+        slice->length = to - from;
+        return slice;
+    }
+
+    // Any other step needs random access to the code points.
+    offsets = malloc((count + 1) * sizeof *offsets);
+    if (offsets == NULL) {
+        ERR("Unable to allocate memory for `ssize_t *`");
+    }
+    for (ssize_t i = 0, k = 0; i <= self->length; ++i) {
+        if (i == self->length || !UTF8_IS_CONTINUATION(self->string[i])) {
+            offsets[k++] = i;
+        }
+    }
+
+    slice = String_new(self->length + 1);
+    for (ssize_t k = 0, i = index.start; k < length; ++k, i += index.step) {
+        ssize_t size = offsets[i + 1] - offsets[i];
+
+        memcpy(slice->string + slice_length, self->string + offsets[i], size);
+        slice_length += size;
+    }
+    slice->string[slice_length] = '\0';
+    slice->length = slice_length;
+
+    free(offsets);
+    return slice;
+}
+
+/**
+ * Reverse the order of the code points of the string and return the new string. Unlike
+ * :func:`String_reverse`, multibyte sequences are kept intact.
+ *
+ * .. note:: Has time complexity of O(n).
+ *
+ * .. code-block:: c
+ *
+ *    StringT *string = String_from("Grüße");
+ *    StringT *reversed = String_utf8_reverse(string);
+ *
+ *    assert(String_eq(reversed, "eßürG"));
+ */
+StringT *
+String_utf8_reverse(const StringT *self) {
+    StringT *reversed = String_new(self->length + 1);
+    ssize_t stop = self->length, written = 0;
+
+    while (stop > 0) {
+        ssize_t start = stop - 1;
+
+        while (start > 0 && UTF8_IS_CONTINUATION(self->string[start])) start--;
+        memcpy(reversed->string + written, self->string + start, stop - start);
+        written += stop - start;
+        stop = start;
+    }
+    reversed->string[written] = '\0';
+    reversed->length = written;
+
+    return reversed;
+}
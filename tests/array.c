@@ -0,0 +1,147 @@
+/// Tests the columnar `StringArrayT` and the functions producing / consuming it.
+
+#include "string_ext.h"
+#include "string_utils.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static void
+test_array_append_get() {
+    StringArrayT *array = StringArray_new(1, 2);
+    StringT *str = String_from("Hello");
+
+    StringArray_append(array, str);
+    StringArray_append_char_array(array, "World!", 6);
+
+    StringT first = StringArray_get(array, 0);
+    StringT last = StringArray_get(array, -1);
+
+    log_result(__func__, array->length == 2 && array->data_length == 11 &&
+                             string_t_equals(&first, str) &&
+                             last.length == 6 && String_eq(&last, "World!"));
+    STRING_FREE_MULTIPLE(str);
+    StringArray_free(array);
+}
+
+static void
+test_array_from_iterator() {
+    StringIteratorT *iter = StringIterator_new();
+    StringT *foo = String_from("Foo");
+    StringT *empty = String_from("");
+    StringT *bar = String_from("Bar");
+
+    StringIterator_append(iter, foo);
+    StringIterator_append(iter, empty);
+    StringIterator_append(iter, bar);
+
+    StringArrayT *array = StringArray_from_iterator(iter);
+    StringT middle = StringArray_get(array, 1);
+
+    log_result(__func__, array->length == 3 && array->data_length == 6 &&
+                             middle.length == 0 && array->offsets[3] == 6);
+    STRING_FREE_MULTIPLE(foo, empty, bar);
+    STRING_ITERATOR__FREE_MULTIPLE(iter);
+    StringArray_free(array);
+}
+
+static void
+test_split_array() {
+    StringT *str = String_from("foo,bar,,spam");
+    StringT *delimiter = String_from(",");
+    StringArrayT *all = String_split_array(str, delimiter);
+    StringArrayT *limited = String_split_array_limit(str, delimiter, 1);
+
+    StringT third = StringArray_get(all, 2);
+    StringT rest = StringArray_get(limited, 1);
+
+    log_result(__func__, all->length == 4 && third.length == 0 &&
+                             limited->length == 2 && rest.length == 9 &&
+                             String_eq(&rest, "bar,,spam"));
+    STRING_FREE_MULTIPLE(str, delimiter);
+    StringArray_free(all);
+    StringArray_free(limited);
+}
+
+static void
+test_split_whitespace_array() {
+    // Random texts crossing the 64 byte blocks, checked against a byte by byte split.
+    const char alphabet[] = "ab \t\n\rxyz  ";
+    char text[300];
+    int result = 1;
+
+    srand(3);
+    for (int round = 0; round < 2000; ++round) {
+        ssize_t length = rand() % (ssize_t)sizeof text, limit = rand() % 8 - 1;
+        StringT string = {.string = text, .length = length};
+        StringArrayT *tokens;
+        ssize_t count = 0, i = 0;
+
+        for (ssize_t j = 0; j < length; ++j) {
+            text[j] = alphabet[rand() % (sizeof alphabet - 1)];
+        }
+        tokens = String_split_whitespace_array_limit(&string, limit);
+
+        while (result) {
+            ssize_t start;
+
+            while (i < length && strchr(" \t\n\r", text[i])) i++;
+            if (i == length) break;
+            start = i;
+            if (count == limit) {
+                i = length;
+            } else {
+                while (i < length && !strchr(" \t\n\r", text[i])) i++;
+            }
+
+            StringT token = StringArray_get(tokens, count++);
+            result &= token.length == i - start &&
+                      memcmp(token.string, text + start, i - start) == 0;
+        }
+        result &= tokens->length == count;
+        StringArray_free(tokens);
+    }
+
+    log_result(__func__, result);
+}
+
+static void
+test_chunks_array() {
+    StringT *str = String_from("abcdefg");
+    StringArrayT *chunks = String_chunks_array(str, 3);
+    StringT last = StringArray_get(chunks, -1);
+
+    log_result(__func__, chunks->length == 3 && last.length == 1 &&
+                             String_eq(&last, "g"));
+    STRING_FREE_MULTIPLE(str);
+    StringArray_free(chunks);
+}
+
+static void
+test_join_array() {
+    StringT *str = String_from("Foo Bar Spam Egg");
+    StringT *space = String_from(" ");
+    StringT *dash = String_from("-");
+    StringArrayT *words = String_split_array(str, space);
+    StringArrayT *empty = StringArray_new(0, 0);
+
+    StringT *joined = String_join_array(words, dash);
+    StringT *joined_expected = String_from("Foo-Bar-Spam-Egg");
+    StringT *joined_empty = String_join_array(empty, dash);
+
+    log_result(__func__, string_t_equals(joined, joined_expected) &&
+                             joined_empty->length == 0);
+    STRING_FREE_MULTIPLE(str, space, dash, joined, joined_expected, joined_empty);
+    StringArray_free(words);
+    StringArray_free(empty);
+}
+
+int
+main() {
+    test_array_append_get();
+    test_array_from_iterator();
+    test_split_array();
+    test_split_whitespace_array();
+    test_chunks_array();
+    test_join_array();
+}
@@ -0,0 +1,92 @@
+/// Tests the batch transforms and predicates of `StringArrayT` and `StringIteratorT`.
+
+#include "string_ext.h"
+#include "string_utils.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static int
+array_element_equals(const StringArrayT *array, ssize_t index, const StringT *string) {
+    StringT element = StringArray_get(array, index);
+
+    return element.length == string->length &&
+           memcmp(element.string, string->string, string->length) == 0;
+}
+
+static void
+test_batch_transform() {
+    StringT *string = String_from(" Foo ,BAR  ,Straße, ,\tΑθηνα\n");
+    StringT *comma = String_from(",");
+    StringArrayT *array = String_split_array(string, comma);
+    StringArrayT *trimmed =
+        StringArray_transform(array, STRING_TRANSFORM_TRIM_WHITESPACE, 1);
+    StringArrayT *upper = StringArray_transform(trimmed, STRING_TRANSFORM_UPPER, 1);
+    StringArrayT *left = StringArray_transform(array, STRING_TRANSFORM_TRIM_LEFT, 1);
+    StringT last = StringArray_get(upper, -1);
+    int result = upper->length == 5 && upper->data_length == upper->data_allocated &&
+                 last.length == 10 && memcmp(last.string, "ΑΘΗΝΑ", 10) == 0 &&
+                 StringArray_get(upper, 2).length == 7 &&
+                 StringArray_get(upper, 3).length == 0 &&
+                 memcmp(StringArray_get(left, 1).string, "BAR  ", 5) == 0;
+
+    log_result(__func__, result);
+    StringArray_free(array);
+    StringArray_free(trimmed);
+    StringArray_free(upper);
+    StringArray_free(left);
+    STRING_FREE_MULTIPLE(string, comma);
+}
+
+static void
+test_batch_transform_parallel() {
+    // More elements than a thread handles at once, checked against `String_to_lower`.
+    StringIteratorT *iterator = StringIterator_new();
+    StringArrayT *lower;
+    char buffer[32];
+    int result = 1;
+
+    for (int i = 0; i < 5000; ++i) {
+        snprintf(buffer, sizeof buffer, "Token-%d-ÄÖÜ-%s", i, i % 3 ? "ABC" : "ß");
+        StringIterator_append(iterator, String_from(buffer));
+    }
+
+    lower = StringIterator_transform(iterator, STRING_TRANSFORM_LOWER, 4);
+    result &= lower->length == iterator->length;
+    for (ssize_t i = 0; i < iterator->length; ++i) {
+        StringT *expected = String_to_lower(iterator->strings[i]);
+
+        result &= array_element_equals(lower, i, expected);
+        String_free(expected);
+    }
+
+    log_result(__func__, result);
+    StringArray_free(lower);
+    for (ssize_t i = 0; i < iterator->length; ++i) {
+        String_free((StringT *)iterator->strings[i]);
+    }
+    StringIterator_free(iterator);
+}
+
+static void
+test_batch_test() {
+    StringT *string = String_from("12 abc 3.5 007  x1 99");
+    StringT *space = String_from(" ");
+    StringArrayT *array = String_split_array(string, space);
+    bool results[8];
+    ssize_t ints = StringArray_test(array, STRING_TEST_INT, results, 0);
+
+    log_result(__func__, array->length == 7 && ints == 4 && results[0] && !results[1] &&
+                             !results[2] && results[3] && results[4] && !results[5] &&
+                             results[6] &&
+                             StringArray_test(array, STRING_TEST_REAL, NULL, 1) == 5);
+    StringArray_free(array);
+    STRING_FREE_MULTIPLE(string, space);
+}
+
+int
+main() {
+    test_batch_transform();
+    test_batch_transform_parallel();
+    test_batch_test();
+}
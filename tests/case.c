@@ -0,0 +1,65 @@
+/// Tests the Unicode case conversion of `StringT`.
+
+#include "string_ext.h"
+#include "string_utils.h"
+
+static void
+test_case_upper() {
+    StringT *string = String_from("Hello, Straße! ÀÉÎõü ǆ αθηνα ﬁ");
+    StringT *upper = String_to_upper(string);
+
+    log_result(__func__, String_eq(upper, "HELLO, STRASSE! ÀÉÎÕÜ Ǆ ΑΘΗΝΑ FI") &&
+                             upper->length == 43);
+    STRING_FREE_MULTIPLE(string, upper);
+}
+
+static void
+test_case_lower() {
+    StringT *string = String_from("HELLO, ΑΘΗΝΑ, ДОБРЫЙ ДЕНЬ and ＡＢＣ");
+    StringT *lower = String_to_lower(string);
+
+    log_result(__func__, String_eq(lower, "hello, αθηνα, добрый день and ａｂｃ"));
+    STRING_FREE_MULTIPLE(string, lower);
+}
+
+static void
+test_case_swap_and_fold() {
+    StringT *string = String_from("Hello, Ωmega");
+    StringT *sharp_s = String_from("Straße");
+    StringT *double_s = String_from("STRASSE");
+    StringT *swapped = String_swap_case(string);
+    StringT *folded1 = String_case_fold(sharp_s);
+    StringT *folded2 = String_case_fold(double_s);
+
+    log_result(__func__, String_eq(swapped, "hELLO, ωMEGA") &&
+                             String_eq(folded1, "strasse") &&
+                             String_equals(folded1, folded2));
+    STRING_FREE_MULTIPLE(string, sharp_s, double_s, swapped, folded1, folded2);
+}
+
+static void
+test_case_ascii_blocks() {
+    // Long enough for the 16 byte blocks, with a non-ASCII block in the middle.
+    StringT *string = String_from("the quick brown fox jumps over the lazy dog ÉTÉ "
+                                  "the quick brown fox jumps over the lazy dog");
+    StringT *upper = String_to_upper(string);
+    StringT *lower = String_to_lower(string);
+    StringT *invalid = String_from("abc\xFF\xC3" "def");
+    StringT *invalid_upper = String_to_upper(invalid);
+
+    log_result(__func__,
+               String_eq(upper, "THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG ÉTÉ "
+                                "THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG") &&
+                   String_eq(lower, "the quick brown fox jumps over the lazy dog été "
+                                    "the quick brown fox jumps over the lazy dog") &&
+                   String_eq(invalid_upper, "ABC\xFF\xC3" "DEF"));
+    STRING_FREE_MULTIPLE(string, upper, lower, invalid, invalid_upper);
+}
+
+int
+main() {
+    test_case_upper();
+    test_case_lower();
+    test_case_swap_and_fold();
+    test_case_ascii_blocks();
+}
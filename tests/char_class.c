@@ -0,0 +1,80 @@
+/// Tests the character classes `StringCharClassT`.
+
+#include "string_char_class.h"
+#include "string_utils.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static void
+test_char_class_search() {
+    StringT *delimiters = String_from(",;");
+    StringT *digits = String_from("0123456789");
+    StringCharClassT *delimiter = StringCharClass_new(delimiters);
+    StringCharClassT *digit = StringCharClass_new(digits);
+    StringT *string = String_from("key=value;port 8080,other=1");
+
+    log_result(__func__, StringCharClass_find_first(delimiter, string, 0) == 9 &&
+                             StringCharClass_find_first(delimiter, string, 10) == 19 &&
+                             StringCharClass_find_first(delimiter, string, 20) == -1 &&
+                             StringCharClass_find_last(delimiter, string, 19) == 9 &&
+                             StringCharClass_find_last(delimiter, string, 9) == -1 &&
+                             StringCharClass_span(digit, string, 15) == 4 &&
+                             StringCharClass_span(digit, string, 26) == 1 &&
+                             StringCharClass_span(digit, string, 27) == 0 &&
+                             StringCharClass_count(digit, string) == 5 &&
+                             StringCharClass_contains(delimiter, ';') &&
+                             !StringCharClass_contains(delimiter, '='));
+    StringCharClass_free(delimiter);
+    StringCharClass_free(digit);
+    STRING_FREE_MULTIPLE(delimiters, digits, string);
+}
+
+static void
+test_char_class_random() {
+    char buffer[300], members[40];
+    int result = 1;
+
+    srand(29);
+    for (int round = 0; round < 300; ++round) {
+        // Classes of a few bytes and large ones, with bytes from the whole range.
+        ssize_t size = round % 2 ? 1 + rand() % 4 : 1 + rand() % 40;
+        ssize_t length = rand() % sizeof buffer;
+        StringT class_string = {.string = members, .length = size};
+        StringT string = {.string = buffer, .length = length};
+        StringCharClassT *class;
+        ssize_t first = -1, last = -1, span = 0, count = 0, start = length / 3;
+
+        for (ssize_t i = 0; i < size; ++i) {
+            members[i] = (char)(rand() % 256);
+        }
+        class = StringCharClass_new(&class_string);
+
+        for (ssize_t i = 0; i < length; ++i) {
+            buffer[i] = rand() % 4 ? (char)(rand() % 256) : members[rand() % size];
+        }
+        for (ssize_t i = 0; i < length; ++i) {
+            bool member = memchr(members, buffer[i], size) != NULL;
+
+            if (member && first < 0 && i >= start) first = i;
+            if (member) last = i, count++;
+        }
+        while (start + span < length && memchr(members, buffer[start + span], size)) {
+            span++;
+        }
+
+        result &= StringCharClass_find_first(class, &string, start) == first &&
+                  StringCharClass_find_last(class, &string, length) == last &&
+                  StringCharClass_span(class, &string, start) == span &&
+                  StringCharClass_count(class, &string) == count;
+        StringCharClass_free(class);
+    }
+
+    log_result(__func__, result);
+}
+
+int
+main() {
+    test_char_class_search();
+    test_char_class_random();
+}
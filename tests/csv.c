@@ -0,0 +1,153 @@
+/// Tests the streaming CSV parser `StringCsvParserT`.
+
+#include "string_csv.h"
+#include "string_utils.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static int
+field_equals(const StringCsvFieldT *field, const char *expected) {
+    return field->length == (ssize_t)strlen(expected) &&
+           memcmp(field->string, expected, field->length) == 0;
+}
+
+static void
+test_csv_rfc4180() {
+    const char *input = "name,comment,n\r\n"
+                        "alice,\"likes, commas\",1\r\n"
+                        "\r\n"
+                        "bob,\"says \"\"hi\"\"\nover two lines\",\r\n"
+                        "carol,,3";
+    StringCsvParserT *parser = StringCsvParser_new(NULL);
+    StringCsvRecordT record;
+    StringT *unescaped;
+    int result = 1;
+
+    StringCsvParser_feed(parser, input, strlen(input));
+    StringCsvParser_finish(parser);
+
+    result &= StringCsvParser_next(parser, &record) && record.length == 3 &&
+              field_equals(&record.fields[2], "n");
+    result &= StringCsvParser_next(parser, &record) && record.length == 3 &&
+              field_equals(&record.fields[1], "likes, commas") &&
+              record.fields[1].quoted && !record.fields[1].escaped;
+    result &= StringCsvParser_next(parser, &record) && record.length == 3 &&
+              record.fields[1].escaped && field_equals(&record.fields[2], "");
+    unescaped = StringCsvParser_unescape(parser, &record.fields[1]);
+    result &= String_eq(unescaped, "says \"hi\"\nover two lines");
+    result &= StringCsvParser_next(parser, &record) && record.length == 3 &&
+              field_equals(&record.fields[0], "carol") &&
+              field_equals(&record.fields[1], "") && field_equals(&record.fields[2], "3");
+    result &= !StringCsvParser_next(parser, &record);
+
+    log_result(__func__, result);
+    StringCsvParser_free(parser);
+    STRING_FREE_MULTIPLE(unescaped);
+}
+
+static void
+test_csv_escape_dialect() {
+    const char *input = "a\\;b;'c;\\'d';e\\\nf\n";
+    StringCsvOptionsT options = {.delimiter = ';', .quote = '\'', .escape = '\\'};
+    StringCsvParserT *parser = StringCsvParser_new(&options);
+    StringCsvRecordT record;
+    StringT *first, *second, *third;
+    int result;
+
+    StringCsvParser_feed(parser, input, strlen(input));
+    StringCsvParser_finish(parser);
+    result = StringCsvParser_next(parser, &record) && record.length == 3;
+    first = StringCsvParser_unescape(parser, &record.fields[0]);
+    second = StringCsvParser_unescape(parser, &record.fields[1]);
+    third = StringCsvParser_unescape(parser, &record.fields[2]);
+
+    log_result(__func__, result && String_eq(first, "a;b") && String_eq(second, "c;'d") &&
+                             String_eq(third, "e\nf") &&
+                             !StringCsvParser_next(parser, &record));
+    StringCsvParser_free(parser);
+    STRING_FREE_MULTIPLE(first, second, third);
+}
+
+/// Serialise every record as `field|field|...\n`, unescaping the fields.
+static void
+collect(StringCsvParserT *parser, StringT *output) {
+    StringCsvRecordT record;
+    StringT *bar = String_from("|"), *newline = String_from("\n");
+
+    while (StringCsvParser_next(parser, &record)) {
+        for (ssize_t i = 0; i < record.length; ++i) {
+            StringT *field = StringCsvParser_unescape(parser, &record.fields[i]);
+
+            String_concatenate_inplace(output, field);
+            String_concatenate_inplace(output, i + 1 < record.length ? bar : newline);
+            String_free(field);
+        }
+    }
+    STRING_FREE_MULTIPLE(bar, newline);
+}
+
+static void
+test_csv_streaming() {
+    // Quoted fields spanning the 64 byte blocks, fed in random pieces.
+    const char *pieces[] = {"plain", "\"quoted, with \"\" and\nnewline\"", "",
+                            "a longer field to cross the block boundaries of the scan",
+                            "\"\""};
+    StringT *input = String_from("");
+    StringT *expected = String_new(1);
+    StringT *comma = String_from(","), *newline = String_from("\n");
+    int result = 1;
+
+    srand(11);
+    for (int row = 0; row < 300; ++row) {
+        for (int column = 0; column < 4; ++column) {
+            StringT *piece = String_from(pieces[rand() % 5]);
+
+            String_concatenate_inplace(input, piece);
+            String_concatenate_inplace(input, column < 3 ? comma : newline);
+            String_free(piece);
+        }
+    }
+
+    {
+        StringCsvParserT *parser = StringCsvParser_new(NULL);
+
+        StringCsvParser_feed(parser, input->string, input->length);
+        StringCsvParser_finish(parser);
+        expected->string[0] = '\0';
+        collect(parser, expected);
+        StringCsvParser_free(parser);
+    }
+
+    for (int round = 0; round < 20; ++round) {
+        StringCsvParserT *parser = StringCsvParser_new(NULL);
+        StringT *output = String_new(1);
+        ssize_t fed = 0;
+
+        output->string[0] = '\0';
+        while (fed < input->length) {
+            ssize_t size = rand() % 100;
+
+            size = size < input->length - fed ? size : input->length - fed;
+            StringCsvParser_feed(parser, input->string + fed, size);
+            fed += size;
+            collect(parser, output);
+        }
+        StringCsvParser_finish(parser);
+        collect(parser, output);
+
+        result &= String_equals(output, expected);
+        StringCsvParser_free(parser);
+        String_free(output);
+    }
+
+    log_result(__func__, result && expected->length > input->length / 2);
+    STRING_FREE_MULTIPLE(input, expected, comma, newline);
+}
+
+int
+main() {
+    test_csv_rfc4180();
+    test_csv_escape_dialect();
+    test_csv_streaming();
+}
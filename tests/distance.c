@@ -0,0 +1,180 @@
+/// Tests the edit distance and approximate search of `StringT`.
+
+#include "string_ext.h"
+#include "string_utils.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+/// Reference Levenshtein distance, with the whole dynamic programming matrix.
+static ssize_t
+naive_distance(const char *a, ssize_t n, const char *b, ssize_t m) {
+    ssize_t *row = malloc((m + 1) * sizeof *row), result;
+
+    for (ssize_t j = 0; j <= m; ++j) row[j] = j;
+    for (ssize_t i = 1; i <= n; ++i) {
+        ssize_t diagonal = row[0];
+
+        row[0] = i;
+        for (ssize_t j = 1; j <= m; ++j) {
+            ssize_t above = row[j];
+            ssize_t best = diagonal + (a[i - 1] != b[j - 1]);
+
+            best = above + 1 < best ? above + 1 : best;
+            best = row[j - 1] + 1 < best ? row[j - 1] + 1 : best;
+            row[j] = best;
+            diagonal = above;
+        }
+    }
+
+    result = row[m];
+    free(row);
+    return result;
+}
+
+/// Reference search: first end of a non-empty match with at most `k` errors, or -1.
+static ssize_t
+naive_search(const char *text, ssize_t n, const char *pattern, ssize_t m, ssize_t k) {
+    for (ssize_t end = 1; end <= n; ++end) {
+        for (ssize_t start = 0; start < end; ++start) {
+            if (naive_distance(pattern, m, text + start, end - start) <= k) return end;
+        }
+    }
+    return -1;
+}
+
+static void
+test_levenshtein() {
+    StringT *kitten = String_from("kitten"), *sitting = String_from("sitting");
+    StringT *empty = String_from(""), *recieve = String_from("recieve");
+    StringT *receive = String_from("receive");
+
+    log_result(__func__, String_levenshtein(kitten, sitting) == 3 &&
+                             String_levenshtein(sitting, kitten) == 3 &&
+                             String_levenshtein(empty, kitten) == 6 &&
+                             String_levenshtein(empty, empty) == 0 &&
+                             String_levenshtein_bounded(recieve, receive, 2) == 2 &&
+                             String_levenshtein_bounded(recieve, receive, 1) == -1 &&
+                             String_levenshtein_bounded(kitten, empty, 5) == -1);
+    STRING_FREE_MULTIPLE(kitten, sitting, empty, recieve, receive);
+}
+
+static void
+test_levenshtein_random() {
+    char a[300], b[300];
+    int result = 1;
+
+    srand(31);
+    // Lengths across several words of 64 rows, over small alphabets to get matches.
+    for (int round = 0; round < 400; ++round) {
+        ssize_t n = rand() % 300, m = rand() % 300, bound = rand() % 40;
+        int alphabet = 2 + rand() % 6;
+        StringT string = {.string = a, .length = n}, other = {.string = b, .length = m};
+        ssize_t expected, bounded;
+
+        for (ssize_t i = 0; i < n; ++i) a[i] = 'a' + rand() % alphabet;
+        for (ssize_t i = 0; i < m; ++i) {
+            // Mostly a mutated copy of the first string.
+            b[i] = i < n && rand() % 4 ? a[i] : 'a' + rand() % alphabet;
+        }
+
+        expected = naive_distance(a, n, b, m);
+        bounded = String_levenshtein_bounded(&string, &other, bound);
+        result &= String_levenshtein(&string, &other) == expected &&
+                  bounded == (expected <= bound ? expected : -1);
+    }
+
+    log_result(__func__, result);
+}
+
+static void
+test_fuzzy_contains() {
+    StringT *string = String_from("please recieve the parcel");
+    StringT *pattern = String_from("receive"), *other = String_from("parsley");
+    StringT *empty = String_from("");
+    StringIndexT found = String_fuzzy_contains(string, pattern, 2);
+    StringIndexT exact = String_fuzzy_contains(string, pattern, 0);
+    StringIndexT never = String_fuzzy_contains(string, empty, 3);
+    StringIndexT parcel = String_fuzzy_contains(string, other, 3);
+
+    // The first match to end is "recie", two errors away.
+    log_result(__func__, found.start == 7 && found.stop == 12 && exact.start == 0 &&
+                             exact.stop == 0 && never.stop == 0 && parcel.start == 19 &&
+                             parcel.stop == 24);
+    STRING_FREE_MULTIPLE(string, pattern, other, empty);
+}
+
+static void
+test_fuzzy_contains_random() {
+    char text[120], pattern[80];
+    int result = 1;
+
+    srand(37);
+    for (int round = 0; round < 150; ++round) {
+        ssize_t n = rand() % 120, m = 1 + rand() % 80, k = rand() % 6;
+        StringT string = {.string = text, .length = n};
+        StringT needle = {.string = pattern, .length = m};
+        bool inside = n / 4 + m <= n;
+        StringIndexT index;
+        ssize_t expected;
+
+        for (ssize_t i = 0; i < n; ++i) text[i] = 'a' + rand() % 3;
+        for (ssize_t i = 0; i < m; ++i) {
+            // Often a mutated piece of the text, so that some searches succeed.
+            pattern[i] = inside && rand() % 5 ? text[n / 4 + i] : 'a' + rand() % 3;
+        }
+
+        index = String_fuzzy_contains(&string, &needle, k);
+        expected = naive_search(text, n, pattern, m, k);
+        if (expected < 0) {
+            result &= index.stop == 0;
+        } else {
+            result &= index.stop == expected && index.start < index.stop &&
+                      naive_distance(pattern, m, text + index.start,
+                                     index.stop - index.start) <= k;
+        }
+    }
+
+    log_result(__func__, result);
+}
+
+static void
+test_levenshtein_batch() {
+    StringT *text = String_from("receive deceive recipe recieve relieve");
+    StringT *space = String_from(" "), *query = String_from("recieve");
+    StringArrayT *words = String_split_array(text, space);
+    StringIteratorT *dictionary = StringIterator_new();
+    StringT views[5];
+    ssize_t distances[3000], array_distances[5], expected = 0;
+    int result;
+
+    for (int i = 0; i < 5; ++i) {
+        views[i] = StringArray_get(words, i);
+        expected += String_levenshtein_bounded(&views[i], query, 2) >= 0;
+    }
+    for (int i = 0; i < 3000; ++i) {
+        StringIterator_append(dictionary, &views[i % 5]);
+    }
+
+    result = StringArray_levenshtein(words, query, 2, array_distances, 1) == expected &&
+             array_distances[0] == 2 && array_distances[1] == -1 &&
+             array_distances[3] == 0;
+    result &= StringIterator_levenshtein(dictionary, query, 2, distances, 4) ==
+                  expected * 600 &&
+              distances[2] == array_distances[2] && distances[2998] == 0 &&
+              StringIterator_levenshtein(dictionary, query, -1, NULL, 0) == 3000;
+
+    log_result(__func__, result);
+    StringIterator_free(dictionary);
+    StringArray_free(words);
+    STRING_FREE_MULTIPLE(text, space, query);
+}
+
+int
+main() {
+    test_levenshtein();
+    test_levenshtein_random();
+    test_fuzzy_contains();
+    test_fuzzy_contains_random();
+    test_levenshtein_batch();
+}
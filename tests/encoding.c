@@ -0,0 +1,181 @@
+/// Tests the base64 and hexadecimal encoding of `StringT`.
+
+#include "string_ext.h"
+#include "string_utils.h"
+
+#include <stdlib.h>
+
+static void
+test_base64_rfc4648() {
+    // Test vectors of RFC 4648, section 10.
+    const char *data[] = {"", "f", "fo", "foo", "foob", "fooba", "foobar"};
+    const char *padded[] = {"",         "Zg==",     "Zm8=",    "Zm9v",
+                            "Zm9vYg==", "Zm9vYmE=", "Zm9vYmFy"};
+    const char *unpadded[] = {"", "Zg", "Zm8", "Zm9v", "Zm9vYg", "Zm9vYmE", "Zm9vYmFy"};
+    int result = 1;
+
+    for (size_t i = 0; i < sizeof data / sizeof *data; ++i) {
+        StringT *string = String_from(data[i]);
+        StringT *encoded = String_base64_encode(string, STRING_BASE64_DEFAULT);
+        StringT *bare = String_base64_encode(string, STRING_BASE64_NO_PADDING);
+        StringT *decoded = String_base64_decode(encoded, STRING_BASE64_DEFAULT);
+        StringT *lenient = String_base64_decode(bare, STRING_BASE64_LENIENT);
+
+        result &= String_eq(encoded, padded[i]) && String_eq(bare, unpadded[i]) &&
+                  encoded->allocated == encoded->length + 1 && decoded &&
+                  String_equals(decoded, string) && lenient &&
+                  String_equals(lenient, string);
+        STRING_FREE_MULTIPLE(string, encoded, bare, decoded, lenient);
+    }
+
+    log_result(__func__, result);
+}
+
+static void
+test_base64_alphabets() {
+    StringT *string = String_from("\xFB\xFF\xBF?");
+    int flags = STRING_BASE64_URL | STRING_BASE64_NO_PADDING;
+    StringT *standard = String_base64_encode(string, STRING_BASE64_DEFAULT);
+    StringT *url = String_base64_encode(string, flags);
+    StringT *decoded = String_base64_decode(url, flags);
+    StringT *output = String_from("data:");
+
+    String_base64_encode_into(output, string, STRING_BASE64_URL);
+
+    log_result(__func__, String_eq(standard, "+/+/Pw==") && String_eq(url, "-_-_Pw") &&
+                             decoded && String_equals(decoded, string) &&
+                             String_eq(output, "data:-_-_Pw=="));
+    STRING_FREE_MULTIPLE(string, standard, url, decoded, output);
+}
+
+static void
+test_base64_invalid() {
+    const char *strict[] = {"Zg",   "Zg=",  "Zh==", "Zm9=", "Z===", "Zm9vY",
+                            "Zm$v", "Zm9v\n", "Zg==Zg==", "-_8=", "Zm\xC3\xA9"};
+    const char *lenient[] = {"Zh==", "Zg", "Zg="};
+    StringT *output = String_from("kept");
+    int result = 1;
+
+    for (size_t i = 0; i < sizeof strict / sizeof *strict; ++i) {
+        StringT *bad = String_from(strict[i]);
+
+        result &= String_base64_decode(bad, STRING_BASE64_DEFAULT) == NULL;
+        result &= !String_base64_decode_into(output, bad, STRING_BASE64_DEFAULT);
+        String_free(bad);
+    }
+
+    // Lenient decoding accepts non-canonical bits but never a broken padding.
+    for (size_t i = 0; i < sizeof lenient / sizeof *lenient; ++i) {
+        StringT *string = String_from(lenient[i]);
+        StringT *decoded = String_base64_decode(string, STRING_BASE64_LENIENT);
+
+        result &= (decoded != NULL) == (i < 2);
+        if (decoded) String_free(decoded);
+        String_free(string);
+    }
+
+    {
+        StringT *padded = String_from("Zg==");
+
+        result &= String_base64_decode(padded, STRING_BASE64_NO_PADDING) == NULL;
+        String_free(padded);
+    }
+
+    log_result(__func__, result && String_eq(output, "kept"));
+    String_free(output);
+}
+
+static void
+test_base64_round_trip() {
+    char buffer[300];
+    int result = 1;
+
+    srand(17);
+    // Lengths cover the vectorised blocks and every remainder around them.
+    for (int round = 0; round < 3000; ++round) {
+        ssize_t length = rand() % sizeof buffer;
+        int flags = rand() % 4;
+        StringT string = {.string = buffer, .length = length};
+        StringT *encoded, *decoded;
+
+        for (ssize_t i = 0; i < length; ++i) {
+            buffer[i] = (char)(rand() % 256);
+        }
+
+        encoded = String_base64_encode(&string, flags);
+        decoded = String_base64_decode(encoded, flags);
+        result &= decoded && String_equals(decoded, &string);
+
+        // A single bad character anywhere is caught, in the blocks or in the tail.
+        if (encoded->length > 0) {
+            encoded->string[rand() % encoded->length] = '*';
+            result &= String_base64_decode(encoded, flags) == NULL;
+        }
+        STRING_FREE_MULTIPLE(encoded, decoded);
+    }
+
+    log_result(__func__, result);
+}
+
+static void
+test_hex() {
+    StringT *string = String_from("\x01\xAB\xFFHi.");
+    StringT *encoded = String_hex_encode(string);
+    StringT *upper = String_from("01ABFF48692E");
+    StringT *decoded = String_hex_decode(upper);
+    StringT *output = String_from("0x");
+    const char *invalid[] = {"0", "0g", "zz", "4869 2E"};
+    int result = String_eq(encoded, "01abff48692e") && decoded &&
+                 String_equals(decoded, string);
+
+    String_hex_encode_into(output, string);
+    result &= String_eq(output, "0x01abff48692e");
+    for (size_t i = 0; i < sizeof invalid / sizeof *invalid; ++i) {
+        StringT *bad = String_from(invalid[i]);
+
+        result &= String_hex_decode(bad) == NULL && !String_hex_decode_into(output, bad);
+        String_free(bad);
+    }
+
+    log_result(__func__, result && String_eq(output, "0x01abff48692e"));
+    STRING_FREE_MULTIPLE(string, encoded, upper, decoded, output);
+}
+
+static void
+test_hex_round_trip() {
+    char buffer[200];
+    int result = 1;
+
+    srand(19);
+    for (int round = 0; round < 2000; ++round) {
+        ssize_t length = rand() % sizeof buffer;
+        StringT string = {.string = buffer, .length = length};
+        StringT *encoded, *decoded;
+
+        for (ssize_t i = 0; i < length; ++i) {
+            buffer[i] = (char)(rand() % 256);
+        }
+
+        encoded = String_hex_encode(&string);
+        decoded = String_hex_decode(encoded);
+        result &= decoded && String_equals(decoded, &string);
+
+        if (encoded->length > 0) {
+            encoded->string[rand() % encoded->length] = 'g';
+            result &= String_hex_decode(encoded) == NULL;
+        }
+        STRING_FREE_MULTIPLE(encoded, decoded);
+    }
+
+    log_result(__func__, result);
+}
+
+int
+main() {
+    test_base64_rfc4648();
+    test_base64_alphabets();
+    test_base64_invalid();
+    test_base64_round_trip();
+    test_hex();
+    test_hex_round_trip();
+}
@@ -0,0 +1,154 @@
+/// Tests the searches for every occurrence of a pattern and their users.
+
+#include "string_ext.h"
+#include "string_utils.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/// Reference search, overlapping or not, storing the positions in `offsets`.
+static ssize_t
+naive_find_all(const char *text, ssize_t n, const char *pattern, ssize_t m,
+               bool overlapping, int64_t *offsets) {
+    ssize_t count = 0;
+
+    for (ssize_t i = 0; m > 0 && i + m <= n;) {
+        if (memcmp(text + i, pattern, m) == 0) {
+            offsets[count++] = i;
+            i += overlapping ? 1 : m;
+        } else {
+            i++;
+        }
+    }
+    return count;
+}
+
+static void
+test_find_all() {
+    StringT *string = String_from("aaaa"), *pattern = String_from("aa");
+    StringT *empty = String_from(""), *missing = String_from("b");
+    StringMatchesT *matches = String_find_all(string, pattern, STRING_FIND_DEFAULT);
+    StringMatchesT *overlapping =
+        String_find_all(string, pattern, STRING_FIND_OVERLAPPING);
+    StringMatchesT *none = String_find_all(string, empty, STRING_FIND_DEFAULT);
+    int64_t offsets[2];
+
+    int result = matches->length == 2 && matches->offsets[0] == 0 &&
+                 matches->offsets[1] == 2 && overlapping->length == 3 &&
+                 overlapping->offsets[2] == 2 && none->length == 0;
+
+    result &= String_find_all_into(string, pattern, STRING_FIND_OVERLAPPING, offsets,
+                                   2) == 3 &&
+              offsets[1] == 1 &&
+              String_find_all_into(string, missing, STRING_FIND_DEFAULT, NULL, 0) == 0 &&
+              String_count(string, pattern) == 2 && String_count(string, empty) == 0 &&
+              !String_contains(string, empty).stop;
+
+    log_result(__func__, result);
+    StringMatches_free(matches);
+    StringMatches_free(overlapping);
+    StringMatches_free(none);
+    STRING_FREE_MULTIPLE(string, pattern, empty, missing);
+}
+
+static void
+test_find_all_random() {
+    char text[400], pattern[6];
+    int64_t expected[400], offsets[400];
+    int result = 1;
+
+    srand(47);
+    for (int round = 0; round < 400; ++round) {
+        ssize_t n = rand() % sizeof text, m = 1 + rand() % sizeof pattern;
+        int alphabet = 1 + rand() % 3, flags = round % 2 ? STRING_FIND_OVERLAPPING : 0;
+        StringT string = {.string = text, .length = n};
+        StringT needle = {.string = pattern, .length = m};
+        StringMatchesT *matches;
+        ssize_t count;
+
+        // High bytes too, to check the shift table covers every byte value.
+        for (ssize_t i = 0; i < n; ++i) text[i] = (char)(0xFD + rand() % alphabet);
+        for (ssize_t i = 0; i < m; ++i) pattern[i] = (char)(0xFD + rand() % alphabet);
+
+        count = naive_find_all(text, n, pattern, m, flags, expected);
+        matches = String_find_all(&string, &needle, flags);
+        result &= matches->length == count &&
+                  String_find_all_into(&string, &needle, flags, offsets, 400) == count;
+        if (count > 0) {
+            result &= memcmp(matches->offsets, expected, count * sizeof *expected) == 0 &&
+                      memcmp(offsets, expected, count * sizeof *expected) == 0;
+        }
+        if (!flags) result &= String_count(&string, &needle) == count;
+        StringMatches_free(matches);
+    }
+
+    log_result(__func__, result);
+}
+
+static void
+test_split_replace() {
+    StringT *string = String_from("a--b----c--"), *dashes = String_from("--");
+    StringT *plus = String_from("+"), *empty = String_from("");
+    StringIteratorT *parts = String_split(string, dashes);
+    StringIteratorT *limited = String_split_limit(string, dashes, 2);
+    StringIteratorT *whole = String_split(string, empty);
+    StringArrayT *array = String_split_array_limit(string, dashes, 1);
+    StringT *replaced = String_replace(string, dashes, plus);
+    StringT *grown = String_replace(plus, plus, dashes);
+    StringT *copied = String_replace(string, empty, plus);
+    StringT second = StringArray_get(array, 1);
+    int result;
+
+    result = parts->length == 5 && String_eq(parts->strings[0], "a") &&
+             String_eq(parts->strings[2], "") && String_eq(parts->strings[4], "") &&
+             limited->length == 3 && String_eq(limited->strings[2], "--c--") &&
+             whole->length == 1 && String_eq(whole->strings[0], "a--b----c--") &&
+             array->length == 2 && String_eq(&second, "b----c--");
+    result &= String_eq(replaced, "a+b++c+") && String_eq(grown, "--") &&
+              String_eq(copied, "a--b----c--") && replaced->string[replaced->length] == 0;
+
+    log_result(__func__, result);
+    for (ssize_t i = 0; i < parts->length; ++i) String_free((StringT *)parts->strings[i]);
+    for (ssize_t i = 0; i < limited->length; ++i) {
+        String_free((StringT *)limited->strings[i]);
+    }
+    String_free((StringT *)whole->strings[0]);
+    StringIterator_free(parts);
+    StringIterator_free(limited);
+    StringIterator_free(whole);
+    StringArray_free(array);
+    STRING_FREE_MULTIPLE(string, dashes, plus, empty, replaced, grown, copied);
+}
+
+static void
+test_right_split() {
+    StringT *string = String_from("foo bar, spam,, eggs"), *comma = String_from(", ");
+    StringT *single = String_from(",");
+    StringIteratorT *parts = String_right_split(string, comma);
+    StringIteratorT *limited = String_right_split_limit(string, single, 2);
+    int result;
+
+    result = parts->length == 3 && String_eq(parts->strings[0], "eggs") &&
+             String_eq(parts->strings[1], "spam,") &&
+             String_eq(parts->strings[2], "foo bar") && limited->length == 3 &&
+             String_eq(limited->strings[0], " eggs") &&
+             String_eq(limited->strings[1], "") &&
+             String_eq(limited->strings[2], "foo bar, spam");
+
+    log_result(__func__, result);
+    for (ssize_t i = 0; i < parts->length; ++i) String_free((StringT *)parts->strings[i]);
+    for (ssize_t i = 0; i < limited->length; ++i) {
+        String_free((StringT *)limited->strings[i]);
+    }
+    StringIterator_free(parts);
+    StringIterator_free(limited);
+    STRING_FREE_MULTIPLE(string, comma, single);
+}
+
+int
+main() {
+    test_find_all();
+    test_find_all_random();
+    test_split_replace();
+    test_right_split();
+}
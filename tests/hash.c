@@ -0,0 +1,72 @@
+/// Tests the hash functions of `StringT`.
+
+#include "string_ext.h"
+#include "string_utils.h"
+
+static void
+test_hash() {
+    StringT *str1 = String_from("Hello, World");
+    StringT *str2 = String_from("Hello, World");
+    StringT *str3 = String_from("Hello, World!");
+    StringT *empty = String_from("");
+
+    log_result(__func__, String_hash(str1) == String_hash(str2) &&
+                             String_hash(str1) != String_hash(str3) &&
+                             String_hash(empty) != 0);
+    STRING_FREE_MULTIPLE(str1, str2, str3, empty);
+}
+
+static void
+test_hash_seeded() {
+    StringT *str = String_from("Hello, World");
+
+    log_result(__func__, String_hash_seeded(str, 1) != String_hash_seeded(str, 2) &&
+                             String_hash_seeded(str, 0) == String_hash(str) &&
+                             String_hash_char_array("Hello, World", 12, 7) ==
+                                 String_hash_seeded(str, 7));
+    STRING_FREE_MULTIPLE(str);
+}
+
+static void
+test_hash_icase() {
+    const char *upper = "THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG, 0123456789 TIMES";
+    const char *lower = "the quick brown fox jumps over the lazy dog, 0123456789 times";
+    int result = 1;
+
+    // Every length exercises a different read path of the kernel.
+    for (int length = 0; length <= 61; ++length) {
+        StringT upper_view = {.string = (char *)upper, .length = length};
+        StringT lower_view = {.string = (char *)lower, .length = length};
+
+        result &= String_hash_icase(&upper_view) == String_hash_icase(&lower_view);
+        result &= String_hash_icase(&lower_view) == String_hash(&lower_view);
+        if (length > 0) {
+            result &= String_hash(&upper_view) != String_hash(&lower_view);
+        }
+    }
+
+    log_result(__func__, result);
+}
+
+static void
+test_hash_cached() {
+    StringT *str = String_from("Hello");
+    StringT *suffix = String_from(", World");
+    uint64_t before = String_hash_cached(str);
+    int result = before == String_hash(str) && str->hash == before;
+
+    String_concatenate_inplace(str, suffix);
+    result &= str->hash == 0 && String_hash_cached(str) == String_hash(str) &&
+              String_hash_cached(str) != before;
+
+    log_result(__func__, result);
+    STRING_FREE_MULTIPLE(str, suffix);
+}
+
+int
+main() {
+    test_hash();
+    test_hash_seeded();
+    test_hash_icase();
+    test_hash_cached();
+}
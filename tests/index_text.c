@@ -0,0 +1,121 @@
+/// Tests the suffix array index `StringIndexTextT`.
+
+#include "string_index_text.h"
+#include "string_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/// Reference count of the overlapping occurrences, with the first of them.
+static ssize_t
+naive_count(const char *text, ssize_t n, const char *pattern, ssize_t m, ssize_t *first) {
+    ssize_t count = 0;
+
+    *first = -1;
+    for (ssize_t i = 0; m > 0 && i + m <= n; ++i) {
+        if (memcmp(text + i, pattern, m) == 0) {
+            if (count++ == 0) *first = i;
+        }
+    }
+    return count;
+}
+
+static void
+test_index_text() {
+    StringT *corpus = String_from("abracadabra"), *abra = String_from("abra");
+    StringT *a = String_from("a"), *missing = String_from("abrac_");
+    StringT *empty = String_from("");
+    StringT *whole = String_from("abracadabra"), *longer = String_from("abracadabrab");
+    StringIndexTextT *index = StringIndexText_new(corpus);
+    ssize_t positions[4];
+
+    log_result(__func__, StringIndexText_count(index, abra) == 2 &&
+                             StringIndexText_contains(index, whole) &&
+                             !StringIndexText_contains(index, longer) &&
+                             !StringIndexText_contains(index, missing) &&
+                             StringIndexText_count(index, empty) == 0 &&
+                             StringIndexText_locate(index, a, positions, 4) == 5 &&
+                             positions[0] == 0 && positions[1] == 3 &&
+                             positions[2] == 5 && positions[3] == 7);
+    StringIndexText_free(index);
+    STRING_FREE_MULTIPLE(corpus, abra, a, missing, empty, whole, longer);
+}
+
+static void
+test_index_text_random() {
+    char text[2000], pattern[12];
+    ssize_t positions[2000];
+    int result = 1;
+
+    srand(41);
+    // Small alphabets give long repeats, the hard case of the construction.
+    for (int round = 0; round < 60; ++round) {
+        ssize_t n = rand() % sizeof text;
+        int alphabet = 1 + rand() % 4;
+        StringT string = {.string = text, .length = n};
+        StringIndexTextT *index;
+
+        for (ssize_t i = 0; i < n; ++i) text[i] = 'a' + rand() % alphabet;
+        index = StringIndexText_new(&string);
+
+        for (int query = 0; query < 40; ++query) {
+            ssize_t m = 1 + rand() % sizeof pattern, first, expected;
+            StringT needle = {.string = pattern, .length = m};
+
+            if (n > m && rand() % 2) {
+                memcpy(pattern, text + rand() % (n - m), m);
+            } else {
+                for (ssize_t i = 0; i < m; ++i) pattern[i] = 'a' + rand() % alphabet;
+            }
+
+            expected = naive_count(text, n, pattern, m, &first);
+            result &= StringIndexText_count(index, &needle) == expected &&
+                      StringIndexText_locate(index, &needle, positions, n) == expected &&
+                      (expected == 0 || positions[0] == first);
+        }
+        StringIndexText_free(index);
+    }
+
+    log_result(__func__, result);
+}
+
+static void
+test_index_text_save_load() {
+    char path[] = "/tmp/string_index_text_XXXXXX";
+    StringT *corpus = String_from("the quick brown fox jumps over the lazy dog, the end");
+    StringT *the = String_from("the "), *fox = String_from("fox");
+    StringIndexTextT *index = StringIndexText_new(corpus), *loaded;
+    ssize_t positions[3];
+    int fd = mkstemp(path), result;
+    FILE *file;
+
+    close(fd);
+    result = StringIndexText_save(index, path);
+    loaded = StringIndexText_load(path);
+    result &= loaded != NULL && StringIndexText_count(loaded, the) == 3 &&
+              StringIndexText_locate(loaded, fox, positions, 3) == 1 &&
+              positions[0] == 16 &&
+              StringIndexText_text(loaded).length == corpus->length;
+    if (loaded) StringIndexText_free(loaded);
+
+    // A truncated file is rejected.
+    file = fopen(path, "r+b");
+    result &= ftruncate(fileno(file), 40) == 0;
+    fclose(file);
+    result &= StringIndexText_load(path) == NULL &&
+              StringIndexText_load("/nonexistent/index") == NULL;
+
+    log_result(__func__, result);
+    unlink(path);
+    StringIndexText_free(index);
+    STRING_FREE_MULTIPLE(corpus, the, fox);
+}
+
+int
+main() {
+    test_index_text();
+    test_index_text_random();
+    test_index_text_save_load();
+}
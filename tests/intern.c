@@ -0,0 +1,118 @@
+/// Tests the thread-safe `StringInternPoolT`.
+
+#include "string_ext.h"
+#include "string_intern.h"
+#include "string_utils.h"
+
+#include <pthread.h>
+#include <stdio.h>
+
+#define THREADS 4
+#define WORDS 5000
+
+static void
+test_intern() {
+    StringInternPoolT *pool = StringInternPool_new();
+    StringT *foo1 = String_from("foo");
+    StringT *foo2 = String_from("foo");
+    StringT *bar = String_from("bar");
+    uint32_t id1, id2, id3;
+    const StringT *a = StringInternPool_intern(pool, foo1, &id1);
+    const StringT *b = StringInternPool_intern(pool, foo2, &id2);
+    const StringT *c = StringInternPool_intern(pool, bar, &id3);
+
+    log_result(__func__, a == b && id1 == id2 && a != c && id1 != id3 &&
+                             a->string != foo1->string && String_equals(a, foo1) &&
+                             a->hash == String_hash(foo1) &&
+                             StringInternPool_len(pool) == 2);
+    STRING_FREE_MULTIPLE(foo1, foo2, bar);
+    StringInternPool_free(pool);
+}
+
+static void
+test_intern_ids() {
+    StringInternPoolT *pool = StringInternPool_new();
+    char buffer[32];
+    uint32_t ids[WORDS];
+    int result = 1;
+
+    for (int i = 0; i < WORDS; ++i) {
+        int length = sprintf(buffer, "word-%d", i);
+        StringInternPool_intern_char_array(pool, buffer, length, &ids[i]);
+    }
+    for (int i = 0; i < WORDS; ++i) {
+        int length = sprintf(buffer, "word-%d", i);
+        const StringT *canonical = StringInternPool_get(pool, ids[i]);
+
+        result &= canonical->length == length && string_equals(canonical->string, buffer) &&
+                  StringInternPool_id(canonical) == ids[i];
+    }
+
+    log_result(__func__, result && StringInternPool_len(pool) == WORDS);
+    StringInternPool_free(pool);
+}
+
+static void
+test_intern_find() {
+    StringInternPoolT *pool = StringInternPool_new();
+    StringT *foo = String_from("foo");
+    StringT *bar = String_from("bar");
+    uint32_t id1, id2 = 0;
+    const StringT *canonical = StringInternPool_intern(pool, foo, &id1);
+
+    log_result(__func__, StringInternPool_find(pool, foo, &id2) == canonical && id1 == id2 &&
+                             StringInternPool_find(pool, bar, NULL) == NULL &&
+                             StringInternPool_len(pool) == 1);
+    STRING_FREE_MULTIPLE(foo, bar);
+    StringInternPool_free(pool);
+}
+
+typedef struct {
+    StringInternPoolT *pool;
+    uint32_t ids[WORDS];
+} InternThreadT;
+
+static void *
+_intern_words(void *argument) {
+    InternThreadT *context = argument;
+    char buffer[32];
+
+    for (int i = 0; i < WORDS; ++i) {
+        int length = sprintf(buffer, "word-%d", i);
+        StringInternPool_intern_char_array(context->pool, buffer, length, &context->ids[i]);
+    }
+
+    return NULL;
+}
+
+static void
+test_intern_threads() {
+    static InternThreadT contexts[THREADS];
+    StringInternPoolT *pool = StringInternPool_new();
+    pthread_t threads[THREADS];
+    int result = 1;
+
+    for (int t = 0; t < THREADS; ++t) {
+        contexts[t].pool = pool;
+        pthread_create(&threads[t], NULL, _intern_words, &contexts[t]);
+    }
+    for (int t = 0; t < THREADS; ++t) {
+        pthread_join(threads[t], NULL);
+    }
+    for (int i = 0; i < WORDS; ++i) {
+        for (int t = 1; t < THREADS; ++t) {
+            result &= contexts[t].ids[i] == contexts[0].ids[i];
+        }
+    }
+
+    log_result(__func__, result && StringInternPool_len(pool) == WORDS);
+    StringInternPool_free(pool);
+}
+
+int
+main() {
+    test_intern();
+    test_intern_ids();
+    test_intern_find();
+    test_intern_threads();
+}
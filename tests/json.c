@@ -0,0 +1,76 @@
+/// Tests the JSON escaping and unescaping of `StringT`.
+
+#include "string_ext.h"
+#include "string_utils.h"
+
+#include <stdlib.h>
+
+static void
+test_json_escape() {
+    StringT *string =
+        String_from("say \"hi\"\\ to\tthe\nworld\x01 café, a long clean run");
+    StringT *escaped = String_json_escape(string);
+    StringT *output = String_from("{\"key\": \"");
+
+    String_json_escape_into(output, string);
+
+    log_result(__func__,
+               String_eq(escaped, "say \\\"hi\\\"\\\\ to\\tthe\\nworld\\u0001 "
+                                  "café, a long clean run") &&
+                   escaped->allocated == escaped->length + 1 &&
+                   String_eq(output, "{\"key\": \"say \\\"hi\\\"\\\\ to\\tthe"
+                                     "\\nworld\\u0001 café, a long clean run"));
+    STRING_FREE_MULTIPLE(string, escaped, output);
+}
+
+static void
+test_json_unescape() {
+    StringT *string =
+        String_from("caf\\u00E9 \\ud83d\\ude00 \\\"q\\\" \\/ \\b\\f\\n\\r\\t");
+    StringT *unescaped = String_json_unescape(string);
+    const char *invalid[] = {"\\x",     "\\u12",         "\\ud83d",
+                             "\\ude00", "\\ud83d\\u0041", "end\\"};
+    int result = String_eq(unescaped, "café 😀 \"q\" / \b\f\n\r\t");
+
+    for (size_t i = 0; i < sizeof invalid / sizeof *invalid; ++i) {
+        StringT *bad = String_from(invalid[i]);
+
+        result &= String_json_unescape(bad) == NULL;
+        String_free(bad);
+    }
+
+    log_result(__func__, result);
+    STRING_FREE_MULTIPLE(string, unescaped);
+}
+
+static void
+test_json_round_trip() {
+    char buffer[200];
+    int result = 1;
+
+    srand(5);
+    for (int round = 0; round < 2000; ++round) {
+        ssize_t length = rand() % sizeof buffer;
+        StringT string = {.string = buffer, .length = length};
+        StringT *escaped, *unescaped;
+
+        for (ssize_t i = 0; i < length; ++i) {
+            // Mostly clean text with a few bytes to escape.
+            buffer[i] = rand() % 8 ? 'a' + rand() % 26 : (char)(rand() % 256);
+        }
+
+        escaped = String_json_escape(&string);
+        unescaped = String_json_unescape(escaped);
+        result &= unescaped && String_equals(unescaped, &string);
+        STRING_FREE_MULTIPLE(escaped, unescaped);
+    }
+
+    log_result(__func__, result);
+}
+
+int
+main() {
+    test_json_escape();
+    test_json_unescape();
+    test_json_round_trip();
+}
@@ -0,0 +1,158 @@
+/// Tests strings and indices past 2 GB, where 32 bit indices would overflow.
+///
+/// The inputs take gigabytes, so they are only tested when ``STRING_TEST_LARGE_GB`` is
+/// set to their size in GB (4 to 16 is the intended tier). ``STRING_TEST_LARGE_FILE``
+/// can name a file to map instead, such as merged logs; its size is used then. The
+/// throughput of the scans is printed as a benchmark.
+
+#define _GNU_SOURCE
+
+#include "string_char_class.h"
+#include "string_ext.h"
+#include "string_utils.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define GB (1ll << 30)
+
+static double
+seconds() {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static void
+bench(const char *name, ssize_t bytes, double start) {
+    fprintf(stdout, "[BENCH]: %s %.2f GB/s\n", name, bytes / (seconds() - start) / GB);
+}
+
+static void
+test_index_64bit() {
+    StringIndexT index = StringIndex(3000000000ll, 5000000000ll, 2);
+    StringIndexT stop = StringIndex(-3000000000ll);
+    StringT *string = String_from("Hello, World");
+    StringT *world = String_from("World");
+    StringIndexT found =
+        String_contains_in_range(string, world, StringIndex(5000000000ll));
+
+    // Small literals are converted too, the macro used to read them as varargs.
+    log_result(__func__, index.start == 3000000000ll && index.stop == 5000000000ll &&
+                             index.step == 2 && stop.start == 0 &&
+                             stop.stop == -3000000000ll && found.start == 7 &&
+                             StringIndex(0, 5).stop == 5);
+    STRING_FREE_MULTIPLE(string, world);
+}
+
+/// Reference count of the non-overlapping occurrences, with ``memmem``.
+static ssize_t
+naive_count(const StringT *text, const StringT *pattern) {
+    const char *cursor = text->string, *end = text->string + text->length;
+    ssize_t count = 0;
+
+    while ((cursor = memmem(cursor, end - cursor, pattern->string, pattern->length))) {
+        cursor += pattern->length;
+        count++;
+    }
+    return count;
+}
+
+/// Checks with needles planted past 2 GB and at the end of generated input.
+static void
+test_large_needles(StringT *text) {
+    const ssize_t beyond = (1ll << 31) + 7;
+    StringT *needle = String_from("NEEDLE"), *characters = String_from("#");
+    StringCharClassT *hash = StringCharClass_new(characters);
+    StringT *slice, *tail;
+    StringIndexT found;
+    int64_t offsets[4];
+    int result;
+
+    memcpy(text->string + beyond, "NEEDLE", 6);
+    memcpy(text->string + text->length - 6, "NEEDLE", 6);
+    text->string[beyond + 100] = '#';
+
+    found = String_contains_in_range(text, needle, StringIndex(1ll << 31, text->length));
+    slice = String_slice(text, StringIndex(beyond, beyond + 6));
+    tail = String_slice(text, StringIndex(-6, text->length));
+    result = found.start == beyond && found.stop == beyond + 6 &&
+             String_eq(slice, "NEEDLE") && String_eq(tail, "NEEDLE") &&
+             String_find_all_into(text, needle, STRING_FIND_DEFAULT, offsets, 4) == 2 &&
+             offsets[0] == beyond && offsets[1] == text->length - 6 &&
+             StringCharClass_find_first(hash, text, 1ll << 31) == beyond + 100;
+
+    log_result(__func__, result);
+    StringCharClass_free(hash);
+    STRING_FREE_MULTIPLE(needle, characters, slice, tail);
+}
+
+static void
+test_large_count(const StringT *text) {
+    StringT *newline = String_from("\n");
+    ssize_t expected, count;
+    double start = seconds();
+
+    count = String_count(text, newline);
+    bench("String_count", text->length, start);
+
+    start = seconds();
+    expected = naive_count(text, newline);
+    bench("memmem", text->length, start);
+
+    log_result(__func__, count == expected);
+    String_free(newline);
+}
+
+int
+main() {
+    const char *size = getenv("STRING_TEST_LARGE_GB");
+    const char *path = getenv("STRING_TEST_LARGE_FILE");
+    StringT text;
+
+    test_index_64bit();
+
+    if (path != NULL) {
+        struct stat status;
+        int fd = open(path, O_RDONLY);
+
+        if (fd < 0 || fstat(fd, &status) < 0) {
+            log_result("test_large_file", 0);
+            return 1;
+        }
+        text = (StringT){.length = status.st_size};
+        text.string = mmap(NULL, text.length, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (text.string == MAP_FAILED) {
+            log_result("test_large_file", 0);
+            return 1;
+        }
+        test_large_count(&text);
+    } else if (size != NULL) {
+        text = (StringT){.length = atoll(size) * GB};
+        text.string = mmap(NULL, text.length, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (text.length <= (1ll << 31) + 200 || text.string == MAP_FAILED) {
+            log_result("test_large_input", 0);
+            return 1;
+        }
+        // Lines of 64 bytes, like a log.
+        for (ssize_t i = 0; i < text.length; i += 64) {
+            memset(text.string + i, 'x', text.length - i < 63 ? text.length - i : 63);
+            if (i + 63 < text.length) text.string[i + 63] = '\n';
+        }
+        test_large_needles(&text);
+        test_large_count(&text);
+    } else {
+        return 0;
+    }
+
+    munmap(text.string, text.length);
+}
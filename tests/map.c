@@ -0,0 +1,133 @@
+/// Tests the open addressing `StringMapT`.
+
+#include "string_ext.h"
+#include "string_map.h"
+#include "string_utils.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static void
+test_map_set_get() {
+    StringMapT *map = StringMap_new(0);
+    StringT *foo = String_from("foo");
+    StringT *bar = String_from("bar");
+    StringT *spam = String_from("spam");
+    int value1, value2;
+
+    StringMap_set(map, foo, &value1);
+    StringMap_set(map, bar, &value2);
+    StringMap_set(map, foo, &value2);
+
+    log_result(__func__, StringMap_len(map) == 2 && StringMap_get(map, foo) == &value2 &&
+                             StringMap_get(map, bar) == &value2 &&
+                             StringMap_get(map, spam) == NULL);
+    STRING_FREE_MULTIPLE(foo, bar, spam);
+    StringMap_free(map);
+}
+
+static void
+test_map_char_array_lookup() {
+    StringMapT *map = StringMap_new(4);
+    StringT *key = String_from("Content-Type");
+    StringMapEntryT *entry;
+
+    String_hash_cached(key);
+    StringMap_set_int(map, key, 42);
+    entry = StringMap_find_char_array(map, "Content-Type: text/plain", 12);
+
+    log_result(__func__, entry && entry->value.integer == 42 && entry->length == 12 &&
+                             string_equals(entry->key, "Content-Type") &&
+                             !StringMap_find_char_array(map, "Content", 7));
+    STRING_FREE_MULTIPLE(key);
+    StringMap_free(map);
+}
+
+static void
+test_map_grow_and_remove() {
+    StringMapT *map = StringMap_new(0);
+    char buffer[32];
+    int result = 1;
+
+    for (int i = 0; i < 10000; ++i) {
+        int length = sprintf(buffer, "key-%d", i);
+        StringMap_increment_char_array(map, buffer, length, i);
+    }
+    for (int i = 0; i < 10000; i += 2) {
+        int length = sprintf(buffer, "key-%d", i);
+        result &= StringMap_remove_char_array(map, buffer, length);
+    }
+    for (int i = 0; i < 10000; ++i) {
+        int length = sprintf(buffer, "key-%d", i);
+        StringMapEntryT *entry = StringMap_find_char_array(map, buffer, length);
+
+        result &= (i % 2) ? entry && entry->value.integer == i : entry == NULL;
+    }
+
+    log_result(__func__, result && StringMap_len(map) == 5000);
+    StringMap_free(map);
+}
+
+/// Removing and inserting keys with a constant number of them must not grow the map.
+static void
+test_map_churn_memory() {
+    StringMapT *map = StringMap_new(0);
+    char buffer[32];
+    ssize_t warm = 0;
+    int result = 1;
+
+    for (int i = 0; i < 300000; ++i) {
+        int length = sprintf(buffer, "churn-key-%d", i);
+
+        StringMap_increment_char_array(map, buffer, length, i);
+        if (i >= 1000) {
+            length = sprintf(buffer, "churn-key-%d", i - 1000);
+            result &= StringMap_remove_char_array(map, buffer, length);
+        }
+        if (i == 30000) warm = StringMap_memory(map);
+    }
+    for (int i = 299000; i < 300000; ++i) {
+        int length = sprintf(buffer, "churn-key-%d", i);
+        StringMapEntryT *entry = StringMap_find_char_array(map, buffer, length);
+
+        result &= entry && entry->value.integer == i && !strcmp(entry->key, buffer);
+    }
+
+    log_result(__func__, result && StringMap_len(map) == 1000 &&
+                             StringMap_memory(map) <= 2 * warm);
+    StringMap_free(map);
+}
+
+static void
+test_map_count_tokens() {
+    StringT *text = String_from("a b a c b a");
+    StringT *space = String_from(" ");
+    StringArrayT *tokens = String_split_array(text, space);
+    StringMapT *counts = StringMap_new(0);
+    StringMapEntryT *entry;
+    ssize_t cursor = 0, total = 0, distinct = 0;
+
+    for (ssize_t i = 0; i < tokens->length; ++i) {
+        StringT token = StringArray_get(tokens, i);
+        StringMap_increment(counts, &token, 1);
+    }
+    while ((entry = StringMap_next(counts, &cursor))) {
+        total += entry->value.integer;
+        distinct++;
+    }
+
+    log_result(__func__, total == 6 && distinct == 3 &&
+                             StringMap_increment_char_array(counts, "a", 1, 0) == 3);
+    STRING_FREE_MULTIPLE(text, space);
+    StringArray_free(tokens);
+    StringMap_free(counts);
+}
+
+int
+main() {
+    test_map_set_get();
+    test_map_char_array_lookup();
+    test_map_grow_and_remove();
+    test_map_churn_memory();
+    test_map_count_tokens();
+}
@@ -2,6 +2,8 @@
 #include "string_utils.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 static void
 test_copy() {
@@ -43,6 +45,42 @@ test_equals() {
     STRING_FREE_MULTIPLE(str1, str2);
 }
 
+static void
+test_equals_length() {
+    StringT *str1 = String_from("Hello");
+    StringT *str2 = String_from("Hello, World");
+
+    log_result(__func__, !String_equals(str1, str2) && !String_equals(str2, str1) &&
+                             !String_eq(str1, "Hello, World") &&
+                             !String_eq(str2, "Hello") &&
+                             !String_starts_with(str1, str2) &&
+                             !String_ends_with(str1, str2));
+    STRING_FREE_MULTIPLE(str1, str2);
+}
+
+static void
+test_compare_mismatch() {
+    // Long enough for the 32 byte blocks, the strings differ in the 16 byte tail.
+    StringT *str1 = String_from("the quick brown fox jumps over the lazy dog, "
+                                "the quick brown fox jumps over the lazy dog");
+    StringT *str2 = String_from("the quick brown fox jumps over the lazy dog, "
+                                "the quick brown fox jumps over the lazy cat");
+    StringT *str3 = String_from("the quick brown fox");
+    StringT *str4 = String_from("the quick brown fox jumps over the lazy dog, "
+                                "the quick brown fox jumps over the lazy dog");
+
+    log_result(__func__, String_mismatch(str1, str2) == 85 &&
+                             String_mismatch(str1, str3) == 19 &&
+                             String_mismatch(str1, str4) == -1 &&
+                             String_common_prefix_length(str1, str2) == 85 &&
+                             String_common_prefix_length(str1, str4) == str1->length &&
+                             String_compare(str1, str2) > 0 &&
+                             String_compare(str3, str1) < 0 &&
+                             String_compare(str1, str4) == 0 &&
+                             String_equals(str1, str4) && !String_equals(str1, str2));
+    STRING_FREE_MULTIPLE(str1, str2, str3, str4);
+}
+
 static void
 test_ends_with() {
     StringT *str1 = String_from("Hello, World");
@@ -64,6 +102,78 @@ test_starts_with() {
     STRING_FREE_MULTIPLE(str1, str2, str3);
 }
 
+static void
+test_equals_icase() {
+    StringT *str1 = String_from("Content-Type: TEXT/html; charset=UTF-8");
+    StringT *str2 = String_from("content-type: text/HTML; Charset=utf-8");
+    StringT *str3 = String_from("content-type: text/HTML; Charset=utf-9");
+
+    log_result(__func__,
+               String_equals_icase(str1, str2) && !String_equals_icase(str1, str3));
+    STRING_FREE_MULTIPLE(str1, str2, str3);
+}
+
+static void
+test_starts_ends_with_icase() {
+    StringT *str1 = String_from("WWW.Example.COM");
+    StringT *str2 = String_from("www.");
+    StringT *str3 = String_from(".example.com");
+    StringT *str4 = String_from("a.WWW.Example.COM");
+
+    log_result(__func__, String_starts_with_icase(str1, str2) &&
+                             String_ends_with_icase(str1, str3) &&
+                             !String_starts_with_icase(str1, str3) &&
+                             !String_ends_with_icase(str1, str4));
+    STRING_FREE_MULTIPLE(str1, str2, str3, str4);
+}
+
+static void
+test_contains_icase() {
+    StringT *str1 = String_from("Accept-Encoding: GZIP, deflate, BR");
+    StringT *str2 = String_from("gzip");
+    StringT *str3 = String_from("Br");
+    StringT *str4 = String_from("zstd");
+    StringT *empty = String_from("");
+
+    log_result(__func__,
+               string_index_equal(String_contains_icase(str1, str2),
+                                  StringIndex(17, 21)) &&
+                   string_index_equal(String_contains_icase(str1, str3),
+                                      StringIndex(32, 34)) &&
+                   string_index_equal(String_contains_icase(str1, str4),
+                                      StringIndex(0, 0, 1)) &&
+                   string_index_equal(String_contains_icase(str1, empty),
+                                      StringIndex(0, 0, 1)) &&
+                   string_index_equal(String_contains_icase_in_range(
+                                          str1, str2, StringIndex(18, 34)),
+                                      StringIndex(0, 0, 1)));
+    STRING_FREE_MULTIPLE(str1, str2, str3, str4, empty);
+}
+
+static void
+test_contains_icase_range() {
+    StringT *str1 = String_from("xxABxx");
+    StringT *str2 = String_from("zz");
+    StringT *str3 = String_from("ab");
+    StringT *str4 = String_from("B");
+
+    // Out of range starts are clamped like in `String_contains_in_range`.
+    log_result(__func__,
+               string_index_equal(String_contains_icase_in_range(
+                                      str1, str2, StringIndex(-64, 6)),
+                                  StringIndex(0, 0, 1)) &&
+                   string_index_equal(String_contains_icase_in_range(
+                                          str1, str3, StringIndex(-64, 6)),
+                                      StringIndex(2, 4)) &&
+                   string_index_equal(String_contains_icase_in_range(
+                                          str1, str3, StringIndex(64, 128)),
+                                      StringIndex(0, 0, 1)) &&
+                   string_index_equal(String_contains_icase_in_range(
+                                          str1, str4, StringIndex(-1, 100)),
+                                      StringIndex(3, 4)));
+    STRING_FREE_MULTIPLE(str1, str2, str3, str4);
+}
+
 static void
 test_is_alphanumeric() {
     StringT *str1 = String_from("Hello 123");
@@ -172,6 +282,37 @@ test_contains_in_range() {
     STRING_FREE_MULTIPLE(str1, str2, str3);
 }
 
+static void
+test_find_from_char_class() {
+    StringT *str1 = String_from("Hello, World!");
+    StringT *str2 = String_from("Wd");
+
+    StringIndexT found = String_find_from_char_class(str1, str2);
+    StringIndexT in_range = String_find_from_char_class_in_range(str1, str2,
+                                                                 StringIndex(8, 13));
+    StringIndexT not_found = String_find_from_char_class_in_range(str1, str2,
+                                                                  StringIndex(0, 5));
+
+    log_result(__func__, string_index_equal(found, StringIndex(7, 8, 1)) &&
+                             string_index_equal(in_range, StringIndex(11, 12, 1)) &&
+                             string_index_equal(not_found, StringIndex(0, 0, 1)));
+    STRING_FREE_MULTIPLE(str1, str2);
+}
+
+static void
+test_split_whitespace_limit() {
+    StringT *str = String_from("  foo bar\nfoobar\tbar foo ");
+    StringIteratorT *all = String_split_whitespace(str);
+    StringIteratorT *limited = String_split_whitespace_limit(str, 1);
+
+    log_result(__func__, all->length == 5 && String_eq(all->strings[4], "foo") &&
+                             limited->length == 2 &&
+                             String_eq(limited->strings[0], "foo") &&
+                             String_eq(limited->strings[1], "bar\nfoobar\tbar foo "));
+    STRING_FREE_MULTIPLE(str);
+    STRING_ITERATOR__FREE_MULTIPLE(all, limited);
+}
+
 static void
 test_reverse() {
     StringT *str = String_from("Hello, World!");
@@ -204,9 +345,50 @@ test_slice() {
     StringIndexT idx = StringIndex(4);
     StringT *slice = String_slice(str, idx);
     StringT *slice_expected = String_from("foo ");
+    StringT *hello = String_from("Hello, World!"), *empty = String_from("");
+    StringT *world = String_slice(hello, StringIndex(7, -1));
+    StringT *every_other = String_slice(hello, StringIndex(0, -1, 2));
+    StringT *backwards = String_slice(hello, StringIndex(-2, 6, -2));
+    StringT *clamped = String_slice(hello, StringIndex(-6, 100));
+    StringT *reversed_empty = String_reverse(empty);
+
+    log_result(__func__, string_t_equals(slice, slice_expected) &&
+                             String_eq(world, "World!") &&
+                             String_eq(every_other, "Hlo ol!") &&
+                             String_eq(backwards, "drW") &&
+                             String_eq(clamped, "World!") &&
+                             reversed_empty->length == 0 &&
+                             world->string[world->length] == '\0');
+    STRING_FREE_MULTIPLE(str, slice, slice_expected, hello, empty, world, every_other,
+                         backwards, clamped, reversed_empty);
+}
 
-    log_result(__func__, string_t_equals(slice, slice_expected));
-    STRING_FREE_MULTIPLE(str, slice, slice_expected);
+static void
+test_slice_random() {
+    char buffer[700], expected[700];
+    int result = 1;
+
+    srand(53);
+    // Long enough for the vector paths, with every small step and some large ones.
+    for (int round = 0; round < 2000; ++round) {
+        ssize_t length = rand() % sizeof buffer, step = 1 + rand() % 20, count = 0;
+        ssize_t start = length ? rand() % length : 0, stop = rand() % (length + 1);
+        StringT string = {.string = buffer, .length = length};
+        StringT *slice;
+
+        if (rand() % 2) step = -step;
+        for (ssize_t i = 0; i < length; ++i) buffer[i] = (char)(rand() % 256);
+        for (ssize_t i = start; step > 0 ? i < stop : i > stop; i += step) {
+            expected[count++] = buffer[i];
+        }
+
+        slice = String_slice(&string, StringIndex(start, stop, step));
+        result &= slice->length == count && memcmp(slice->string, expected, count) == 0 &&
+                  slice->string[count] == '\0';
+        String_free(slice);
+    }
+
+    log_result(__func__, result);
 }
 
 static void
@@ -318,8 +500,14 @@ main() {
     test_concatenate();
     test_concatenate_inplace();
     test_equals();
+    test_equals_length();
+    test_compare_mismatch();
     test_ends_with();
     test_starts_with();
+    test_equals_icase();
+    test_starts_ends_with_icase();
+    test_contains_icase();
+    test_contains_icase_range();
     test_is_alphanumeric();
     test_is_uppercase();
     test_is_lowercase();
@@ -329,9 +517,12 @@ main() {
     test_count();
     test_contains();
     test_contains_in_range();
+    test_find_from_char_class();
+    test_split_whitespace_limit();
     test_reverse();
     test_join();
     test_slice();
+    test_slice_random();
     test_repeat();
     test_to_upper();
     test_to_lower();
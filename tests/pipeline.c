@@ -0,0 +1,127 @@
+/// Tests the fused split, transform, filter and join stages of `StringPipelineT`.
+
+#include "string_pipeline.h"
+#include "string_utils.h"
+
+#include <stdlib.h>
+
+static void
+test_pipeline_log_normalisation() {
+    StringT *input = String_from("  ERROR disk Full \n\n\tWarn: CPU hot\n   \nINFO ok");
+    StringT *separator = String_from(" | ");
+    StringPipelineT *pipeline = StringPipeline_new();
+    StringT *output;
+
+    StringPipeline_split_lines(pipeline);
+    StringPipeline_transform(pipeline, STRING_TRANSFORM_TRIM_WHITESPACE);
+    StringPipeline_drop_empty(pipeline);
+    StringPipeline_transform(pipeline, STRING_TRANSFORM_LOWER);
+    StringPipeline_join(pipeline, separator);
+    output = StringPipeline_run(pipeline, input);
+
+    log_result(__func__, String_eq(output, "error disk full | warn: cpu hot | info ok"));
+    StringPipeline_free(pipeline);
+    STRING_FREE_MULTIPLE(input, separator, output);
+}
+
+static void
+test_pipeline_replace_filter() {
+    StringT *input = String_from("a1 22 Straße 333 b-b-b 4");
+    StringT *old = String_from("-");
+    StringT *new = String_from("--");
+    StringT *comma = String_from(",");
+    StringPipelineT *pipeline = StringPipeline_new();
+    StringT *output;
+    StringT *empty_output;
+    StringT *empty = String_from("");
+
+    StringPipeline_split_whitespace(pipeline);
+    StringPipeline_filter(pipeline, STRING_TEST_INT, false);
+    StringPipeline_replace(pipeline, old, new);
+    StringPipeline_transform(pipeline, STRING_TRANSFORM_UPPER);
+    StringPipeline_join(pipeline, comma);
+    output = StringPipeline_run(pipeline, input);
+    empty_output = StringPipeline_run(pipeline, empty);
+
+    log_result(__func__, String_eq(output, "A1,STRASSE,B--B--B") &&
+                             String_eq(empty_output, "") && empty_output->length == 0);
+    StringPipeline_free(pipeline);
+    STRING_FREE_MULTIPLE(input, old, new, comma, output, empty, empty_output);
+}
+
+static void
+test_pipeline_split_delimiter() {
+    StringT *input = String_from("::a::::b::");
+    StringT *delimiter = String_from("::");
+    StringPipelineT *pipeline = StringPipeline_new();
+    StringT *output;
+
+    // Without a join stage the pieces are concatenated, empty pieces are kept.
+    StringPipeline_split(pipeline, delimiter);
+    StringPipeline_replace(pipeline, delimiter, delimiter);
+    output = StringPipeline_run(pipeline, input);
+
+    log_result(__func__, String_eq(output, "ab"));
+    StringPipeline_free(pipeline);
+    STRING_FREE_MULTIPLE(input, delimiter, output);
+}
+
+/// Checks the fused stages against the chain of calls they replace, on random input.
+static void
+test_pipeline_matches_calls() {
+    StringT *old = String_from("aab"), *new = String_from("<>");
+    StringT *delimiter = String_from("ba"), *comma = String_from(",");
+    StringPipelineT *words = StringPipeline_new(), *fields = StringPipeline_new();
+    char text[400];
+    int result = 1;
+
+    StringPipeline_split_whitespace(words);
+    StringPipeline_replace(words, old, new);
+    StringPipeline_join(words, comma);
+    StringPipeline_split(fields, delimiter);
+    StringPipeline_join(fields, comma);
+
+    srand(7);
+    for (int round = 0; round < 200; ++round) {
+        ssize_t n = rand() % sizeof text;
+        StringT input = {.string = text, .length = n};
+        StringT *replaced, *joined, *output;
+        StringIteratorT *pieces;
+
+        for (ssize_t i = 0; i < n; ++i) text[i] = "aab \n"[rand() % 5];
+
+        replaced = String_replace(&input, old, new);
+        pieces = String_split_whitespace(replaced);
+        joined = String_join(pieces, comma);
+        output = StringPipeline_run(words, &input);
+        result &= String_equals(output, joined);
+        for (ssize_t i = 0; i < pieces->length; ++i) {
+            String_free((StringT *)pieces->strings[i]);
+        }
+        StringIterator_free(pieces);
+        STRING_FREE_MULTIPLE(replaced, joined, output);
+
+        pieces = String_split(&input, delimiter);
+        joined = String_join(pieces, comma);
+        output = StringPipeline_run(fields, &input);
+        result &= String_equals(output, joined);
+        for (ssize_t i = 0; i < pieces->length; ++i) {
+            String_free((StringT *)pieces->strings[i]);
+        }
+        StringIterator_free(pieces);
+        STRING_FREE_MULTIPLE(joined, output);
+    }
+
+    log_result(__func__, result);
+    StringPipeline_free(words);
+    StringPipeline_free(fields);
+    STRING_FREE_MULTIPLE(old, new, delimiter, comma);
+}
+
+int
+main() {
+    test_pipeline_log_normalisation();
+    test_pipeline_replace_filter();
+    test_pipeline_split_delimiter();
+    test_pipeline_matches_calls();
+}
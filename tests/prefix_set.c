@@ -0,0 +1,101 @@
+/// Tests the prefix sets `StringPrefixSetT`.
+
+#include "string_prefix_set.h"
+#include "string_utils.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static void
+test_prefix_set_routes() {
+    const char *routes[] = {"/api/", "/api/users/", "/", "/static/", "/api/users/"};
+    StringT strings[5];
+    StringIteratorT *iterator = StringIterator_new();
+    StringPrefixSetT *set;
+    StringT *path = String_from("/api/users/42"), *other = String_from("/about");
+    StringT *empty = String_from(""), *users = String_from("/api/users/");
+    ssize_t ids[4], length, count;
+    int result;
+
+    for (int i = 0; i < 5; ++i) {
+        strings[i] = (StringT){.string = (char *)routes[i], .length = strlen(routes[i])};
+        StringIterator_append(iterator, &strings[i]);
+    }
+    set = StringPrefixSet_new(iterator);
+    StringIterator_free(iterator);
+
+    count = StringPrefixSet_all_matches(set, path, ids, 4);
+    result = StringPrefixSet_longest_match(set, path, &length) == 1 && length == 11 &&
+             count == 3 && ids[0] == 2 && ids[1] == 0 && ids[2] == 1 &&
+             StringPrefixSet_longest_match(set, other, &length) == 2 && length == 1 &&
+             StringPrefixSet_longest_match(set, empty, NULL) == -1 &&
+             StringPrefixSet_all_matches(set, path, NULL, 0) == 3 &&
+             StringPrefixSet_contains(set, users) &&
+             !StringPrefixSet_contains(set, path) &&
+             StringPrefixSet_length(set) == 5;
+
+    log_result(__func__, result);
+    StringPrefixSet_free(set);
+    STRING_FREE_MULTIPLE(path, other, empty, users);
+}
+
+static void
+test_prefix_set_random() {
+    char buffers[200][8], key[12];
+    StringT strings[200];
+    int result = 1;
+
+    srand(43);
+    for (int round = 0; round < 40; ++round) {
+        ssize_t size = rand() % 200, ids[16];
+        StringIteratorT *iterator = StringIterator_new();
+        StringPrefixSetT *set;
+
+        // Short strings over two letters, so that many are prefixes of each other.
+        for (ssize_t i = 0; i < size; ++i) {
+            strings[i] = (StringT){.string = buffers[i], .length = rand() % 8};
+            for (ssize_t j = 0; j < strings[i].length; ++j) {
+                buffers[i][j] = 'a' + rand() % 2;
+            }
+            StringIterator_append(iterator, &strings[i]);
+        }
+        set = StringPrefixSet_new(iterator);
+        StringIterator_free(iterator);
+
+        for (int query = 0; query < 50; ++query) {
+            StringT string = {.string = key, .length = rand() % sizeof key};
+            ssize_t expected = -1, expected_count = 0, length, count;
+            bool member = false;
+
+            for (ssize_t j = 0; j < string.length; ++j) key[j] = 'a' + rand() % 2;
+
+            // Each length of prefix counts once, with the first string of that value.
+            for (ssize_t l = 0; l <= string.length; ++l) {
+                for (ssize_t i = 0; i < size; ++i) {
+                    if (strings[i].length == l && memcmp(buffers[i], key, l) == 0) {
+                        expected = i;
+                        member |= l == string.length;
+                        expected_count++;
+                        break;
+                    }
+                }
+            }
+
+            count = StringPrefixSet_all_matches(set, &string, ids, 16);
+            result &= StringPrefixSet_longest_match(set, &string, &length) == expected &&
+                      count == expected_count &&
+                      (count == 0 || ids[count - 1] == expected) &&
+                      (expected < 0 || length == strings[expected].length) &&
+                      StringPrefixSet_contains(set, &string) == member;
+        }
+        StringPrefixSet_free(set);
+    }
+
+    log_result(__func__, result);
+}
+
+int
+main() {
+    test_prefix_set_routes();
+    test_prefix_set_random();
+}
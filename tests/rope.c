@@ -0,0 +1,139 @@
+/// Tests the `StringRopeT` balanced tree of chunks.
+
+#include "string_ext.h"
+#include "string_rope.h"
+#include "string_utils.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static void
+test_rope_edit() {
+    StringT *string = String_from("Hello World");
+    StringT *comma = String_from(",");
+    StringT *name = String_from("Rope");
+    StringRopeT *rope = StringRope_from(string);
+    StringT *flat1, *flat2;
+
+    StringRope_insert(rope, 5, comma);
+    flat1 = StringRope_flatten(rope);
+    StringRope_replace_range(rope, 7, 12, name);
+    StringRope_delete(rope, 0, 2);
+    flat2 = StringRope_flatten(rope);
+
+    log_result(__func__, String_eq(flat1, "Hello, World") && flat1->length == 12 &&
+                             String_eq(flat2, "llo, Rope") && StringRope_len(rope) == 9 &&
+                             StringRope_index(rope, -1) == 'e');
+    STRING_FREE_MULTIPLE(string, comma, name, flat1, flat2);
+    StringRope_free(rope);
+}
+
+static void
+test_rope_random_edits() {
+    ssize_t length = 100000, capacity = 400000;
+    char *expected = malloc(capacity);
+    char *text = malloc(capacity);
+    StringRopeT *rope;
+    StringT *flat;
+    int result = 1;
+
+    srand(42);
+    for (ssize_t i = 0; i < capacity; ++i) {
+        text[i] = 'a' + rand() % 26;
+    }
+    memcpy(expected, text, length);
+    rope = StringRope_from_char_array(text, length);
+
+    for (int edit = 0; edit < 2000; ++edit) {
+        ssize_t start = rand() % (length + 1);
+        ssize_t size = rand() % 3000;
+
+        if (rand() % 2 && length + size < capacity) {
+            const char *insert = text + rand() % (capacity - size);
+
+            StringRope_insert_char_array(rope, start, insert, size);
+            memmove(expected + start + size, expected + start, length - start);
+            memcpy(expected + start, insert, size);
+            length += size;
+        } else {
+            size = size < length - start ? size : length - start;
+            StringRope_delete(rope, start, start + size);
+            memmove(expected + start, expected + start + size, length - start - size);
+            length -= size;
+        }
+    }
+    flat = StringRope_flatten(rope);
+
+    result &= flat->length == length && memcmp(flat->string, expected, length) == 0;
+    for (int i = 0; i < 100; ++i) {
+        ssize_t index = rand() % length;
+        result &= StringRope_index(rope, index) == expected[index];
+    }
+
+    log_result(__func__, result);
+    STRING_FREE_MULTIPLE(flat);
+    StringRope_free(rope);
+    free(expected);
+    free(text);
+}
+
+static void
+test_rope_slice_concatenate() {
+    StringT *string = String_from("abcdefghij");
+    StringRopeT *rope = StringRope_from(string);
+    StringRopeT *slice = StringRope_slice(rope, 2, 5);
+    StringRopeT *both = StringRope_concatenate(slice, rope);
+    StringT *flat_slice, *flat_both, *flat_rope;
+
+    StringRope_concatenate_inplace(slice, slice);
+    flat_slice = StringRope_flatten(slice);
+    flat_both = StringRope_flatten(both);
+    flat_rope = StringRope_flatten(rope);
+
+    log_result(__func__, String_eq(flat_slice, "cdecde") &&
+                             String_eq(flat_both, "cdeabcdefghij") &&
+                             String_eq(flat_rope, "abcdefghij"));
+    STRING_FREE_MULTIPLE(string, flat_slice, flat_both, flat_rope);
+    StringRope_free(rope);
+    StringRope_free(slice);
+    StringRope_free(both);
+}
+
+static void
+test_rope_contains_and_chunks() {
+    StringRopeT *rope = StringRope_new();
+    StringT *word = String_from("lorem ipsum ");
+    StringT *needle = String_from("ipsum lorem ipsum");
+    StringT *missing = String_from("ipsum ipsum");
+    StringRopeIteratorT iterator;
+    StringT chunk;
+    ssize_t total = 0, chunks = 0;
+    StringIndexT found, again;
+
+    for (int i = 0; i < 1000; ++i) {
+        StringRope_append(rope, word);
+    }
+    StringRope_iterator(rope, 5, &iterator);
+    while (StringRope_next_chunk(&iterator, &chunk)) {
+        total += chunk.length;
+        chunks++;
+    }
+    found = StringRope_contains(rope, needle);
+    again = StringRope_contains_from(rope, needle, 5000);
+
+    log_result(__func__, total == 12000 - 5 && chunks > 1 &&
+                             string_index_equal(found, StringIndex(6, 23)) &&
+                             string_index_equal(again, StringIndex(5010, 5027)) &&
+                             string_index_equal(StringRope_contains(rope, missing),
+                                                StringIndex(0, 0, 1)));
+    STRING_FREE_MULTIPLE(word, needle, missing);
+    StringRope_free(rope);
+}
+
+int
+main() {
+    test_rope_edit();
+    test_rope_random_edits();
+    test_rope_slice_concatenate();
+    test_rope_contains_and_chunks();
+}
@@ -0,0 +1,82 @@
+/// Tests the copy-on-write sharing of `StringT`.
+
+#include "string_ext.h"
+#include "string_utils.h"
+
+static void
+test_share() {
+    StringT *string = String_from("Hello");
+    StringT *reference = String_share(string);
+    StringT *copy = String_copy(reference);
+    int result = reference->string == string->string && copy->string == string->string &&
+                 String_is_shared(string) && String_eq(copy, "Hello");
+
+    String_free(string);
+    String_free(reference);
+    result &= !String_is_shared(copy) && String_eq(copy, "Hello");
+
+    log_result(__func__, result);
+    STRING_FREE_MULTIPLE(copy);
+}
+
+static void
+test_share_copy_on_write() {
+    StringT *string = String_from("Hello");
+    StringT *reference = String_share(string);
+    StringT *suffix = String_from(", World");
+
+    String_concatenate_inplace(reference, suffix);
+
+    log_result(__func__, reference->string != string->string &&
+                             String_eq(string, "Hello") &&
+                             String_eq(reference, "Hello, World") &&
+                             !String_is_shared(string));
+    STRING_FREE_MULTIPLE(string, reference, suffix);
+}
+
+static void
+test_share_unshare() {
+    StringT *string = String_from("Hello");
+    StringT *reference = String_share(string);
+
+    String_unshare(reference);
+    reference->string[0] = 'J';
+    String_unshare(string);
+    string->string[1] = 'a';
+
+    log_result(__func__, String_eq(string, "Hallo") && String_eq(reference, "Jello"));
+    STRING_FREE_MULTIPLE(string, reference);
+}
+
+static void
+test_share_no_op_transforms() {
+    StringT *upper = String_from("HELLO, WORLD");
+    StringT *trimmed = String_from("Hello");
+    StringT *shared_upper = String_share(upper);
+    StringT *shared_trimmed = String_share(trimmed);
+    StringT *results[] = {
+        String_to_upper(shared_upper),         String_to_capital(shared_upper),
+        String_trim_whitespace(shared_trimmed), String_trim_left(shared_trimmed),
+        String_trim_right(shared_trimmed),      String_left_justify(shared_trimmed, 3),
+        String_centre(shared_trimmed, 5),
+    };
+    StringT *lower = String_to_lower(shared_upper);
+    int result = String_eq(lower, "hello, world") && lower->string != upper->string;
+
+    for (size_t i = 0; i < sizeof results / sizeof *results; ++i) {
+        result &= results[i]->string == upper->string ||
+                  results[i]->string == trimmed->string;
+        String_free(results[i]);
+    }
+
+    log_result(__func__, result);
+    STRING_FREE_MULTIPLE(upper, trimmed, shared_upper, shared_trimmed, lower);
+}
+
+int
+main() {
+    test_share();
+    test_share_copy_on_write();
+    test_share_unshare();
+    test_share_no_op_transforms();
+}
@@ -0,0 +1,109 @@
+/// Tests the three way comparison and sorting of `StringIteratorT`.
+
+#include "string_ext.h"
+#include "string_utils.h"
+
+/// Build an iterator from `count` pseudo random lowercase / uppercase strings.
+static StringIteratorT *
+random_iterator(StringT **strings, int count) {
+    StringIteratorT *iter = StringIterator_new();
+    unsigned int seed = 42;
+    char buffer[16];
+
+    for (int i = 0; i < count; ++i) {
+        int length = (seed = seed * 1103515245 + 12345) % 8;
+        for (int j = 0; j < length; ++j) {
+            seed = seed * 1103515245 + 12345;
+            buffer[j] = "abcABC"[(seed >> 16) % 6];
+        }
+        buffer[length] = '\0';
+        strings[i] = String_from(buffer);
+        StringIterator_append(iter, strings[i]);
+    }
+
+    return iter;
+}
+
+static int
+is_sorted(const StringIteratorT *iter, int ignore_case) {
+    for (ssize_t i = 1; i < iter->length; ++i) {
+        StringT *prev = String_to_lower(iter->strings[i - 1]);
+        StringT *curr = String_to_lower(iter->strings[i]);
+        int cmp = ignore_case ? String_compare(prev, curr)
+                              : String_compare(iter->strings[i - 1], iter->strings[i]);
+
+        STRING_FREE_MULTIPLE(prev, curr);
+        if (cmp > 0) return 0;
+    }
+    return 1;
+}
+
+static void
+test_compare() {
+    StringT *apple = String_from("apple");
+    StringT *apples = String_from("apples");
+    StringT *banana = String_from("banana");
+
+    log_result(__func__, String_compare(apple, apples) < 0 &&
+                             String_compare(apples, apple) > 0 &&
+                             String_compare(banana, apple) > 0 &&
+                             String_compare(apple, apple) == 0);
+    STRING_FREE_MULTIPLE(apple, apples, banana);
+}
+
+static void
+test_sort() {
+    StringT *strings[500];
+    StringIteratorT *iter = random_iterator(strings, 500);
+
+    StringIterator_sort(iter, STRING_SORT_DEFAULT);
+    log_result(__func__, is_sorted(iter, 0));
+
+    for (int i = 0; i < 500; ++i) String_free(strings[i]);
+    STRING_ITERATOR__FREE_MULTIPLE(iter);
+}
+
+static void
+test_sort_stable_ignore_case() {
+    StringIteratorT *iter = StringIterator_new();
+    StringT *upper = String_from("B");
+    StringT *lower = String_from("b");
+    StringT *first = String_from("a");
+    int result;
+
+    StringIterator_append(iter, upper);
+    StringIterator_append(iter, first);
+    StringIterator_append(iter, lower);
+    StringIterator_sort(iter, STRING_SORT_STABLE | STRING_SORT_IGNORE_CASE);
+
+    result = iter->strings[0] == first && iter->strings[1] == upper &&
+             iter->strings[2] == lower;
+    log_result(__func__, result);
+    STRING_FREE_MULTIPLE(upper, lower, first);
+    STRING_ITERATOR__FREE_MULTIPLE(iter);
+}
+
+static void
+test_sort_parallel() {
+    StringT *strings[3000];
+    StringIteratorT *iter = random_iterator(strings, 2000);
+    StringIteratorT *stable = random_iterator(strings + 2000, 1000);
+    int result;
+
+    StringIterator_sort(iter, STRING_SORT_PARALLEL);
+    StringIterator_sort(stable, STRING_SORT_PARALLEL | STRING_SORT_STABLE |
+                                    STRING_SORT_IGNORE_CASE);
+    result = is_sorted(iter, 0) && is_sorted(stable, 1);
+    log_result(__func__, result);
+
+    for (int i = 0; i < 3000; ++i) String_free(strings[i]);
+    STRING_ITERATOR__FREE_MULTIPLE(iter, stable);
+}
+
+int
+main() {
+    test_compare();
+    test_sort();
+    test_sort_stable_ignore_case();
+    test_sort_parallel();
+}
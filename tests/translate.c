@@ -0,0 +1,103 @@
+/// Tests the byte translation tables `StringTranslateT`.
+
+#include "string_translate.h"
+#include "string_utils.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static void
+test_translate_path() {
+    StringT *from = String_from("/\\"), *to = String_from("__");
+    StringT *deleted = String_from("\r\n\t");
+    StringTranslateT *table = StringTranslate_from(from, to, deleted);
+    StringT *string = String_from("usr/local\\bin\r\n\tname");
+    StringT *translated = String_translate(string, table);
+    StringT *output = String_from("key:");
+
+    String_translate_into(output, string, table);
+
+    log_result(__func__, String_eq(translated, "usr_local_binname") &&
+                             translated->allocated == translated->length + 1 &&
+                             String_eq(output, "key:usr_local_binname"));
+    StringTranslate_free(table);
+    STRING_FREE_MULTIPLE(from, to, deleted, string, translated, output);
+}
+
+static void
+test_translate_map() {
+    unsigned char map[256];
+    bool deleted[256] = {0};
+    StringTranslateT *table, *identity = StringTranslate_new(NULL, NULL);
+    StringT *string =
+        String_from("Sanitise THIS key, with \x01 control \x7F bytes \xC3\xA9!");
+    StringT *translated, *same;
+
+    // Lowercase the ASCII letters and drop the control characters.
+    for (int ch = 0; ch < 256; ++ch) {
+        map[ch] = ch >= 'A' && ch <= 'Z' ? ch + 32 : ch;
+        deleted[ch] = ch < 0x20 || ch == 0x7F;
+    }
+    table = StringTranslate_new(map, deleted);
+    translated = String_translate(string, table);
+    same = String_translate(string, identity);
+
+    log_result(__func__, String_eq(translated, "sanitise this key, with  control  "
+                                               "bytes \xC3\xA9!") &&
+                             String_equals(same, string));
+    StringTranslate_free(table);
+    StringTranslate_free(identity);
+    STRING_FREE_MULTIPLE(string, translated, same);
+}
+
+static void
+test_translate_random() {
+    unsigned char map[256];
+    bool deleted[256];
+    char buffer[300], expected[300];
+    int result = 1;
+
+    srand(23);
+    for (int round = 0; round < 200; ++round) {
+        // Tables changing a few rows of byte values or all of them.
+        int rows = rand() % 2 ? 0xFFFF : rand() % 0x10000;
+        StringTranslateT *table;
+
+        for (int ch = 0; ch < 256; ++ch) {
+            map[ch] = rows >> (ch >> 4) & 1 ? rand() % 256 : ch;
+            deleted[ch] = rand() % 8 == 0;
+        }
+        table = StringTranslate_new(map, round % 4 ? deleted : NULL);
+
+        for (int string_round = 0; string_round < 10; ++string_round) {
+            ssize_t length = rand() % sizeof buffer, expected_length = 0;
+            StringT string = {.string = buffer, .length = length};
+            StringT *translated;
+
+            for (ssize_t i = 0; i < length; ++i) {
+                unsigned char ch = rand() % 256;
+
+                buffer[i] = (char)ch;
+                if (!(round % 4) || !deleted[ch]) {
+                    expected[expected_length++] = (char)map[ch];
+                }
+            }
+
+            translated = String_translate(&string, table);
+            result &= translated->length == expected_length &&
+                      memcmp(translated->string, expected, expected_length) == 0 &&
+                      translated->string[expected_length] == '\0';
+            String_free(translated);
+        }
+        StringTranslate_free(table);
+    }
+
+    log_result(__func__, result);
+}
+
+int
+main() {
+    test_translate_path();
+    test_translate_map();
+    test_translate_random();
+}
@@ -0,0 +1,158 @@
+/// Tests the UTF-8 functions of `StringT`.
+
+#include "string_ext.h"
+#include "string_utils.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/// Straightforward decoder used as the reference of the validator.
+static int
+reference_validate(const unsigned char *s, ssize_t length) {
+    for (ssize_t i = 0; i < length;) {
+        unsigned code_point;
+        int size;
+
+        if (s[i] < 0x80) {
+            i++;
+            continue;
+        }
+        if (s[i] >= 0xC0 && s[i] < 0xE0) size = 2, code_point = s[i] & 0x1F;
+        else if (s[i] >= 0xE0 && s[i] < 0xF0) size = 3, code_point = s[i] & 0x0F;
+        else if (s[i] >= 0xF0 && s[i] < 0xF8) size = 4, code_point = s[i] & 0x07;
+        else return 0;
+
+        if (i + size > length) return 0;
+        for (int j = 1; j < size; ++j) {
+            if ((s[i + j] & 0xC0) != 0x80) return 0;
+            code_point = (code_point << 6) | (s[i + j] & 0x3F);
+        }
+        if (code_point > 0x10FFFF || (code_point >= 0xD800 && code_point <= 0xDFFF) ||
+            code_point < (size == 2 ? 0x80u : size == 3 ? 0x800u : 0x10000u)) {
+            return 0;
+        }
+        i += size;
+    }
+
+    return 1;
+}
+
+static void
+test_utf8_validate() {
+    const char *valid[] = {"", "Hello", "Grüße", "€ 10", "\xF0\x9F\x98\x80",
+                           "\xED\x9F\xBF", "\xF4\x8F\xBF\xBF", "\xEF\xBF\xBF"};
+    const char *invalid[] = {"\xC3\x28",         "\xA0\xA1",         "\xC0\xAF",
+                             "\xE0\x80\xAF",     "\xED\xA0\x80",     "\xF4\x90\x80\x80",
+                             "\xF8\x88\x80\x80", "\xE2\x82",         "abc\xF0\x9F\x98",
+                             "\xF0\x80\x80\x80", "\xE2\x82\xAC\xAC", "\xFF"};
+    int result = 1;
+
+    for (size_t i = 0; i < sizeof valid / sizeof *valid; ++i) {
+        result &= String_utf8_validate_char_array(valid[i], strlen(valid[i]));
+    }
+    for (size_t i = 0; i < sizeof invalid / sizeof *invalid; ++i) {
+        result &= !String_utf8_validate_char_array(invalid[i], strlen(invalid[i]));
+    }
+
+    log_result(__func__, result);
+}
+
+static void
+test_utf8_validate_random() {
+    const char *pieces[] = {"a", "Hello world ", "\xC3\xBC", "\xE2\x82\xAC",
+                            "\xF0\x9F\x98\x80", "\xED\x9F\xBF", "\x7F"};
+    char buffer[512];
+    int result = 1;
+
+    srand(7);
+    for (int round = 0; round < 20000; ++round) {
+        ssize_t length = 0, limit = rand() % 200;
+
+        while (length < limit) {
+            const char *piece = pieces[rand() % 7];
+            size_t size = strlen(piece);
+
+            memcpy(buffer + length, piece, size);
+            length += size;
+        }
+        // Corrupt a random byte in every other round, errors then sit at any offset.
+        if (round % 2 && length) {
+            buffer[rand() % length] = (char)(rand() % 256);
+        }
+
+        result &= String_utf8_validate_char_array(buffer, length) ==
+                  reference_validate((const unsigned char *)buffer, length);
+    }
+
+    log_result(__func__, result);
+}
+
+static void
+test_utf8_length() {
+    StringT *string = String_from("Grüße, € and \xF0\x9F\x98\x80 in a longer text");
+    StringT *ascii = String_from("plain ascii");
+
+    log_result(__func__, String_utf8_length(string) == 31 && string->length == 38 &&
+                             String_utf8_length(ascii) == 11);
+    STRING_FREE_MULTIPLE(string, ascii);
+}
+
+static void
+test_utf8_slice() {
+    StringT *string = String_from("Grüße, Welt");
+    StringT *slice1 = String_utf8_slice(string, StringIndex(2, 5));
+    StringT *slice2 = String_utf8_slice(string, StringIndex(-4, 100));
+    StringT *slice3 = String_utf8_slice(string, StringIndex(0, 5, 2));
+    StringT *slice4 = String_utf8_slice(string, StringIndex(4, -100, -1));
+
+    log_result(__func__, String_eq(slice1, "üße") && slice1->length == 5 &&
+                             String_eq(slice2, "Welt") && String_eq(slice3, "Güe") &&
+                             String_eq(slice4, "eßürG") && slice4->length == 7);
+    STRING_FREE_MULTIPLE(string, slice1, slice2, slice3, slice4);
+}
+
+/// On ASCII input, code points are bytes and both slices must agree on every index.
+static void
+test_utf8_slice_ascii() {
+    StringT *string = String_from("hello");
+    StringT *negative = String_utf8_slice(string, StringIndex(0, -1, 1));
+    int result = String_eq(negative, "hello");
+
+    for (ssize_t start = -8; start <= 8; ++start) {
+        for (ssize_t stop = -8; stop <= 8; ++stop) {
+            for (ssize_t step = -3; step <= 3; ++step) {
+                StringT *bytes, *code_points;
+
+                if (step == 0) continue;
+                bytes = String_slice(string, StringIndex(start, stop, step));
+                code_points = String_utf8_slice(string, StringIndex(start, stop, step));
+                result &= String_equals(bytes, code_points);
+                STRING_FREE_MULTIPLE(bytes, code_points);
+            }
+        }
+    }
+
+    log_result(__func__, result);
+    STRING_FREE_MULTIPLE(string, negative);
+}
+
+static void
+test_utf8_reverse() {
+    StringT *string = String_from("a€b\xF0\x9F\x98\x80");
+    StringT *reversed = String_utf8_reverse(string);
+
+    log_result(__func__, String_eq(reversed, "\xF0\x9F\x98\x80" "b€a") &&
+                             reversed->length == string->length &&
+                             String_utf8_validate(reversed));
+    STRING_FREE_MULTIPLE(string, reversed);
+}
+
+int
+main() {
+    test_utf8_validate();
+    test_utf8_validate_random();
+    test_utf8_length();
+    test_utf8_slice();
+    test_utf8_slice_ascii();
+    test_utf8_reverse();
+}